@@ -15,16 +15,24 @@
 #include "DetectorConstruction.hh"   // 【用户自定义】继承 G4VUserDetectorConstruction
 #include "ActionInitialization.hh"   // 【用户自定义】继承 G4VUserActionInitialization
 #include "Config.hh"                 // 【配置文件】读取模拟参数
+#include "EmOnlyPhysicsList.hh"      // 【用户自定义】仅电磁物理的精简列表 + 电磁构造器工厂
+#include "StartupProfile.hh"         // 【用户自定义】启动阶段计时，写入 run_meta
+#include "AsyncWriter.hh"            // 【用户自定义】二进制输出的 I/O 线程
+#include "MemoryBudget.hh"           // 【用户自定义】输出缓冲的内存预算
 
 #include "G4RunManagerFactory.hh"    // 【GEANT4 内核】创建 RunManager
 #include "G4UImanager.hh"            // 【GEANT4 内核】命令接口
 #include "G4VisExecutive.hh"         // 【GEANT4 内核】可视化管理器
 #include "G4UIExecutive.hh"          // 【GEANT4 内核】交互界面
 #include "FTFP_BERT.hh"              // 【可选模块】官方强子物理
-#include "G4EmStandardPhysics_option4.hh" // 【可选模块】高精度电磁物理
 #include "G4OpticalPhysics.hh"       // 【可选模块】光学物理（Cherenkov）
+#include "G4OpticalParameters.hh"
 #include "G4SystemOfUnits.hh"        // 【GEANT4 内核】单位系统
 #include "Randomize.hh"              // 【GEANT4 内核】随机数工具
+#include "G4Version.hh"              // 【GEANT4 内核】物理表缓存 key 含 Geant4 版本；sub-event 需 11.2+
+
+#include <filesystem>
+#include <unistd.h>
 
 // 运行模式：用于集中控制 test / full / custom 等
 struct RunModeConfig {
@@ -42,6 +50,8 @@ struct RunModeConfig {
 
 int main(int argc, char** argv)
 {
+  StartupProfile::Start();
+
   // ====================== 解析命令行参数 ======================
   // 支持:
   //   ./CherenkovSim [--config <config_file>] [macro_file]
@@ -96,6 +106,20 @@ int main(int argc, char** argv)
   // 【配置文件】从 JSON 文件加载所有参数
   Config* config = Config::GetInstance();
   config->LoadConfig(configFilePath);
+  if (!config->Validate()) {
+    delete[] argvForUI;
+    return 1;
+  }
+  AsyncWriter::Instance()->SetQueueDepth(config->GetWriterQueueDepth());
+  AsyncWriter::Instance()->SetParallelAppend(config->GetWriterMode() == "pwrite");
+  AsyncWriter::Instance()->SetDirectIO(config->GetWriterDirectIO());
+  AsyncWriter::Instance()->SetFsyncPolicy(config->GetWriterFsync() == "every_buffer" ? AsyncWriter::kFsyncEveryBuffer
+                                          : config->GetWriterFsync() == "end_of_run" ? AsyncWriter::kFsyncEndOfRun
+                                          : AsyncWriter::kFsyncNone);
+  MemoryBudget::SetBudgetMB(config->GetMemoryBudgetMB());
+  AsyncWriter::Instance()->SetChunkedOutput(config->GetOutputCompression() == "zlib", config->GetOutputChunkRecords());
+  AsyncWriter::Instance()->SetColumnarOutput(config->GetOutputLayout() == "columns");
+  StartupProfile::Mark("config");
 
   // ====================== 运行模式判断 ======================
   // 【程序流程】是否进入交互模式
@@ -107,7 +131,17 @@ int main(int argc, char** argv)
 
   // ====================== 创建核心控制器 ======================
   // 【GEANT4 内核】整个模拟的"大脑"
+  // optical_subevent_size > 0：sub-event 并行，master 处理事件的带电簇射，重事件的光子组成 sub-event 交给 worker
+#if defined(G4MULTITHREADED) && G4VERSION_NUMBER >= 1120
+  auto* runManager = (config->GetOpticalSubEventSize() > 0)
+                     ? G4RunManagerFactory::CreateRunManager(G4RunManagerType::SubEvt)
+                     : G4RunManagerFactory::CreateRunManager();
+  if (config->GetOpticalSubEventSize() > 0) {
+    runManager->RegisterSubEventType(0, config->GetOpticalSubEventSize());
+  }
+#else
   auto* runManager = G4RunManagerFactory::CreateRunManager();
+#endif
 
   runManager->SetNumberOfThreads(config->GetNumThreads());  // 【配置文件】从配置读取线程数
 
@@ -116,19 +150,80 @@ int main(int argc, char** argv)
   runManager->SetUserInitialization(new DetectorConstruction());
 
   // ====================== 注册物理 ======================
-  // 【GEANT4 内核,可选】使用官方物理列表
-  G4VModularPhysicsList* physicsList = new FTFP_BERT;
-
-  // 【GEANT4 内核,可选】替换电磁模型
-  physicsList->ReplacePhysics(new G4EmStandardPhysics_option4());
+  // 【GEANT4 内核,可选】使用官方物理列表（FTFP_BERT），或仅含电磁物理的精简列表（em_only）
+  G4VModularPhysicsList* physicsList = nullptr;
+  if (config->GetPhysicsList() == "em_only") {
+    physicsList = new EmOnlyPhysicsList(config->GetEmOption());
+  } else {
+    physicsList = new FTFP_BERT;
+    // 【GEANT4 内核,可选】替换电磁模型（默认 option4）
+    physicsList->ReplacePhysics(EmOnlyPhysicsList::CreateEmPhysics(config->GetEmOption()));
+  }
   
   // 【GEANT4 内核,可选】注册光学过程（Cherenkov 在这里产生）
-  G4OpticalPhysics* opticalPhysics = new G4OpticalPhysics();
-  physicsList->RegisterPhysics(opticalPhysics);
+  // yield_only 模式不产生光学光子：不注册光学物理，期望产额由 SteppingAction 按 Frank–Tamm 积分累加
+  if (config->GetCherenkovMode() != "yield_only") {
+    G4OpticalPhysics* opticalPhysics = new G4OpticalPhysics();
+    physicsList->RegisterPhysics(opticalPhysics);
+
+    // 光学过程子集（optical.processes）：未用到的过程关闭后不参与每个光学步的过程循环
+    G4OpticalParameters* opticalParams = G4OpticalParameters::Instance();
+    for (const std::string& name : Config::GetOpticalProcessNames()) {
+      opticalParams->SetProcessActivation(name, config->GetOpticalProcessActivation(name));
+    }
+    // 吸收期望值加权：关闭 OpAbsorption，由 SteppingAction 按 exp(-L/ABSLENGTH) 衰减光子权重
+    if (config->GetOpticalAbsorptionWeighting()) {
+      opticalParams->SetProcessActivation("OpAbsorption", false);
+    }
+    if (config->GetCerenkovMaxPhotonsPerStep() > 0) {
+      opticalParams->SetCerenkovMaxPhotonsPerStep(config->GetCerenkovMaxPhotonsPerStep());
+    }
+    if (config->GetCerenkovMaxBetaChange() > 0.0) {
+      opticalParams->SetCerenkovMaxBetaChange(config->GetCerenkovMaxBetaChange());
+    }
+    // staged stacking：光子入栈即转为暂存记录，母粒子无需在每个发光步后挂起让光子先走
+    if (config->GetOpticalStagedStacking()) {
+      opticalParams->SetCerenkovTrackSecondariesFirst(false);
+    }
+  }
 
   // 【GEANT4 内核】把物理列表交给 RunManager
   runManager->SetUserInitialization(physicsList);
 
+  // 【可选】物理表缓存：<cache_dir>/<物理配置 key>_g4<版本>。
+  // 目录存在 = 上次已完整写出，首次 Run 初始化时直接读取；否则构建后写入临时目录再原子改名，
+  // 多个作业同时未命中时只有一个改名成功，其余丢弃自己的副本
+  std::string tableCacheDir;
+  G4bool storeTables = false;
+  if (!config->GetPhysicsTableCacheDir().empty()) {
+    tableCacheDir = config->GetPhysicsTableCacheDir() + "/" + config->GetPhysicsConfigKey()
+                    + "_g4" + std::to_string(G4VERSION_NUMBER);
+    if (std::filesystem::is_directory(tableCacheDir)) {
+      physicsList->SetPhysicsTableRetrieved(tableCacheDir);
+      StartupProfile::SetPhysicsTableCache("retrieved", tableCacheDir);
+    } else {
+      storeTables = true;
+      // 宏模式在宏执行完后才写出缓存，期间各 run 的 run_meta 记为 "built"
+      StartupProfile::SetPhysicsTableCache("built", tableCacheDir);
+    }
+  }
+  // 物理表须已由一次 Run 初始化构建（--mode 的 0 事件 Run，或宏中的 /run/beamOn）
+  auto storePhysicsTables = [&]() {
+    std::error_code ec;
+    std::string tmpDir = tableCacheDir + ".tmp" + std::to_string(::getpid());
+    std::filesystem::create_directories(tmpDir, ec);
+    if (!ec && physicsList->StorePhysicsTable(tmpDir)) {
+      std::filesystem::rename(tmpDir, tableCacheDir, ec);
+      if (ec) std::filesystem::remove_all(tmpDir, ec);  // 其他作业已写好
+      StartupProfile::SetPhysicsTableCache("stored", tableCacheDir);
+    } else {
+      G4cerr << "WARNING: cannot store physics tables in " << tmpDir << G4endl;
+      std::filesystem::remove_all(tmpDir, ec);
+    }
+    StartupProfile::Mark("physics_table_store");
+  };
+  StartupProfile::Mark("run_manager_and_physics_list");
+
   // ====================== 注册用户行为 ======================
   // 【用户自定义】内部创建：
   //   PrimaryGeneratorAction
@@ -136,11 +231,17 @@ int main(int argc, char** argv)
   //   EventAction
   //   SteppingAction
   runManager->SetUserInitialization(new ActionInitialization());
+  StartupProfile::Mark("user_initialization");
 
   // ====================== 可视化初始化 ======================
   // 【GEANT4 内核】可选模块
-  G4VisManager* visManager = new G4VisExecutive;
-  visManager->Initialize();
+  // 仅交互模式需要；batch 作业跳过 G4VisExecutive 的构造与全部驱动注册
+  G4VisManager* visManager = nullptr;
+  if (ui) {
+    visManager = new G4VisExecutive;
+    visManager->Initialize();
+    StartupProfile::Mark("vis");
+  }
 
   // ====================== 获取命令管理器 ======================
   // 【GEANT4 内核】单例模式
@@ -152,6 +253,7 @@ int main(int argc, char** argv)
     if (!runCfg.macroFilePath.empty()) {
       G4String command = "/control/execute ";
       UImanager->ApplyCommand(command + runCfg.macroFilePath);
+      StartupProfile::Mark("macro");  // 含 /run/initialize（几何 + 物理构造）
     }
 
     // 若指定了运行模式，并且事件数已确定，则在基础宏之后统一发出 /run/beamOn
@@ -173,9 +275,17 @@ int main(int argc, char** argv)
       }
 
       if (beamOnEvents > 0) {
+        // 先做一次 0 事件的 Run：只构建（或读取）物理表，使其耗时单独计入启动阶段
+        UImanager->ApplyCommand("/run/beamOn 0");
+        StartupProfile::Mark("physics_tables");
+        if (storeTables) storePhysicsTables();
+
         G4String beamOnCmd = "/run/beamOn " + std::to_string(beamOnEvents);
         UImanager->ApplyCommand(beamOnCmd);
       }
+    } else if (storeTables && runManager->GetCurrentRun() != nullptr) {
+      // 纯宏模式：宏里的 /run/beamOn 已构建物理表，宏结束后写出缓存供后续作业读取
+      storePhysicsTables();
     }
   }
   else {
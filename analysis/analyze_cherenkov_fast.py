@@ -41,9 +41,8 @@ sns.set_palette("husl")
 def load_and_process_data():
     """Load binary PHSP (v2, 60B), sample every SAMPLE_RATE records. Returns dict with arrays."""
     print("Loading sampled dataset from binary phase space file (v2)...\n")
-    data = read_binary_phsp(BINARY_FILE)
-    idx = np.arange(0, len(data), SAMPLE_RATE)
-    data = data[idx]
+    # columnar output (output_layout = columns): only the sampled rows are read from the .npy columns
+    data = read_binary_phsp(BINARY_FILE, step=SAMPLE_RATE)
     print(f"Loaded {len(data):,} sampled photon records (1/{SAMPLE_RATE})\n")
 
     init_x = data["initX"]
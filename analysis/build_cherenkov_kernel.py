@@ -3,7 +3,11 @@
 Build 3D Cherenkov production voxel kernel K(x,y,z) from Geant4 binary PHSP.
 
 Uses only InitialX, InitialY, InitialZ. Supports chunked reading for very large
-files. Reads run_meta.json for total_photons and N_primaries when available.
+files. Also accepts creation-only output (.creation, 40 bytes per photon), which
+records the same creation positions without optical transport. Weighted v3
+records (64 bytes, variance_reduction.photon_yield_fraction < 1) are tallied
+as sum(weight), with sigma = sqrt(sum(weight^2)) / N_primaries.
+Reads run_meta.json for total_photons and N_primaries when available.
 Outputs: kernel_01_counts.npy, kernel_02_normalized.npy, kernel_03_uncertainty.npy,
 kernel_04_voxel_edges.npz, and PNG plots (plot_01_xy_slice_center_z.png, etc.) in kernel_output/.
 
@@ -11,6 +15,12 @@ Usage:
   python build_cherenkov_kernel.py --n-primaries 52302569   # if no run_meta
   python build_cherenkov_kernel.py                         # with run_meta in same dir as phsp
   python build_cherenkov_kernel.py --phsp /path/to/file.phsp --config /path/to/config.json
+  python build_cherenkov_kernel.py --phsp /path/to/file.creation   # cherenkov_mode=creation_only
+  python build_cherenkov_kernel.py --yield /path/to/file.yield      # cherenkov_mode=yield_only
+
+With --yield the kernel is read from the Geant4 expected-yield grid (per-event
+sum and sum of squares per voxel) instead of histogramming photons: K = sum / N,
+and sigma is the standard error of the per-event mean.
 """
 
 import argparse
@@ -23,6 +33,11 @@ import matplotlib
 matplotlib.use("Agg")
 import matplotlib.pyplot as plt
 
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import chunked_output  # noqa: E402
+import columnar_output  # noqa: E402
+import compact_phsp  # noqa: E402
+
 # -----------------------------------------------------------------------------
 # Constants (v2: 60 bytes per photon, compound dtype)
 # -----------------------------------------------------------------------------
@@ -37,6 +52,19 @@ PHSP_DTYPE = np.dtype([
     ("event_id", "<u4"),
     ("track_id", "<i4"),
 ])
+# v3 (weighted, 64 bytes): v2 fields + float32 weight; written when variance reduction assigns weights
+BYTES_PER_WEIGHTED_PHOTON = 64
+PHSP_DTYPE_V3 = np.dtype(PHSP_DTYPE.descr + [("weight", "<f4")])
+# creation_only mode: 40 bytes per photon, recorded at birth (see .creation.header)
+BYTES_PER_CREATION_RECORD = 40
+CREATION_DTYPE = np.dtype([
+    ("x", "<f4"), ("y", "<f4"), ("z", "<f4"),
+    ("dirX", "<f4"), ("dirY", "<f4"), ("dirZ", "<f4"),
+    ("energy", "<f4"),
+    ("event_id", "<u4"),
+    ("track_id", "<i4"),
+    ("parent_id", "<i4"),
+])
 VOXEL_SIZE_MIN_CM = 0.3
 VOXEL_SIZE_MAX_CM = 0.8
 TARGET_BINS_LARGEST_DIM = 100
@@ -52,7 +80,9 @@ def parse_args():
     root = _script_dir()
     p = argparse.ArgumentParser(description="Build 3D Cherenkov voxel kernel from binary PHSP.")
     p.add_argument("--phsp", default=os.path.join(root, "output", "cherenkov_photons_full.phsp"),
-                   help="Path to .phsp binary file")
+                   help="Path to .phsp binary file (or .creation from cherenkov_mode=creation_only)")
+    p.add_argument("--yield", dest="yield_path", default=None,
+                   help="Path to .yield grid (cherenkov_mode=yield_only); replaces --phsp")
     p.add_argument("--config", default=os.path.join(root, "config.json"),
                    help="Path to config.json")
     p.add_argument("--output-dir", default=os.path.join(root, "kernel_output"),
@@ -72,8 +102,73 @@ def path_run_meta(phsp_path):
     return base + ".run_meta.json"
 
 
+def is_creation_file(phsp_path):
+    """True for creation-only output (<base>.creation)."""
+    return phsp_path.endswith(".creation")
+
+
+def _read_header_number(header_path, key):
+    """Return the numeric value of 'key: value' in a text header, or None if absent."""
+    if not os.path.isfile(header_path):
+        return None
+    with open(header_path, "r", encoding="utf-8") as f:
+        for line in f:
+            if ":" not in line:
+                continue
+            k, v = line.split(":", 1)
+            if k.strip().lower() == key:
+                try:
+                    return float(v.strip())
+                except ValueError:
+                    return None
+    return None
+
+
+def get_record_layout(phsp_path):
+    """
+    Return (dtype, bytes_per_record, (x_field, y_field, z_field), weight) for .phsp or .creation.
+    weight: "weight" for v3 records, a float for uniformly weighted .creation files
+    (header photon_weight), or None for analog records. With absorption_weighting or
+    direction_biasing the v3 weight also holds the survival probability / emission
+    direction weight, which do not belong in a production kernel, so the uniform
+    1/photon_yield_fraction is used instead. With importance_roulette the record weight
+    (including 1/p) is required; combined with absorption_weighting the birth weight
+    cannot be recovered and a ValueError is raised.
+    """
+    if is_creation_file(phsp_path):
+        w = _read_header_number(path_header(phsp_path), "photon_weight")
+        return CREATION_DTYPE, BYTES_PER_CREATION_RECORD, ("x", "y", "z"), (w if w not in (None, 1.0) else None)
+    header = path_header(phsp_path)
+    version = _read_header_number(header, "format_version")
+    if version in (3, 4):
+        # v4 (photon_format = compact) decodes to the v3 dtype; record_bytes is its 24-byte record
+        record_bytes = compact_phsp.RECORD_BYTES if version == 4 else BYTES_PER_WEIGHTED_PHOTON
+        if version == 4 and _read_header_number(header, "weighted") != 1:
+            return PHSP_DTYPE_V3, record_bytes, ("initX", "initY", "initZ"), None
+        if _read_header_number(header, "importance_roulette") == 1:
+            if _read_header_number(header, "absorption_weighting") == 1:
+                raise ValueError(f"{phsp_path}: importance_roulette with absorption_weighting, "
+                                 "birth weights cannot be separated from the survival probability")
+            return PHSP_DTYPE_V3, record_bytes, ("initX", "initY", "initZ"), "weight"
+        if (_read_header_number(header, "absorption_weighting") == 1 or
+                _read_header_number(header, "direction_biasing") == 1):
+            f = _read_header_number(header, "photon_yield_fraction") or 1.0
+            w = 1.0 / f
+            return PHSP_DTYPE_V3, record_bytes, ("initX", "initY", "initZ"), (w if w != 1.0 else None)
+        return PHSP_DTYPE_V3, record_bytes, ("initX", "initY", "initZ"), "weight"
+    return PHSP_DTYPE, BYTES_PER_PHOTON, ("initX", "initY", "initZ"), None
+
+
+def _is_compact(phsp_path):
+    """photon_format = compact (.phsp with format_version 4, see compact_phsp.py)."""
+    return (not is_creation_file(phsp_path) and not columnar_output.is_columnar(phsp_path)
+            and compact_phsp.is_compact(phsp_path))
+
+
 def path_header(phsp_path):
-    """Same directory, same basename, .header."""
+    """Same directory, same basename, .header (.creation -> .creation.header)."""
+    if is_creation_file(phsp_path):
+        return phsp_path + ".header"
     base = os.path.splitext(phsp_path)[0]
     return base + ".header"
 
@@ -147,10 +242,17 @@ def get_voxel_edges(bounds):
 
 
 def _validate_header_if_present(phsp_path):
-    """If .header exists, validate format_version 2 and bytes_per_photon 60."""
+    """
+    If .header exists, validate format_version 2 / bytes_per_photon 60,
+    format_version 3 / bytes_per_photon 64 (weighted), or format_version 4 / bytes_per_photon 24
+    (compact); .creation: bytes_per_record 40.
+    """
     hp = path_header(phsp_path)
     if not os.path.isfile(hp):
         return
+    if is_creation_file(phsp_path):
+        _validate_creation_header(hp)
+        return
     format_version = None
     bytes_per_photon = None
     with open(hp, "r", encoding="utf-8") as f:
@@ -171,33 +273,77 @@ def _validate_header_if_present(phsp_path):
                         except ValueError:
                             pass
                     break
-    if format_version is not None and format_version != 2:
+    supported = {2: BYTES_PER_PHOTON, 3: BYTES_PER_WEIGHTED_PHOTON, 4: compact_phsp.RECORD_BYTES}
+    if format_version is not None and format_version not in supported:
         raise ValueError(
-            f"Header format_version={format_version} is not v2; only v2 (60 bytes per photon) supported"
+            f"Header format_version={format_version} is not supported; only v2 (60 bytes), "
+            f"v3 (64 bytes, weighted) and v4 (24 bytes, compact)"
         )
-    if bytes_per_photon is not None and bytes_per_photon != 60:
+    expected_bytes = supported.get(format_version if format_version is not None else 2)
+    if bytes_per_photon is not None and bytes_per_photon != expected_bytes:
         raise ValueError(
-            f"Header bytes_per_photon={bytes_per_photon} is not 60; only v2 supported"
+            f"Header bytes_per_photon={bytes_per_photon} is not {expected_bytes} for format_version "
+            f"{format_version if format_version is not None else 2}"
         )
 
 
+def _validate_creation_header(header_path):
+    """Validate bytes_per_record 40 in a .creation.header."""
+    with open(header_path, "r", encoding="utf-8") as f:
+        for line in f:
+            line = line.strip()
+            if ":" not in line:
+                continue
+            k, v = line.split(":", 1)
+            if k.strip().lower() == "bytes_per_record":
+                try:
+                    n = int(float(v.strip()))
+                except ValueError:
+                    continue
+                if n != BYTES_PER_CREATION_RECORD:
+                    raise ValueError(
+                        f"Header bytes_per_record={n} is not {BYTES_PER_CREATION_RECORD}; "
+                        f"unsupported creation record format"
+                    )
+
+
 def get_n_photons(phsp_path, run_meta):
     """
-    Validate file_size % 60 == 0; return n_photons = file_size // 60.
+    Validate file_size % record_size == 0 (60 for .phsp, 40 for .creation);
+    return n_photons = file_size // record_size.
     If run_meta exists with total_photons, validate match.
     """
-    file_size = os.path.getsize(phsp_path)
-    if file_size % BYTES_PER_PHOTON != 0:
+    _, record_bytes, _, _ = get_record_layout(phsp_path)
+    if _is_compact(phsp_path):
+        # photon_format = compact: event frames share the record size, count from the frames
+        _validate_header_if_present(phsp_path)
+        from_file = compact_phsp.count_photons(phsp_path)[0]
+        if run_meta is not None and "total_photons" in run_meta and int(run_meta["total_photons"]) != from_file:
+            raise ValueError(f"run_meta total_photons={run_meta['total_photons']} != {from_file} photons in frames")
+        return from_file
+    if columnar_output.is_columnar(phsp_path):
+        # output_layout = columns: row count from the .npy headers
+        file_size = columnar_output.n_records(phsp_path) * record_bytes
+    elif chunked_output.is_chunked(phsp_path):
+        # output_compression = zlib: record count from the container trailer
+        info, _ = chunked_output.read_index(phsp_path)
+        if info["record_bytes"] != record_bytes:
+            raise ValueError(f"{phsp_path}: container records are {info['record_bytes']} bytes, "
+                             f"header implies {record_bytes}")
+        file_size = info["total_records"] * record_bytes
+    else:
+        file_size = os.path.getsize(phsp_path)
+    if file_size % record_bytes != 0:
         raise ValueError(
-            f"PHSP file size {file_size} is not divisible by {BYTES_PER_PHOTON}; "
-            f"expected v2 format (60 bytes per photon)"
+            f"PHSP file size {file_size} is not divisible by {record_bytes}; "
+            f"expected {record_bytes} bytes per photon"
         )
     _validate_header_if_present(phsp_path)
-    from_file = file_size // BYTES_PER_PHOTON
+    from_file = file_size // record_bytes
     if run_meta is not None and "total_photons" in run_meta:
         n_meta = int(run_meta["total_photons"])
         if n_meta != from_file:
-            raise ValueError(f"run_meta total_photons={n_meta} != file_size//60={from_file}")
+            raise ValueError(f"run_meta total_photons={n_meta} != file_size//{record_bytes}={from_file}")
         return n_meta
     return from_file
 
@@ -244,44 +390,139 @@ def get_n_primaries(run_meta, config_path, header_path, argparse_n_primaries):
     raise ValueError("N_primaries not found. Provide run_meta (with 'events'), config, or --n-primaries")
 
 
+def iter_records(phsp_path, dtype, chunk_size, fields=None):
+    """
+    Raw record stream in chunk_size pieces, the decompressed chunks of a chunked container,
+    decoded compact (v4) photons, or the given fields (default: all of dtype) of a columnar stream.
+    """
+    if columnar_output.is_columnar(phsp_path):
+        yield from columnar_output.iter_fields(phsp_path, list(fields or dtype.names), chunk_size)
+        return
+    if _is_compact(phsp_path):
+        yield from compact_phsp.iter_compact(phsp_path, chunk_size)
+        return
+    if chunked_output.is_chunked(phsp_path):
+        yield from chunked_output.iter_chunks(phsp_path, dtype)
+        return
+    with open(phsp_path, "rb") as f:
+        while True:
+            raw = f.read(chunk_size * dtype.itemsize)
+            n_read = len(raw) // dtype.itemsize
+            if n_read == 0:
+                break
+            yield np.frombuffer(raw, dtype=dtype, count=n_read)
+
+
 def build_histogram_chunked(phsp_path, edges, chunk_size):
     """
-    Read v2 phsp in chunks; extract initX, initY, initZ; np.histogramdd.
-    Returns counts (3D), and total photons read from file.
+    Read v2/v3 phsp (or .creation) in chunks; extract creation x, y, z; np.histogramdd.
+    Weighted records (v3 weight field, or uniform .creation photon_weight) are histogrammed with weights.
+    Returns counts (3D, sum of weights), records read, sumw2 (3D, sum of squared weights),
+    and total weight read (== records read for analog files).
     """
+    dtype, record_bytes, (fx, fy, fz), weight = get_record_layout(phsp_path)
     x_edges, y_edges, z_edges = edges
     bins = (x_edges, y_edges, z_edges)
     shape = (len(x_edges) - 1, len(y_edges) - 1, len(z_edges) - 1)
     counts = np.zeros(shape, dtype=np.float64)
-    bytes_per_chunk = chunk_size * BYTES_PER_PHOTON
-    file_size = os.path.getsize(phsp_path)
-    n_photons_total = file_size // BYTES_PER_PHOTON
+    sumw2 = np.zeros(shape, dtype=np.float64) if isinstance(weight, str) else None
+    if columnar_output.is_columnar(phsp_path):
+        n_photons_total = columnar_output.n_records(phsp_path)
+    elif _is_compact(phsp_path):
+        n_photons_total = compact_phsp.count_photons(phsp_path)[0]
+    elif chunked_output.is_chunked(phsp_path):
+        n_photons_total = chunked_output.read_index(phsp_path)[0]["total_records"]
+    else:
+        n_photons_total = os.path.getsize(phsp_path) // record_bytes
     total_read = 0
-    with open(phsp_path, "rb") as f:
-        chunk_idx = 0
-        while True:
-            raw = f.read(bytes_per_chunk)
-            if not raw:
-                break
-            n_read = len(raw) // BYTES_PER_PHOTON
-            if n_read == 0:
-                break
-            data = np.frombuffer(raw, dtype=PHSP_DTYPE)
-            xyz = np.column_stack([data["initX"], data["initY"], data["initZ"]])
+    total_weight = 0.0
+    chunk_idx = 0
+    # columnar output: only the position (and weight) columns are read
+    fields = [fx, fy, fz] + ([weight] if isinstance(weight, str) else [])
+    for data in iter_records(phsp_path, dtype, chunk_size, fields):
+        n_read = len(data)
+        xyz = np.column_stack([data[fx], data[fy], data[fz]])
+        if isinstance(weight, str):
+            w = data[weight].astype(np.float64)
+            H, _ = np.histogramdd(xyz, bins=bins, weights=w)
+            H2, _ = np.histogramdd(xyz, bins=bins, weights=w * w)
+            sumw2 += H2
+            total_weight += float(w.sum())
+        else:
             H, _ = np.histogramdd(xyz, bins=bins)
-            counts += H
-            total_read += n_read
-            chunk_idx += 1
-            if chunk_idx % 100 == 0 or total_read >= n_photons_total:
-                print(f"  Processed {total_read:,} / {n_photons_total:,} photons ...", end="\r")
+        counts += H
+        total_read += n_read
+        chunk_idx += 1
+        if chunk_idx % 100 == 0 or total_read >= n_photons_total:
+            print(f"  Processed {total_read:,} / {n_photons_total:,} photons ...", end="\r")
     print()
-    return counts, total_read
+    if weight is None:
+        return counts, total_read, counts, total_read
+    if not isinstance(weight, str):
+        # uniform weight (.creation photon_weight): scale counts, sumw2 = w^2 * counts
+        return counts * weight, total_read, counts * weight * weight, total_read * weight
+    return counts, total_read, sumw2, total_weight
+
+
+def read_yield_header(header_path):
+    """Parse <base>.yield.header (key: value lines) into a dict of strings."""
+    header = {}
+    with open(header_path, "r", encoding="utf-8") as f:
+        for line in f:
+            if ":" not in line or line.startswith(" "):
+                continue
+            k, v = line.split(":", 1)
+            header[k.strip().lower()] = v.strip()
+    if header.get("record_type") != "yield":
+        raise ValueError(f"{header_path}: record_type is not 'yield'")
+    if header.get("dtype", "float64") != "float64" or header.get("layout", "sum_then_sum2") != "sum_then_sum2":
+        raise ValueError(f"{header_path}: unsupported yield dtype/layout")
+    return header
+
+
+def load_yield_grid(yield_path):
+    """
+    Read .yield (float64: sum then sum2, each nx*ny*nz, C order) and its header.
+    Returns (ysum, ysum2, edges, bounds, dv, header).
+    """
+    header = read_yield_header(yield_path + ".header")
+    nx, ny, nz = int(header["nx"]), int(header["ny"]), int(header["nz"])
+    expected = 2 * nx * ny * nz * 8
+    size = os.path.getsize(yield_path)
+    if size != expected:
+        raise ValueError(f"{yield_path}: size {size} != 2*nx*ny*nz*8 = {expected}")
+    data = np.fromfile(yield_path, dtype="<f8").reshape(2, nx, ny, nz)
+    bounds = tuple(float(header[k]) for k in
+                   ("x_min_cm", "x_max_cm", "y_min_cm", "y_max_cm", "z_min_cm", "z_max_cm"))
+    edges = (
+        np.linspace(bounds[0], bounds[1], nx + 1),
+        np.linspace(bounds[2], bounds[3], ny + 1),
+        np.linspace(bounds[4], bounds[5], nz + 1),
+    )
+    dv = float(header.get("voxel_size_nominal_cm", edges[0][1] - edges[0][0]))
+    return data[0], data[1], edges, bounds, dv, header
+
+
+def compute_yield_kernel_and_uncertainty(ysum, ysum2, n_primaries):
+    """K = sum / N; sigma = standard error of the per-event mean, sqrt((sum2/N - K^2) / (N - 1))."""
+    K = ysum / n_primaries
+    if n_primaries > 1:
+        var = np.maximum(ysum2 / n_primaries - K * K, 0.0)
+        sigma = np.sqrt(var / (n_primaries - 1))
+    else:
+        sigma = np.zeros_like(K)
+    return K, sigma
 
 
-def compute_kernel_and_uncertainty(counts, n_primaries):
-    """K = counts / N_primaries; sigma = sqrt(counts) / N_primaries (zeros where counts==0)."""
+def compute_kernel_and_uncertainty(counts, n_primaries, sumw2=None):
+    """
+    K = counts / N_primaries; sigma = sqrt(sumw2) / N_primaries (zeros where counts==0).
+    For analog photons sumw2 == counts (Poisson); weighted photons pass sum of squared weights.
+    """
+    if sumw2 is None:
+        sumw2 = counts
     K = counts / n_primaries
-    sigma = np.sqrt(np.maximum(counts, 0.0)) / n_primaries
+    sigma = np.sqrt(np.maximum(sumw2, 0.0)) / n_primaries
     return K, sigma
 
 
@@ -498,13 +739,62 @@ def print_summary(n_photons, n_primaries, dv, counts, K):
     print("=" * 60)
 
 
+def main_yield(args):
+    """Kernel from a yield_only .yield grid: no photon histogram, per-event variance from sum2."""
+    yield_path = os.path.abspath(args.yield_path)
+    config_path = os.path.abspath(args.config)
+    out_dir = os.path.abspath(args.output_dir)
+    if not os.path.isfile(yield_path):
+        print(f"ERROR: yield file not found: {yield_path}", file=sys.stderr)
+        sys.exit(1)
+    if args.xy_range is not None:
+        print("WARNING: --xy-range is ignored with --yield (grid is defined by the simulation)")
+    os.makedirs(out_dir, exist_ok=True)
+    print(f"Output directory: {out_dir}")
+
+    ysum, ysum2, edges, bounds, dv, header = load_yield_grid(yield_path)
+    run_meta = load_run_meta(yield_path)
+    n_primaries = get_n_primaries(run_meta, config_path, yield_path + ".header", args.n_primaries)
+    print(f"N_primaries: {n_primaries:,}")
+    print(f"Grid shape: {ysum.shape[0]} x {ysum.shape[1]} x {ysum.shape[2]}, voxel size (dv): {dv:.4f} cm")
+
+    K, sigma = compute_yield_kernel_and_uncertainty(ysum, ysum2, n_primaries)
+    in_grid = float(ysum.sum())
+    total = in_grid + float(header.get("yield_outside_grid", 0.0))
+
+    print("Saving arrays...")
+    save_arrays(out_dir, ysum, K, sigma, edges)
+    save_kernel_stats(
+        out_dir,
+        photons_read=total,
+        photons_in_grid=in_grid,
+        n_primaries=n_primaries,
+        bounds=bounds,
+        edges=edges,
+        dv=dv,
+        counts=ysum,
+        K=K,
+        phsp_path=yield_path,
+        config_path=config_path,
+        xy_range=None,
+    )
+    water_center = tuple(0.5 * (bounds[2 * i] + bounds[2 * i + 1]) for i in range(3))
+    print("Generating plots...")
+    plot_slices_and_profiles(out_dir, K, sigma, edges, water_center, dv)
+    print_summary(total, n_primaries, dv, ysum, K)
+    print(f"Done. Outputs in: {out_dir}")
+
+
 def main():
     args = parse_args()
+    if args.yield_path is not None:
+        main_yield(args)
+        return
     phsp_path = os.path.abspath(args.phsp)
     config_path = os.path.abspath(args.config)
     out_dir = os.path.abspath(args.output_dir)
 
-    if not os.path.isfile(phsp_path):
+    if not os.path.isfile(phsp_path) and not columnar_output.is_columnar(phsp_path):
         print(f"ERROR: PHSP file not found: {phsp_path}", file=sys.stderr)
         sys.exit(1)
     if not os.path.isfile(config_path):
@@ -541,13 +831,15 @@ def main():
 
     # Chunked histogram
     print("Building 3D histogram (chunked read)...")
-    counts, total_read = build_histogram_chunked(phsp_path, edges, args.chunk_size)
+    counts, total_read, sumw2, total_weight = build_histogram_chunked(phsp_path, edges, args.chunk_size)
     n_in_grid = int(counts.sum())
     print(f"Photons read: {total_read:,}")
+    if total_weight != total_read:
+        print(f"Weighted photons read (sum of weights): {total_weight:,.1f}")
     print(f"Photons in voxel grid: {n_in_grid:,}")
 
     # K and sigma
-    K, sigma = compute_kernel_and_uncertainty(counts, n_primaries)
+    K, sigma = compute_kernel_and_uncertainty(counts, n_primaries, sumw2)
 
     # Save
     print("Saving arrays...")
@@ -556,8 +848,8 @@ def main():
     # Save kernel stats (photons outside grid, bounds, run info)
     save_kernel_stats(
         out_dir,
-        photons_read=total_read,
-        photons_in_grid=n_in_grid,
+        photons_read=total_weight,
+        photons_in_grid=float(counts.sum()) if total_weight != total_read else n_in_grid,
         n_primaries=n_primaries,
         bounds=bounds,
         edges=edges,
@@ -568,14 +860,14 @@ def main():
         config_path=config_path,
         xy_range=xy_range,
     )
-    print(f"Photons outside voxel grid: {total_read - n_in_grid:,}")
+    print(f"Photons outside voxel grid: {total_weight - counts.sum():,.0f}")
 
     # Plots
     print("Generating plots...")
     plot_slices_and_profiles(out_dir, K, sigma, edges, water_center, dv)
 
     # Summary
-    print_summary(n_photons, n_primaries, dv, counts, K)
+    print_summary(total_weight, n_primaries, dv, counts, K)
     print(f"Done. Outputs in: {out_dir}")
 
 
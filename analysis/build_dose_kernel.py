@@ -26,6 +26,10 @@ import matplotlib
 matplotlib.use("Agg")
 import matplotlib.pyplot as plt
 
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import chunked_output  # noqa: E402
+import columnar_output  # noqa: E402
+
 # -----------------------------------------------------------------------------
 # Dose file format: 36 B/record, 9 fields (see .dose.header)
 # -----------------------------------------------------------------------------
@@ -186,25 +190,50 @@ def get_n_primaries(run_meta, config_path, header_path, argparse_n_primaries):
     raise ValueError("N_primaries not found. Provide run_meta (with 'events'), config, or --n-primaries")
 
 
-def count_unique_events_chunked(dose_path, chunk_size):
-    """Chunked read, count unique event_id (for N_events). Used when bounds come from config (--use-xyz)."""
+def count_dose_records(dose_path):
+    """
+    Records in a raw .dose file (size must be a multiple of 36 B), in its columns (output_layout = columns)
+    or in a chunked container (output_compression = zlib, count from the trailer).
+    """
+    if columnar_output.is_columnar(dose_path):
+        return columnar_output.n_records(dose_path)
+    if chunked_output.is_chunked(dose_path):
+        info, _ = chunked_output.read_index(dose_path)
+        if info["record_bytes"] != BYTES_PER_RECORD:
+            raise ValueError(f"{dose_path}: container records are {info['record_bytes']} bytes, "
+                             f"expected {BYTES_PER_RECORD}")
+        return info["total_records"]
     file_size = os.path.getsize(dose_path)
-    n_total = file_size // BYTES_PER_RECORD
-    event_ids = set()
-    total_read = 0
+    if file_size % BYTES_PER_RECORD != 0:
+        raise ValueError(f"Dose file size {file_size} is not divisible by {BYTES_PER_RECORD}")
+    return file_size // BYTES_PER_RECORD
+
+
+def iter_dose_records(dose_path, chunk_size, fields):
+    """
+    Chunks of DOSE_DTYPE records; for a columnar .dose only the columns holding `fields` are read
+    (chunks then carry just these fields); a chunked container yields its decompressed chunks.
+    """
+    if columnar_output.is_columnar(dose_path):
+        yield from columnar_output.iter_fields(dose_path, list(fields), chunk_size)
+        return
+    if chunked_output.is_chunked(dose_path):
+        yield from chunked_output.iter_chunks(dose_path, DOSE_DTYPE)
+        return
     with open(dose_path, "rb") as f:
         while True:
             raw = f.read(chunk_size * BYTES_PER_RECORD)
-            if not raw:
-                break
             n_read = len(raw) // BYTES_PER_RECORD
             if n_read == 0:
                 break
-            data = np.frombuffer(raw, dtype=DOSE_DTYPE, count=n_read)
-            event_ids.update(np.unique(data["event_id"]))
-            total_read += n_read
-            if total_read >= n_total:
-                break
+            yield np.frombuffer(raw, dtype=DOSE_DTYPE, count=n_read)
+
+
+def count_unique_events_chunked(dose_path, chunk_size):
+    """Chunked read, count unique event_id (for N_events). Used when bounds come from config (--use-xyz)."""
+    event_ids = set()
+    for data in iter_dose_records(dose_path, chunk_size, ("event_id",)):
+        event_ids.update(np.unique(data["event_id"]))
     return len(event_ids)
 
 
@@ -214,32 +243,22 @@ def scan_dose_bounds_chunked(dose_path, use_xyz, chunk_size, margin_frac=0.01):
     Returns (x_min, x_max, y_min, y_max, z_min, z_max), total_records, and unique event_id count (N_events).
     margin_frac: expand range by this fraction on each side to avoid edge clipping.
     """
-    file_size = os.path.getsize(dose_path)
-    if file_size % BYTES_PER_RECORD != 0:
-        raise ValueError(f"Dose file size {file_size} is not divisible by {BYTES_PER_RECORD}")
-    n_total = file_size // BYTES_PER_RECORD
+    n_total = count_dose_records(dose_path)
     cols = ("x", "y", "z") if use_xyz else ("dx", "dy", "dz")
     x_min = y_min = z_min = np.inf
     x_max = y_max = z_max = -np.inf
     event_ids = set()
     total_read = 0
-    with open(dose_path, "rb") as f:
-        while True:
-            raw = f.read(chunk_size * BYTES_PER_RECORD)
-            if not raw:
-                break
-            n_read = len(raw) // BYTES_PER_RECORD
-            if n_read == 0:
-                break
-            data = np.frombuffer(raw, dtype=DOSE_DTYPE, count=n_read)
-            x, y, z = data[cols[0]], data[cols[1]], data[cols[2]]
-            x_min, x_max = min(x_min, float(np.min(x))), max(x_max, float(np.max(x)))
-            y_min, y_max = min(y_min, float(np.min(y))), max(y_max, float(np.max(y)))
-            z_min, z_max = min(z_min, float(np.min(z))), max(z_max, float(np.max(z)))
-            event_ids.update(np.unique(data["event_id"]))
-            total_read += n_read
-            if total_read % (chunk_size * 20) == 0 or total_read >= n_total:
-                print(f"  Bounds scan: {total_read:,} / {n_total:,} records ...", end="\r")
+    for data in iter_dose_records(dose_path, chunk_size, cols + ("event_id",)):
+        n_read = len(data)
+        x, y, z = data[cols[0]], data[cols[1]], data[cols[2]]
+        x_min, x_max = min(x_min, float(np.min(x))), max(x_max, float(np.max(x)))
+        y_min, y_max = min(y_min, float(np.min(y))), max(y_max, float(np.max(y)))
+        z_min, z_max = min(z_min, float(np.min(z))), max(z_max, float(np.max(z)))
+        event_ids.update(np.unique(data["event_id"]))
+        total_read += n_read
+        if total_read % (chunk_size * 20) == 0 or total_read >= n_total:
+            print(f"  Bounds scan: {total_read:,} / {n_total:,} records ...", end="\r")
     print()
     if total_read == 0:
         raise ValueError("Dose file is empty")
@@ -273,28 +292,20 @@ def build_dose_histogram_chunked(dose_path, edges, chunk_size, use_xyz):
     sum_w = np.zeros(shape, dtype=np.float64)
     sum_w2 = np.zeros(shape, dtype=np.float64)
     cols = ("x", "y", "z") if use_xyz else ("dx", "dy", "dz")
-    file_size = os.path.getsize(dose_path)
-    n_total = file_size // BYTES_PER_RECORD
+    n_total = count_dose_records(dose_path)
     total_read = 0
     total_energy_all = 0.0
-    with open(dose_path, "rb") as f:
-        while True:
-            raw = f.read(chunk_size * BYTES_PER_RECORD)
-            if not raw:
-                break
-            n_read = len(raw) // BYTES_PER_RECORD
-            if n_read == 0:
-                break
-            data = np.frombuffer(raw, dtype=DOSE_DTYPE, count=n_read)
-            xyz = np.column_stack([data[cols[0]], data[cols[1]], data[cols[2]]])
-            w = data["energy"].astype(np.float64)
-            H1, _ = np.histogramdd(xyz, bins=bins, weights=w)
-            H2, _ = np.histogramdd(xyz, bins=bins, weights=w * w)
-            sum_w += H1
-            sum_w2 += H2
-            total_read += n_read
-            total_energy_all += np.sum(w)
-            print(f"  Processed {total_read:,} / {n_total:,} records ...", end="\r")
+    for data in iter_dose_records(dose_path, chunk_size, cols + ("energy",)):
+        n_read = len(data)
+        xyz = np.column_stack([data[cols[0]], data[cols[1]], data[cols[2]]])
+        w = data["energy"].astype(np.float64)
+        H1, _ = np.histogramdd(xyz, bins=bins, weights=w)
+        H2, _ = np.histogramdd(xyz, bins=bins, weights=w * w)
+        sum_w += H1
+        sum_w2 += H2
+        total_read += n_read
+        total_energy_all += np.sum(w)
+        print(f"  Processed {total_read:,} / {n_total:,} records ...", end="\r")
     print()
     energy_in_grid = float(np.sum(sum_w))
     energy_outside = total_energy_all - energy_in_grid
@@ -325,8 +336,7 @@ def build_event_level_uncertainty(dose_path, edges, chunk_size, use_xyz, n_prima
     current_event_id = None
     event_xyz_list = []
     event_w_list = []
-    file_size = os.path.getsize(dose_path)
-    n_total = file_size // BYTES_PER_RECORD
+    n_total = count_dose_records(dose_path)
     total_read = 0
 
     def flush_event(eid, xyz, w):
@@ -341,29 +351,22 @@ def build_event_level_uncertainty(dose_path, edges, chunk_size, use_xyz, n_prima
         mean_e[:] = mean_e + delta / n_ev
         M2_e[:] = M2_e + delta * (H - mean_e)
 
-    with open(dose_path, "rb") as f:
-        while True:
-            raw = f.read(chunk_size * BYTES_PER_RECORD)
-            if not raw:
-                break
-            n_read = len(raw) // BYTES_PER_RECORD
-            if n_read == 0:
-                break
-            data = np.frombuffer(raw, dtype=DOSE_DTYPE, count=n_read)
-            for i in range(n_read):
-                eid = data["event_id"][i]
-                if current_event_id is not None and eid != current_event_id:
-                    flush_event(current_event_id, event_xyz_list, event_w_list)
-                    event_xyz_list = []
-                    event_w_list = []
-                current_event_id = eid
-                event_xyz_list.append([data[cols[0]][i], data[cols[1]][i], data[cols[2]][i]])
-                event_w_list.append(data["energy"][i])
-            total_read += n_read
-            if total_read % (chunk_size * 50) == 0 or total_read >= n_total:
-                print(f"  Event-level pass: {total_read:,} / {n_total:,} records ...", end="\r")
-        if current_event_id is not None:
-            flush_event(current_event_id, event_xyz_list, event_w_list)
+    for data in iter_dose_records(dose_path, chunk_size, cols + ("energy", "event_id")):
+        n_read = len(data)
+        for i in range(n_read):
+            eid = data["event_id"][i]
+            if current_event_id is not None and eid != current_event_id:
+                flush_event(current_event_id, event_xyz_list, event_w_list)
+                event_xyz_list = []
+                event_w_list = []
+            current_event_id = eid
+            event_xyz_list.append([data[cols[0]][i], data[cols[1]][i], data[cols[2]][i]])
+            event_w_list.append(data["energy"][i])
+        total_read += n_read
+        if total_read % (chunk_size * 50) == 0 or total_read >= n_total:
+            print(f"  Event-level pass: {total_read:,} / {n_total:,} records ...", end="\r")
+    if current_event_id is not None:
+        flush_event(current_event_id, event_xyz_list, event_w_list)
     print()
     n_events_used = n_ev
     # std with ddof=1: sqrt(M2 / (n-1)); sigma of mean = std / sqrt(n)
@@ -669,7 +672,7 @@ def main():
     use_xyz = not use_dxdydz  # default: (x,y,z) to match Cherenkov
     xy_range = tuple(args.xy_range) if args.xy_range is not None else None
 
-    if not os.path.isfile(dose_path):
+    if not os.path.isfile(dose_path) and not columnar_output.is_columnar(dose_path):
         print(f"ERROR: Dose file not found: {dose_path}", file=sys.stderr)
         sys.exit(1)
 
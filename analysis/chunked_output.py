@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+"""
+Reader for the chunked, compressed binary output container (simulation.output_compression = "zlib").
+
+Layout (little-endian, see include/ChunkedOutput.hh):
+  FileHeader  16 B   magic "CHERCHNK", uint16 version, codec (1 = zlib), filter (1 = byte shuffle), reserved
+  chunks             each: zlib stream of up to output_chunk_records records, byte-shuffled
+                     (byte j of every record stored together: shuffled[j * n + i] = record_i[j])
+  index       64 B   per chunk: offset, compressed_bytes, records, event_min/max, pos_min[3], pos_max[3],
+                     energy_min/max (zone map), flags, sorted by offset; flags & CHUNK_CODEC_NONE marks a
+                     chunk stored as plain records (compression failed at write time)
+  Trailer     32 B   index_offset, total_records, chunk_count, record_bytes, magic "CHERIDX1"
+
+Zone-map position: .phsp final position, .dose deposit position, .creation birth position [cm];
+energy in the record's unit (microeV for photons, MeV for dose).
+
+Usage:
+  python3 analysis/chunked_output.py output.phsp                 # chunk index summary
+  python3 analysis/chunked_output.py output.phsp --to-raw raw.phsp
+      # plain record stream for tools that expect the raw format
+  python3 analysis/chunked_output.py output.phsp --events 100 199 --to-raw subset.phsp
+      # only chunks whose event_id range overlaps [100, 199] are decompressed, then filtered exactly
+"""
+
+import argparse
+import os
+import sys
+import zlib
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+
+FILE_MAGIC = b"CHERCHNK"
+TRAILER_MAGIC = b"CHERIDX1"
+CODEC_ZLIB = 1
+FILTER_BYTE_SHUFFLE = 1
+CHUNK_CODEC_NONE = 1
+
+FILE_HEADER_DTYPE = np.dtype([
+    ("magic", "S8"), ("version", "<u2"), ("codec", "<u2"), ("filter", "<u2"), ("reserved", "<u2"),
+])
+INDEX_DTYPE = np.dtype([
+    ("offset", "<u8"), ("compressed_bytes", "<u4"), ("records", "<u4"),
+    ("event_min", "<u4"), ("event_max", "<u4"),
+    ("pos_min", "<f4", (3,)), ("pos_max", "<f4", (3,)),
+    ("energy_min", "<f4"), ("energy_max", "<f4"),
+    ("flags", "<u4"), ("reserved", "<u4"),
+])
+TRAILER_DTYPE = np.dtype([
+    ("index_offset", "<u8"), ("total_records", "<u8"), ("chunk_count", "<u4"), ("record_bytes", "<u4"),
+    ("magic", "S8"),
+])
+assert FILE_HEADER_DTYPE.itemsize == 16 and INDEX_DTYPE.itemsize == 64 and TRAILER_DTYPE.itemsize == 32
+
+PHSP_DTYPE = np.dtype([
+    ("initX", "<f4"), ("initY", "<f4"), ("initZ", "<f4"),
+    ("initDirX", "<f4"), ("initDirY", "<f4"), ("initDirZ", "<f4"),
+    ("finalX", "<f4"), ("finalY", "<f4"), ("finalZ", "<f4"),
+    ("finalDirX", "<f4"), ("finalDirY", "<f4"), ("finalDirZ", "<f4"),
+    ("finalEnergy", "<f4"), ("event_id", "<u4"), ("track_id", "<i4"),
+])
+PHSP_DTYPE_V3 = np.dtype(PHSP_DTYPE.descr + [("weight", "<f4")])
+DOSE_DTYPE = np.dtype([
+    ("x", "<f4"), ("y", "<f4"), ("z", "<f4"),
+    ("dx", "<f4"), ("dy", "<f4"), ("dz", "<f4"),
+    ("energy", "<f4"), ("event_id", "<u4"), ("pdg", "<i4"),
+])
+CREATION_DTYPE = np.dtype([
+    ("x", "<f4"), ("y", "<f4"), ("z", "<f4"),
+    ("dirX", "<f4"), ("dirY", "<f4"), ("dirZ", "<f4"),
+    ("energy", "<f4"), ("event_id", "<u4"), ("track_id", "<i4"), ("parent_id", "<i4"),
+])
+
+
+def default_dtype(path, record_bytes):
+    """Record dtype from the extension and record size (.phsp 60/64, .dose 36, .creation 40)."""
+    ext = os.path.splitext(path)[1]
+    if ext == ".dose" and record_bytes == DOSE_DTYPE.itemsize:
+        return DOSE_DTYPE
+    if ext == ".creation" and record_bytes == CREATION_DTYPE.itemsize:
+        return CREATION_DTYPE
+    for dtype in (PHSP_DTYPE, PHSP_DTYPE_V3, DOSE_DTYPE, CREATION_DTYPE):
+        if dtype.itemsize == record_bytes:
+            return dtype
+    raise ValueError(f"{path}: no known record dtype with {record_bytes} bytes")
+
+
+def is_chunked(path):
+    """True if the file starts with the container magic (raw record streams never do in practice)."""
+    with open(path, "rb") as f:
+        return f.read(len(FILE_MAGIC)) == FILE_MAGIC
+
+
+def read_index(path):
+    """Returns (trailer, index): trailer as a dict, index as a structured array (INDEX_DTYPE)."""
+    size = os.path.getsize(path)
+    if size < FILE_HEADER_DTYPE.itemsize + TRAILER_DTYPE.itemsize:
+        raise ValueError(f"{path}: too small for a chunked container ({size} bytes)")
+    with open(path, "rb") as f:
+        header = np.frombuffer(f.read(FILE_HEADER_DTYPE.itemsize), dtype=FILE_HEADER_DTYPE)[0]
+        if header["magic"] != FILE_MAGIC:
+            raise ValueError(f"{path}: not a chunked container (bad magic)")
+        if header["codec"] != CODEC_ZLIB or header["filter"] != FILTER_BYTE_SHUFFLE:
+            raise ValueError(f"{path}: unsupported codec {header['codec']} / filter {header['filter']}")
+        f.seek(size - TRAILER_DTYPE.itemsize)
+        trailer = np.frombuffer(f.read(TRAILER_DTYPE.itemsize), dtype=TRAILER_DTYPE)[0]
+        if trailer["magic"] != TRAILER_MAGIC:
+            raise ValueError(f"{path}: missing index trailer (run not finished or file truncated)")
+        n_chunks = int(trailer["chunk_count"])
+        f.seek(int(trailer["index_offset"]))
+        index = np.frombuffer(f.read(n_chunks * INDEX_DTYPE.itemsize), dtype=INDEX_DTYPE)
+    if len(index) != n_chunks:
+        raise ValueError(f"{path}: index has {len(index)} of {n_chunks} entries")
+    info = {
+        "version": int(header["version"]),
+        "record_bytes": int(trailer["record_bytes"]),
+        "total_records": int(trailer["total_records"]),
+        "chunk_count": n_chunks,
+        "index_offset": int(trailer["index_offset"]),
+    }
+    return info, index
+
+
+def select_chunks(index, events=None, pos_min=None, pos_max=None, energy=None):
+    """
+    Boolean mask of chunks whose zone map overlaps every given range:
+      events = (lo, hi) inclusive; pos_min / pos_max = 3-vectors of a box [cm] (None = unbounded per axis
+      when given as NaN); energy = (lo, hi).
+    """
+    mask = np.ones(len(index), dtype=bool)
+    if events is not None:
+        lo, hi = events
+        mask &= (index["event_max"] >= lo) & (index["event_min"] <= hi)
+    if pos_min is not None:
+        lo = np.asarray(pos_min, dtype=np.float64)
+        mask &= np.all((index["pos_max"] >= lo) | np.isnan(lo), axis=1)
+    if pos_max is not None:
+        hi = np.asarray(pos_max, dtype=np.float64)
+        mask &= np.all((index["pos_min"] <= hi) | np.isnan(hi), axis=1)
+    if energy is not None:
+        lo, hi = energy
+        mask &= (index["energy_max"] >= lo) & (index["energy_min"] <= hi)
+    return mask
+
+
+def decode_chunk(compressed, n_records, record_bytes, dtype, flags=0):
+    if flags & CHUNK_CODEC_NONE:
+        if len(compressed) != n_records * record_bytes:
+            raise ValueError(f"stored chunk has {len(compressed)} bytes, expected {n_records * record_bytes}")
+        return np.frombuffer(compressed, dtype=dtype).copy()
+    raw = zlib.decompress(compressed)
+    if len(raw) != n_records * record_bytes:
+        raise ValueError(f"chunk decompressed to {len(raw)} bytes, expected {n_records * record_bytes}")
+    shuffled = np.frombuffer(raw, dtype=np.uint8).reshape(record_bytes, n_records)
+    return np.ascontiguousarray(shuffled.T).view(dtype).reshape(n_records)
+
+
+def iter_chunks(path, dtype=None, mask=None, workers=None):
+    """
+    Yields decoded chunks (structured arrays) in file order, skipping chunks where mask is False.
+    Decompression runs in a thread pool (zlib releases the GIL); at most 2 * workers chunks are in flight.
+    """
+    info, index = read_index(path)
+    dtype = dtype if dtype is not None else default_dtype(path, info["record_bytes"])
+    if dtype.itemsize != info["record_bytes"]:
+        raise ValueError(f"{path}: dtype has {dtype.itemsize} bytes, file records have {info['record_bytes']}")
+    selected = index if mask is None else index[mask]
+    workers = workers or min(8, os.cpu_count() or 1)
+    with open(path, "rb") as f, ThreadPoolExecutor(max_workers=workers) as pool:
+        pending = []
+        for entry in selected:
+            f.seek(int(entry["offset"]))
+            compressed = f.read(int(entry["compressed_bytes"]))
+            pending.append(pool.submit(decode_chunk, compressed, int(entry["records"]), dtype.itemsize, dtype,
+                                       int(entry["flags"])))
+            if len(pending) >= 2 * workers:
+                yield pending.pop(0).result()
+        for future in pending:
+            yield future.result()
+
+
+def read_chunked(path, dtype=None, mask=None, workers=None):
+    """Whole file (or the chunks selected by mask) as one structured array."""
+    info, _ = read_index(path)
+    dtype = dtype if dtype is not None else default_dtype(path, info["record_bytes"])
+    parts = list(iter_chunks(path, dtype, mask, workers))
+    return np.concatenate(parts) if parts else np.zeros(0, dtype=dtype)
+
+
+def main():
+    p = argparse.ArgumentParser(description="Inspect / decompress a chunked binary output container")
+    p.add_argument("input", help=".phsp / .dose / .creation written with output_compression = zlib")
+    p.add_argument("--to-raw", default=None, help="Write the (selected) records as a raw record stream")
+    p.add_argument("--events", type=int, nargs=2, metavar=("LO", "HI"), default=None,
+                   help="Keep only event_id in [LO, HI] (chunks outside are not decompressed)")
+    p.add_argument("--workers", type=int, default=None, help="Decompression threads (default min(8, CPUs))")
+    args = p.parse_args()
+
+    info, index = read_index(args.input)
+    file_size = os.path.getsize(args.input)
+    raw_size = info["total_records"] * info["record_bytes"]
+    print(f"{args.input}: {info['total_records']:,} records x {info['record_bytes']} B in "
+          f"{info['chunk_count']} chunks, {file_size / 2**20:.1f} MB "
+          f"(raw {raw_size / 2**20:.1f} MB, ratio {raw_size / max(file_size, 1):.2f})")
+    if len(index):
+        print(f"  event_id {index['event_min'].min()} .. {index['event_max'].max()}, "
+              f"energy {index['energy_min'].min():.6g} .. {index['energy_max'].max():.6g}")
+        stored = int(np.count_nonzero(index["flags"] & CHUNK_CODEC_NONE))
+        if stored:
+            print(f"  {stored} chunks stored uncompressed (compression failed at write time)")
+
+    if args.to_raw is None:
+        return 0
+    mask = select_chunks(index, events=args.events) if args.events else None
+    kept = 0
+    with open(args.to_raw, "wb") as out:
+        for chunk in iter_chunks(args.input, mask=mask, workers=args.workers):
+            if args.events:
+                chunk = chunk[(chunk["event_id"] >= args.events[0]) & (chunk["event_id"] <= args.events[1])]
+            chunk.tofile(out)
+            kept += len(chunk)
+    n_read = int(index["records"][mask].sum()) if mask is not None else info["total_records"]
+    print(f"Wrote {kept:,} records to {args.to_raw} (decompressed {n_read:,})")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""
+Reader for the columnar output layout (simulation.output_layout = "columns").
+
+Instead of one record file, every field (or x/y/z field group) of a stream is written to its own
+NumPy file <path>.<column>.npy (see include/ColumnarOutput.hh); row i of every column belongs to the
+same record and the record file <path> itself is not written:
+  .phsp      init_pos (n, 3), init_dir (n, 3), final_pos (n, 3), final_dir (n, 3)  float32
+             final_energy float32 [microeV], event_id uint32, track_id int32, weight float32 (v3 only)
+  .dose      pos (n, 3), rel_pos (n, 3) float32 [cm], energy float32 [MeV], event_id uint32, pdg int32
+  .creation  pos (n, 3), dir (n, 3), energy float32 [microeV], event_id uint32, track_id, parent_id int32
+
+Columns are opened with np.load(mmap_mode="r"), so a reader that needs finalX/Y/Z only touches
+final_pos.npy. read_fields / iter_fields return structured arrays with the record field names
+(initX, finalEnergy, dx, ...), so code written for the raw records works unchanged.
+
+Usage:
+  python3 analysis/columnar_output.py output.phsp                   # columns, rows, sizes
+  python3 analysis/columnar_output.py output.phsp --to-raw raw.phsp  # record stream for the raw-format tools
+"""
+
+import argparse
+import os
+import sys
+
+import numpy as np
+
+# (column, record fields) per stream, in record order
+COLUMNS = {
+    ".phsp": [
+        ("init_pos", ("initX", "initY", "initZ")),
+        ("init_dir", ("initDirX", "initDirY", "initDirZ")),
+        ("final_pos", ("finalX", "finalY", "finalZ")),
+        ("final_dir", ("finalDirX", "finalDirY", "finalDirZ")),
+        ("final_energy", ("finalEnergy",)),
+        ("event_id", ("event_id",)),
+        ("track_id", ("track_id",)),
+        ("weight", ("weight",)),
+    ],
+    ".dose": [
+        ("pos", ("x", "y", "z")),
+        ("rel_pos", ("dx", "dy", "dz")),
+        ("energy", ("energy",)),
+        ("event_id", ("event_id",)),
+        ("pdg", ("pdg",)),
+    ],
+    ".creation": [
+        ("pos", ("x", "y", "z")),
+        ("dir", ("dirX", "dirY", "dirZ")),
+        ("energy", ("energy",)),
+        ("event_id", ("event_id",)),
+        ("track_id", ("track_id",)),
+        ("parent_id", ("parent_id",)),
+    ],
+}
+
+
+def column_path(path, column):
+    return f"{path}.{column}.npy"
+
+
+def _stream_columns(path):
+    ext = os.path.splitext(path)[1]
+    if ext not in COLUMNS:
+        raise ValueError(f"{path}: unknown stream {ext!r} (expected .phsp, .dose or .creation)")
+    return COLUMNS[ext]
+
+
+def is_columnar(path):
+    """True if <path> was written as columns: no record file, but the event_id column exists."""
+    if os.path.splitext(path)[1] not in COLUMNS:
+        return False
+    return not os.path.exists(path) and os.path.isfile(column_path(path, "event_id"))
+
+
+def field_map(path):
+    """{record field: (column, index in the column or None)} for the columns present on disk."""
+    fields = {}
+    for column, names in _stream_columns(path):
+        if not os.path.isfile(column_path(path, column)):
+            continue
+        for k, name in enumerate(names):
+            fields[name] = (column, k if len(names) > 1 else None)
+    return fields
+
+
+def open_columns(path, columns=None):
+    """{column: read-only memory map} for the requested columns (all present ones by default)."""
+    if columns is None:
+        columns = [c for c, _ in _stream_columns(path) if os.path.isfile(column_path(path, c))]
+    return {c: np.load(column_path(path, c), mmap_mode="r") for c in columns}
+
+
+def n_records(path):
+    """Row count; all columns must agree (a run that did not finish has 0-row headers)."""
+    rows = {c: len(a) for c, a in open_columns(path).items()}
+    if len(set(rows.values())) > 1:
+        raise ValueError(f"{path}: columns have different row counts {rows}")
+    return rows.get("event_id", 0)
+
+
+def read_fields(path, fields=None, start=0, stop=None, step=1):
+    """
+    Rows start:stop:step of the given record fields (all fields by default) as one structured array.
+    Only the columns holding these fields are read.
+    """
+    mapping = field_map(path)
+    if fields is None:
+        fields = list(mapping)
+    missing = [f for f in fields if f not in mapping]
+    if missing:
+        raise KeyError(f"{path}: no column holds {missing}")
+    arrays = open_columns(path, sorted({mapping[f][0] for f in fields}))
+    dtype = np.dtype([(f, arrays[mapping[f][0]].dtype) for f in fields])
+    rows = slice(start, stop, step)
+    n = len(range(n_records(path))[rows])
+    out = np.empty(n, dtype=dtype)
+    for f in fields:
+        column, k = mapping[f]
+        out[f] = arrays[column][rows] if k is None else arrays[column][rows, k]
+    return out
+
+
+def iter_fields(path, fields=None, chunk_size=1_000_000):
+    """read_fields in chunk_size row blocks."""
+    total = n_records(path)
+    for start in range(0, total, chunk_size):
+        yield read_fields(path, fields, start, min(start + chunk_size, total))
+
+
+def main():
+    p = argparse.ArgumentParser(description="Inspect / convert a columnar (output_layout = columns) stream")
+    p.add_argument("input", help="stream path as configured (.phsp / .dose / .creation); the record file itself is absent")
+    p.add_argument("--to-raw", default=None, help="Write the rows as a plain record stream")
+    args = p.parse_args()
+
+    if not is_columnar(args.input):
+        print(f"{args.input}: no columnar output found", file=sys.stderr)
+        return 1
+    total = n_records(args.input)
+    size = 0
+    print(f"{args.input}: {total:,} records")
+    for column, array in open_columns(args.input).items():
+        nbytes = os.path.getsize(column_path(args.input, column))
+        size += nbytes
+        print(f"  {column_path(args.input, column)}  {array.dtype.str} {array.shape}  {nbytes / 2**20:.1f} MB")
+    print(f"  total {size / 2**20:.1f} MB")
+    if args.to_raw is None:
+        return 0
+    with open(args.to_raw, "wb") as out:
+        for chunk in iter_fields(args.input):
+            chunk.tofile(out)
+    print(f"Wrote {total:,} records to {args.to_raw}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""
+Reader for the compact photon format (simulation.photon_format = "compact", format_version 4).
+
+Layout (little-endian, 24-byte records, see include/CompactPhoton.hh):
+  event frame   uint32 magic 0x34545645 ("EVT4"), event_id, n_photons, 3 x uint32 reserved
+  photon        uint16 initPos[3], finalPos[3]   x = min + q / 65535 * (max - min) [cm], box from .header
+                int16  initDir[2], finalDir[2]   octahedral unit vector, u = q / 32767
+                uint16 wavelength               lambda = 100 + q / 65535 * 900 [nm]
+                float16 weight
+A frame is followed by its n_photons photon records; the same event may have several frames
+(one per output buffer). track_id is not stored.
+
+Decoded records use the v3 dtype (PHSP_DTYPE_V3: float32 positions [cm], directions,
+finalEnergy [microeV], event_id, track_id = -1, weight), so every v3 consumer works unchanged.
+
+Usage:
+  python3 analysis/compact_phsp.py output.phsp                      # photon / event / precision summary
+  python3 analysis/compact_phsp.py output.phsp --to-raw output_v3.phsp
+      # 64-byte v3 records for tools that read the raw format
+"""
+
+import argparse
+import os
+import sys
+
+import numpy as np
+
+FORMAT_VERSION = 4
+RECORD_BYTES = 24
+FRAME_MAGIC = 0x34545645
+HC_EV_NM = 1239.841984
+WAVELENGTH_MIN_NM = 100.0
+WAVELENGTH_MAX_NM = 1000.0
+
+FRAME_DTYPE = np.dtype([
+    ("magic", "<u4"), ("event_id", "<u4"), ("n_photons", "<u4"), ("reserved", "<u4", (3,)),
+])
+PHOTON_DTYPE = np.dtype([
+    ("initPos", "<u2", (3,)), ("finalPos", "<u2", (3,)),
+    ("initDir", "<i2", (2,)), ("finalDir", "<i2", (2,)),
+    ("wavelength", "<u2"), ("weight", "<f2"),
+])
+assert FRAME_DTYPE.itemsize == RECORD_BYTES and PHOTON_DTYPE.itemsize == RECORD_BYTES
+
+PHSP_DTYPE_V3 = np.dtype([
+    ("initX", "<f4"), ("initY", "<f4"), ("initZ", "<f4"),
+    ("initDirX", "<f4"), ("initDirY", "<f4"), ("initDirZ", "<f4"),
+    ("finalX", "<f4"), ("finalY", "<f4"), ("finalZ", "<f4"),
+    ("finalDirX", "<f4"), ("finalDirY", "<f4"), ("finalDirZ", "<f4"),
+    ("finalEnergy", "<f4"), ("event_id", "<u4"), ("track_id", "<i4"), ("weight", "<f4"),
+])
+
+
+def path_header(phsp_path):
+    """Same directory, same basename, .header."""
+    return os.path.splitext(phsp_path)[0] + ".header"
+
+
+def _read_header(header_path):
+    values = {}
+    with open(header_path, "r", encoding="utf-8") as f:
+        for line in f:
+            if ":" not in line:
+                continue
+            k, v = line.split(":", 1)
+            try:
+                values[k.strip().lower()] = float(v.strip())
+            except ValueError:
+                pass
+    return values
+
+
+def is_compact(phsp_path):
+    """format_version 4 in the .header; without a header, the file starts with an event frame."""
+    header = path_header(phsp_path)
+    if os.path.isfile(header):
+        return _read_header(header).get("format_version") == FORMAT_VERSION
+    with open(phsp_path, "rb") as f:
+        head = f.read(4)
+    return len(head) == 4 and int(np.frombuffer(head, dtype="<u4")[0]) == FRAME_MAGIC
+
+
+def read_bounds(phsp_path):
+    """Quantization box from the .header: (min[3], max[3]) in cm."""
+    header = path_header(phsp_path)
+    if not os.path.isfile(header):
+        raise ValueError(f"{phsp_path}: compact format needs {header} for the position range")
+    values = _read_header(header)
+    try:
+        lo = np.array([values[f"position_min_{a}_cm"] for a in "xyz"])
+        hi = np.array([values[f"position_max_{a}_cm"] for a in "xyz"])
+    except KeyError as e:
+        raise ValueError(f"{header}: missing {e.args[0]}") from None
+    return lo, hi
+
+
+def decode_direction(q):
+    """Octahedral snorm16 pairs (n, 2) -> float32 unit vectors (n, 3)."""
+    u = q[:, 0].astype(np.float64) / 32767.0
+    v = q[:, 1].astype(np.float64) / 32767.0
+    z = 1.0 - np.abs(u) - np.abs(v)
+    lower = z < 0.0
+    su = np.where(u >= 0.0, 1.0, -1.0)
+    sv = np.where(v >= 0.0, 1.0, -1.0)
+    u, v = np.where(lower, (1.0 - np.abs(v)) * su, u), np.where(lower, (1.0 - np.abs(u)) * sv, v)
+    d = np.column_stack([u, v, z])
+    return (d / np.linalg.norm(d, axis=1, keepdims=True)).astype(np.float32)
+
+
+def decode_photons(raw, event_ids, bounds):
+    """PHOTON_DTYPE records + per-photon event_id -> PHSP_DTYPE_V3."""
+    lo, hi = bounds
+    step = (hi - lo) / 65535.0
+    out = np.empty(len(raw), dtype=PHSP_DTYPE_V3)
+    for prefix, field in (("init", "initPos"), ("final", "finalPos")):
+        pos = lo + raw[field].astype(np.float64) * step
+        for k, a in enumerate("XYZ"):
+            out[prefix + a] = pos[:, k]
+    for prefix, field in (("init", "initDir"), ("final", "finalDir")):
+        d = decode_direction(raw[field])
+        for k, a in enumerate("XYZ"):
+            out[prefix + "Dir" + a] = d[:, k]
+    wavelength = WAVELENGTH_MIN_NM + raw["wavelength"].astype(np.float64) * (
+        (WAVELENGTH_MAX_NM - WAVELENGTH_MIN_NM) / 65535.0)
+    out["finalEnergy"] = HC_EV_NM / wavelength * 1e6
+    out["event_id"] = event_ids
+    out["track_id"] = -1
+    out["weight"] = raw["weight"].astype(np.float32)
+    return out
+
+
+def _walk_frames(records, start):
+    """
+    Frames fully contained in records[start:]. Returns (frame_positions, n_photons, next_start);
+    next_start is the first frame that does not fit (to be read with the next block).
+    """
+    frames, counts = [], []
+    as_u32 = records.view("<u4").reshape(len(records), RECORD_BYTES // 4)
+    pos = start
+    while pos < len(records):
+        if as_u32[pos, 0] != FRAME_MAGIC:
+            raise ValueError(f"expected an event frame at record {pos}, found magic {as_u32[pos, 0]:#x}")
+        n = int(as_u32[pos, 2])
+        if pos + 1 + n > len(records):
+            break
+        frames.append(pos)
+        counts.append(n)
+        pos += 1 + n
+    return np.asarray(frames, dtype=np.int64), np.asarray(counts, dtype=np.int64), pos
+
+
+def iter_frames(phsp_path, block_records=1 << 20):
+    """Yields (raw photon records, event_id per photon) for whole frames, block by block."""
+    carry = np.zeros(0, dtype=np.dtype((np.void, RECORD_BYTES)))
+    consumed = 0
+    with open(phsp_path, "rb") as f:
+        while True:
+            raw = f.read(block_records * RECORD_BYTES)
+            if len(raw) % RECORD_BYTES:
+                raise ValueError(f"{phsp_path}: size is not a multiple of {RECORD_BYTES} bytes")
+            block = np.frombuffer(raw, dtype=carry.dtype)
+            records = np.concatenate([carry, block]) if len(carry) else block
+            if len(records) == 0:
+                return
+            frames, counts, end = _walk_frames(records, 0)
+            if len(frames):
+                frame_view = records[frames].view(FRAME_DTYPE)
+                # photon record indices: frame + 1 .. frame + n for every frame
+                total = int(counts.sum())
+                first = np.repeat(frames + 1 - np.concatenate([[0], np.cumsum(counts)[:-1]]), counts)
+                idx = first + np.arange(total)
+                yield records[idx].view(PHOTON_DTYPE), np.repeat(frame_view["event_id"], counts)
+            carry = records[end:].copy()
+            consumed += end
+            if not block.size:
+                if len(carry):
+                    raise ValueError(f"{phsp_path}: truncated frame at record {consumed}")
+                return
+
+
+def iter_compact(phsp_path, block_records=1 << 20, bounds=None):
+    """Decoded PHSP_DTYPE_V3 arrays, block by block."""
+    bounds = bounds if bounds is not None else read_bounds(phsp_path)
+    for raw, event_ids in iter_frames(phsp_path, block_records):
+        yield decode_photons(raw, event_ids, bounds)
+
+
+def read_compact_phsp(phsp_path):
+    """Whole file as one PHSP_DTYPE_V3 array."""
+    parts = list(iter_compact(phsp_path))
+    return np.concatenate(parts) if parts else np.zeros(0, dtype=PHSP_DTYPE_V3)
+
+
+def count_photons(phsp_path, block_records=1 << 20):
+    """(photons, frames) from the frame headers; photon records are not decoded."""
+    photons = 0
+    for raw, _ in iter_frames(phsp_path, block_records):
+        photons += len(raw)
+    frames = os.path.getsize(phsp_path) // RECORD_BYTES - photons
+    return photons, frames
+
+
+def main():
+    p = argparse.ArgumentParser(description="Inspect / expand a compact (format v4) phase space file")
+    p.add_argument("input", help=".phsp written with photon_format = compact")
+    p.add_argument("--to-raw", default=None, help="Write the photons as 64-byte v3 records")
+    args = p.parse_args()
+
+    lo, hi = read_bounds(args.input)
+    photons, frames = count_photons(args.input)
+    size = os.path.getsize(args.input)
+    print(f"{args.input}: {photons:,} photons in {frames:,} event frames, {size / 2**20:.1f} MB "
+          f"({size / max(photons, 1):.1f} B/photon; v3 would be {photons * PHSP_DTYPE_V3.itemsize / 2**20:.1f} MB)")
+    print(f"  position box [cm] {lo.tolist()} .. {hi.tolist()}, step {((hi - lo) / 65535.0 * 1e4).round(2).tolist()} um")
+    if args.to_raw is None:
+        return 0
+    with open(args.to_raw, "wb") as out:
+        for chunk in iter_compact(args.input, bounds=(lo, hi)):
+            chunk.tofile(out)
+    print(f"Wrote {photons:,} v3 records to {args.to_raw}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,267 @@
+#!/usr/bin/env python3
+"""
+Validate cherenkov_mode="analytic" against full Geant4 optical tracking.
+
+Both runs write v2 .phsp (60 bytes per photon; v3 weighted records are read
+too, the weight column is ignored since subsampling does not bias shapes). For each file this script
+classifies photons as absorbed (final point inside the phantom) or exited
+(final point on one of the six faces), then compares per-photon
+distributions between the two runs:
+
+  - path length |final - init| [cm]
+  - final direction cosines (finalDirX/Y/Z)
+  - photon energy
+  - exit face fractions and absorbed fraction
+  - photons per primary (when run_meta.json provides events)
+
+Each histogram is normalized per photon and compared with chi2/ndf using the
+counting errors of both samples. The run passes when every chi2/ndf is below
+--max-chi2-ndf.
+
+Weighted inputs (v3) are histogrammed with their weights and sum(w^2) errors.
+When either run used variance_reduction.optical_absorption_weighting, photons
+are never absorbed and carry exp(-L/lambda) instead: the per-photon
+distributions are then compared over exited photons only, and the absorbed
+fraction is the weight deficit sum(birth weight) - sum(exit weight).
+
+Usage:
+  python compare_analytic_transport.py --full out_full.phsp --analytic out_analytic.phsp
+  python compare_analytic_transport.py --full a.phsp --analytic b.phsp --config ../config.json --report cmp.json
+"""
+
+import argparse
+import json
+import os
+import sys
+
+import numpy as np
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from build_cherenkov_kernel import (  # noqa: E402
+    _read_header_number, get_record_layout, load_config, load_run_meta, path_header,
+)
+import compact_phsp  # noqa: E402
+
+FACE_NAMES = ["-x", "+x", "-y", "+y", "-z", "+z"]
+# float32 positions in cm: points within this distance of a face count as "on the face"
+FACE_TOLERANCE_CM = 1e-3
+DEFAULT_MAX_PHOTONS = 5_000_000
+DEFAULT_BINS = 50
+
+
+def parse_args():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    p = argparse.ArgumentParser(description="Compare analytic optical transport against full tracking.")
+    p.add_argument("--full", required=True, help=".phsp from cherenkov_mode=full")
+    p.add_argument("--analytic", required=True, help=".phsp from cherenkov_mode=analytic")
+    p.add_argument("--config", default=os.path.join(root, "config.json"), help="Path to config.json")
+    p.add_argument("--max-photons", type=int, default=DEFAULT_MAX_PHOTONS,
+                   help=f"Read at most this many photons per file (default {DEFAULT_MAX_PHOTONS})")
+    p.add_argument("--bins", type=int, default=DEFAULT_BINS, help="Histogram bins per observable")
+    p.add_argument("--max-chi2-ndf", type=float, default=2.0,
+                   help="Pass threshold for every chi2/ndf (default 2.0)")
+    p.add_argument("--report", default=None, help="Optional JSON report path")
+    return p.parse_args()
+
+
+def read_photons(phsp_path, max_photons):
+    """
+    Read up to max_photons records (photons are grouped by event, so a prefix is an unbiased subset).
+    Returns (data, n_total, exit_weight, birth_weight, absorption_weighted).
+    """
+    dtype, record_bytes, _, _ = get_record_layout(phsp_path)
+    if compact_phsp.is_compact(phsp_path):
+        # photon_format = compact: decode frame blocks until max_photons
+        n_total = compact_phsp.count_photons(phsp_path)[0]
+        count = n_total if max_photons is None or max_photons <= 0 else min(n_total, max_photons)
+        parts, n_read = [], 0
+        for block in compact_phsp.iter_compact(phsp_path):
+            parts.append(block[:count - n_read])
+            n_read += len(parts[-1])
+            if n_read >= count:
+                break
+        data = np.concatenate(parts) if parts else np.zeros(0, dtype=dtype)
+    else:
+        file_size = os.path.getsize(phsp_path)
+        if file_size % record_bytes != 0:
+            raise ValueError(f"{phsp_path}: size {file_size} is not a multiple of {record_bytes}")
+        n_total = file_size // record_bytes
+        count = n_total if max_photons is None or max_photons <= 0 else min(n_total, max_photons)
+        data = np.fromfile(phsp_path, dtype=dtype, count=count)
+    header = path_header(phsp_path)
+    absorption_weighted = _read_header_number(header, "absorption_weighting") == 1
+    if "weight" not in dtype.names:
+        w = np.ones(len(data))
+        return data, n_total, w, w, False
+    w = data["weight"].astype(np.float64)
+    if _read_header_number(header, "importance_roulette") == 1:
+        # Roulette weights 1/p belong to the birth weight (absorption weighting excluded by get_record_layout)
+        return data, n_total, w, w, False
+    if absorption_weighted or _read_header_number(header, "direction_biasing") == 1:
+        # Exit records keep the full weight; the birth weight is just 1/f (direction weights average to 1)
+        f = _read_header_number(header, "photon_yield_fraction") or 1.0
+        return data, n_total, w, np.full(len(data), 1.0 / f), absorption_weighted
+    return data, n_total, w, w, False
+
+
+def classify_faces(data, water_size, water_pos):
+    """Return face index 0..5 per photon (see FACE_NAMES), or -1 for absorbed inside the phantom."""
+    final = np.column_stack([data["finalX"], data["finalY"], data["finalZ"]]).astype(np.float64)
+    center = np.asarray(water_pos, dtype=np.float64)
+    half = 0.5 * np.asarray(water_size, dtype=np.float64)
+    rel = final - center
+    # distance to the nearest plane on each axis, and which side
+    dist = half - np.abs(rel)
+    axis = np.argmin(dist, axis=1)
+    on_face = dist[np.arange(len(final)), axis] <= FACE_TOLERANCE_CM
+    side = (rel[np.arange(len(final)), axis] > 0).astype(np.int64)
+    face = np.where(on_face, 2 * axis + side, -1)
+    return face
+
+
+def observables(data):
+    init = np.column_stack([data["initX"], data["initY"], data["initZ"]]).astype(np.float64)
+    final = np.column_stack([data["finalX"], data["finalY"], data["finalZ"]]).astype(np.float64)
+    return {
+        "path_length_cm": np.linalg.norm(final - init, axis=1),
+        "finalDirX": data["finalDirX"].astype(np.float64),
+        "finalDirY": data["finalDirY"].astype(np.float64),
+        "finalDirZ": data["finalDirZ"].astype(np.float64),
+        "finalEnergy": data["finalEnergy"].astype(np.float64),
+    }
+
+
+def chi2_ndf(counts_a, counts_b, var_a=None, var_b=None):
+    """Chi2/ndf between two histograms after normalizing each to unit area (var = counts unless weighted)."""
+    na, nb = counts_a.sum(), counts_b.sum()
+    if na == 0 or nb == 0:
+        return float("nan"), 0
+    var_a = counts_a if var_a is None else var_a
+    var_b = counts_b if var_b is None else var_b
+    pa, pb = counts_a / na, counts_b / nb
+    var = var_a / na**2 + var_b / nb**2
+    mask = var > 0
+    ndf = int(mask.sum()) - 1
+    if ndf <= 0:
+        return 0.0, 0
+    chi2 = float(np.sum((pa[mask] - pb[mask]) ** 2 / var[mask]))
+    return chi2 / ndf, ndf
+
+
+def fate_histogram(face, exit_weight, birth_weight):
+    """Bin 0 = absorbed (weight deficit), bins 1..6 = faces. Returns (sum_w, sum_w2)."""
+    w_exit = np.where(face >= 0, exit_weight, 0.0)
+    idx = np.where(face >= 0, face + 1, 0)
+    h = np.bincount(idx, weights=w_exit, minlength=7)
+    h2 = np.bincount(idx, weights=w_exit ** 2, minlength=7)
+    lost = birth_weight - w_exit
+    h[0] = lost.sum()
+    h2[0] = (lost ** 2).sum()
+    return h, h2
+
+
+def compare(full, analytic, water_size, water_pos, bins):
+    """full/analytic: (data, exit_weight, birth_weight, absorption_weighted) tuples."""
+    (d_full, w_full, b_full, aw_full), (d_an, w_an, b_an, aw_an) = full, analytic
+    face_full = classify_faces(d_full, water_size, water_pos)
+    face_an = classify_faces(d_an, water_size, water_pos)
+    # With absorption weighting no photon ends inside the phantom; compare exits only
+    exits_only = aw_full or aw_an
+    sel_full = face_full >= 0 if exits_only else np.ones(len(d_full), dtype=bool)
+    sel_an = face_an >= 0 if exits_only else np.ones(len(d_an), dtype=bool)
+
+    results = {}
+    obs_full, obs_an = observables(d_full[sel_full]), observables(d_an[sel_an])
+    wf, wa = w_full[sel_full], w_an[sel_an]
+    for name in obs_full:
+        both = np.concatenate([obs_full[name], obs_an[name]])
+        if len(both) == 0:
+            results[name] = {"chi2_ndf": float("nan"), "ndf": 0, "mean_full": float("nan"),
+                             "mean_analytic": float("nan")}
+            continue
+        lo, hi = float(both.min()), float(both.max())
+        if hi <= lo:
+            hi = lo + 1.0
+        edges = np.linspace(lo, hi, bins + 1)
+        h_full, _ = np.histogram(obs_full[name], bins=edges, weights=wf)
+        h_an, _ = np.histogram(obs_an[name], bins=edges, weights=wa)
+        v_full, _ = np.histogram(obs_full[name], bins=edges, weights=wf ** 2)
+        v_an, _ = np.histogram(obs_an[name], bins=edges, weights=wa ** 2)
+        c, ndf = chi2_ndf(h_full, h_an, v_full, v_an)
+        results[name] = {
+            "chi2_ndf": c, "ndf": ndf,
+            "mean_full": float(np.average(obs_full[name], weights=wf)) if wf.sum() > 0 else float("nan"),
+            "mean_analytic": float(np.average(obs_an[name], weights=wa)) if wa.sum() > 0 else float("nan"),
+        }
+
+    h_full, v_full = fate_histogram(face_full, w_full, b_full)
+    h_an, v_an = fate_histogram(face_an, w_an, b_an)
+    c, ndf = chi2_ndf(h_full, h_an, v_full, v_an)
+    labels = ["absorbed"] + FACE_NAMES
+    results["fate"] = {
+        "chi2_ndf": c, "ndf": ndf,
+        "fraction_full": {k: float(v) for k, v in zip(labels, h_full / max(h_full.sum(), 1))},
+        "fraction_analytic": {k: float(v) for k, v in zip(labels, h_an / max(h_an.sum(), 1))},
+    }
+    return results
+
+
+def photons_per_primary(phsp_path, n_total, birth_weight):
+    meta = load_run_meta(phsp_path)
+    if meta is None or not meta.get("events") or len(birth_weight) == 0:
+        return None
+    # records x mean birth weight (1/photon_yield_fraction when subsampled)
+    return n_total * float(birth_weight.mean()) / float(meta["events"])
+
+
+def main():
+    args = parse_args()
+    water_size, water_pos = load_config(args.config)
+    full, n_full, w_full, b_full, aw_full = read_photons(args.full, args.max_photons)
+    analytic, n_an, w_an, b_an, aw_an = read_photons(args.analytic, args.max_photons)
+    if len(full) == 0 or len(analytic) == 0:
+        print("ERROR: one of the inputs has no photons")
+        return 1
+
+    results = compare((full, w_full, b_full, aw_full), (analytic, w_an, b_an, aw_an),
+                      water_size, water_pos, args.bins)
+    ppp_full = photons_per_primary(args.full, n_full, b_full)
+    ppp_an = photons_per_primary(args.analytic, n_an, b_an)
+
+    print("=== Analytic vs full optical transport ===")
+    print(f"Full:     {args.full} ({len(full):,} of {n_full:,} photons)")
+    print(f"Analytic: {args.analytic} ({len(analytic):,} of {n_an:,} photons)")
+    if aw_full or aw_an:
+        print("Absorption-weighted input: per-photon observables use exited photons only")
+    if ppp_full is not None and ppp_an is not None:
+        print(f"Photons per primary: full={ppp_full:.4f}  analytic={ppp_an:.4f}")
+    print(f"{'observable':<16} {'chi2/ndf':>10} {'ndf':>5} {'mean full':>14} {'mean analytic':>14}")
+    passed = True
+    for name, r in results.items():
+        ok = np.isfinite(r["chi2_ndf"]) and r["chi2_ndf"] < args.max_chi2_ndf
+        passed = passed and ok
+        if name == "fate":
+            print(f"{name:<16} {r['chi2_ndf']:>10.3f} {r['ndf']:>5d}")
+            for k in r["fraction_full"]:
+                print(f"  {k:<14} {r['fraction_full'][k]:>14.5f} {r['fraction_analytic'][k]:>14.5f}")
+        else:
+            print(f"{name:<16} {r['chi2_ndf']:>10.3f} {r['ndf']:>5d} "
+                  f"{r['mean_full']:>14.5g} {r['mean_analytic']:>14.5g}")
+    print("RESULT:", "PASS" if passed else "FAIL", f"(threshold chi2/ndf < {args.max_chi2_ndf})")
+
+    if args.report:
+        report = {
+            "full": args.full, "analytic": args.analytic,
+            "photons_compared_full": int(len(full)), "photons_compared_analytic": int(len(analytic)),
+            "photons_per_primary_full": ppp_full, "photons_per_primary_analytic": ppp_an,
+            "absorption_weighted_full": bool(aw_full), "absorption_weighted_analytic": bool(aw_an),
+            "max_chi2_ndf": args.max_chi2_ndf, "passed": bool(passed), "observables": results,
+        }
+        with open(args.report, "w", encoding="utf-8") as f:
+            json.dump(report, f, indent=2)
+        print(f"Report: {args.report}")
+    return 0 if passed else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
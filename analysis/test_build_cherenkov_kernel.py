@@ -16,6 +16,14 @@ PHSP_DTYPE = np.dtype([
     ("finalEnergy", "<f4"), ("event_id", "<u4"), ("track_id", "<i4"),
 ])
 
+PHSP_DTYPE_V3 = np.dtype(PHSP_DTYPE.descr + [("weight", "<f4")])
+
+CREATION_DTYPE = np.dtype([
+    ("x", "<f4"), ("y", "<f4"), ("z", "<f4"),
+    ("dirX", "<f4"), ("dirY", "<f4"), ("dirZ", "<f4"),
+    ("energy", "<f4"), ("event_id", "<u4"), ("track_id", "<i4"), ("parent_id", "<i4"),
+])
+
 def _script_dir():
     return os.path.dirname(os.path.abspath(__file__))
 
@@ -79,6 +87,196 @@ def test_build_cherenkov_kernel():
         assert stats["photons_read"] == n_photons
         assert stats["n_primaries"] == n_primaries
 
+def test_build_cherenkov_kernel_creation_only():
+    """cherenkov_mode=creation_only: 40B .creation records, same kernel pipeline."""
+    n_primaries, n_photons = 10, 200
+    with tempfile.TemporaryDirectory() as tmp:
+        base = os.path.join(tmp, "test")
+        creation_path = base + ".creation"
+        out_dir = os.path.join(tmp, "out")
+        os.makedirs(out_dir)
+        np.random.seed(7)
+        data = np.zeros(n_photons, dtype=CREATION_DTYPE)
+        data["x"] = np.random.uniform(-5, 5, n_photons).astype(np.float32)
+        data["y"] = np.random.uniform(-5, 5, n_photons).astype(np.float32)
+        data["z"] = np.random.uniform(25, 35, n_photons).astype(np.float32)
+        data["dirZ"] = 1.0
+        data["energy"] = 2.0e6
+        data["event_id"] = np.random.randint(0, n_primaries, n_photons, dtype=np.uint32)
+        data["track_id"] = np.arange(2, n_photons + 2, dtype=np.int32)
+        data["parent_id"] = 1
+        data.tofile(creation_path)
+        assert os.path.getsize(creation_path) == 40 * n_photons
+        with open(base + ".run_meta.json", "w") as f:
+            json.dump({"events": n_primaries, "total_photons": n_photons}, f)
+        with open(creation_path + ".header", "w") as f:
+            f.write("record_type: creation\nbytes_per_record: 40\n")
+        config_path = os.path.join(_project_root(), "config.json")
+        ok, stdout, stderr = run_build_cherenkov_kernel(creation_path, config_path, out_dir, n_primaries)
+        if not ok:
+            print("STDOUT:", stdout)
+            print("STDERR:", stderr)
+            assert ok
+        counts = np.load(os.path.join(out_dir, "kernel_01_counts.npy"))
+        with open(os.path.join(out_dir, "kernel_stats.json")) as f:
+            stats = json.load(f)
+        assert stats["photons_read"] == n_photons
+        assert counts.sum() == n_photons
+
+def test_build_cherenkov_kernel_yield():
+    """cherenkov_mode=yield_only: float64 sum/sum2 grid -> K = sum/N, sigma from per-event variance."""
+    n_events = 50
+    nx, ny, nz = 4, 3, 2
+    with tempfile.TemporaryDirectory() as tmp:
+        base = os.path.join(tmp, "test")
+        yield_path = base + ".yield"
+        out_dir = os.path.join(tmp, "out")
+        os.makedirs(out_dir)
+        rng = np.random.default_rng(3)
+        per_event = rng.exponential(2.0, (n_events, nx, ny, nz))
+        ysum = per_event.sum(axis=0)
+        ysum2 = (per_event ** 2).sum(axis=0)
+        np.stack([ysum, ysum2]).astype("<f8").tofile(yield_path)
+        with open(yield_path + ".header", "w") as f:
+            f.write("record_type: yield\ndtype: float64\nlayout: sum_then_sum2\n")
+            f.write(f"nx: {nx}\nny: {ny}\nnz: {nz}\n")
+            f.write("x_min_cm: -2\nx_max_cm: 2\ny_min_cm: -1.5\ny_max_cm: 1.5\nz_min_cm: 20\nz_max_cm: 22\n")
+            f.write(f"voxel_size_nominal_cm: 1.0\nevents: {n_events}\nyield_outside_grid: 0\n")
+        with open(base + ".run_meta.json", "w") as f:
+            json.dump({"events": n_events, "total_photons": 0}, f)
+        script = os.path.join(_script_dir(), "build_cherenkov_kernel.py")
+        cmd = [sys.executable, script, "--yield", yield_path,
+               "--config", os.path.join(_project_root(), "config.json"), "--output-dir", out_dir]
+        result = subprocess.run(cmd, capture_output=True, text=True, cwd=_script_dir())
+        if result.returncode != 0:
+            print("STDOUT:", result.stdout)
+            print("STDERR:", result.stderr)
+            assert result.returncode == 0
+        K = np.load(os.path.join(out_dir, "kernel_02_normalized.npy"))
+        sigma = np.load(os.path.join(out_dir, "kernel_03_uncertainty.npy"))
+        assert K.shape == (nx, ny, nz)
+        assert np.allclose(K, per_event.mean(axis=0))
+        assert np.allclose(sigma, per_event.std(axis=0, ddof=1) / np.sqrt(n_events))
+        with open(os.path.join(out_dir, "kernel_stats.json")) as f:
+            stats = json.load(f)
+        assert stats["grid_shape"] == [nx, ny, nz]
+        assert stats["n_primaries"] == n_events
+
+def test_build_cherenkov_kernel_weighted_v3():
+    """photon_yield_fraction < 1: 64B v3 records, K = sum(w)/N, sigma = sqrt(sum(w^2))/N."""
+    n_primaries, n_photons = 10, 200
+    with tempfile.TemporaryDirectory() as tmp:
+        base = os.path.join(tmp, "test")
+        phsp_path = base + ".phsp"
+        out_dir = os.path.join(tmp, "out")
+        os.makedirs(out_dir)
+        rng = np.random.default_rng(11)
+        data = np.zeros(n_photons, dtype=PHSP_DTYPE_V3)
+        data["initX"] = rng.uniform(-5, 5, n_photons)
+        data["initY"] = rng.uniform(-5, 5, n_photons)
+        data["initZ"] = rng.uniform(25, 35, n_photons)
+        data["initDirZ"] = 1.0
+        data["finalEnergy"] = 2.0e6
+        data["event_id"] = rng.integers(0, n_primaries, n_photons).astype(np.uint32)
+        data["track_id"] = np.arange(1, n_photons + 1, dtype=np.int32)
+        data["weight"] = rng.choice([2.0, 4.0], n_photons)
+        data.tofile(phsp_path)
+        assert os.path.getsize(phsp_path) == 64 * n_photons
+        with open(base + ".run_meta.json", "w") as f:
+            json.dump({"events": n_primaries, "total_photons": n_photons}, f)
+        with open(base + ".header", "w") as f:
+            f.write("format_version: 3\nbytes_per_photon: 64\n")
+        config_path = os.path.join(_project_root(), "config.json")
+        ok, stdout, stderr = run_build_cherenkov_kernel(phsp_path, config_path, out_dir, n_primaries)
+        if not ok:
+            print("STDOUT:", stdout)
+            print("STDERR:", stderr)
+            assert ok
+        K = np.load(os.path.join(out_dir, "kernel_02_normalized.npy"))
+        sigma = np.load(os.path.join(out_dir, "kernel_03_uncertainty.npy"))
+        w = data["weight"].astype(np.float64)
+        assert np.isclose(K.sum() * n_primaries, w.sum())
+        assert np.isclose((sigma ** 2).sum() * n_primaries ** 2, (w ** 2).sum())
+        with open(os.path.join(out_dir, "kernel_stats.json")) as f:
+            stats = json.load(f)
+        assert np.isclose(stats["photons_read"], w.sum())
+
+def test_build_cherenkov_kernel_direction_biased_v3():
+    """direction_biasing: record weights hold emission-direction weights; the kernel uses 1/f only."""
+    n_primaries, n_photons = 10, 200
+    with tempfile.TemporaryDirectory() as tmp:
+        base = os.path.join(tmp, "test")
+        phsp_path = base + ".phsp"
+        out_dir = os.path.join(tmp, "out")
+        os.makedirs(out_dir)
+        rng = np.random.default_rng(12)
+        data = np.zeros(n_photons, dtype=PHSP_DTYPE_V3)
+        data["initX"] = rng.uniform(-5, 5, n_photons)
+        data["initY"] = rng.uniform(-5, 5, n_photons)
+        data["initZ"] = rng.uniform(25, 35, n_photons)
+        data["initDirZ"] = 1.0
+        data["finalEnergy"] = 2.0e6
+        data["event_id"] = rng.integers(0, n_primaries, n_photons).astype(np.uint32)
+        data["track_id"] = np.arange(1, n_photons + 1, dtype=np.int32)
+        data["weight"] = 2.0 * rng.choice([0.25, 3.0], n_photons)
+        data.tofile(phsp_path)
+        with open(base + ".run_meta.json", "w") as f:
+            json.dump({"events": n_primaries, "total_photons": n_photons}, f)
+        with open(base + ".header", "w") as f:
+            f.write("format_version: 3\nbytes_per_photon: 64\nphoton_yield_fraction: 0.5\n"
+                    "absorption_weighting: 0\ndirection_biasing: 1\n")
+        config_path = os.path.join(_project_root(), "config.json")
+        ok, stdout, stderr = run_build_cherenkov_kernel(phsp_path, config_path, out_dir, n_primaries)
+        if not ok:
+            print("STDOUT:", stdout)
+            print("STDERR:", stderr)
+            assert ok
+        K = np.load(os.path.join(out_dir, "kernel_02_normalized.npy"))
+        assert np.isclose(K.sum() * n_primaries, 2.0 * n_photons)
+
+def test_build_cherenkov_kernel_importance_roulette_v3():
+    """importance_roulette: the production kernel keeps the per-record 1/p weights."""
+    n_primaries, n_photons = 10, 200
+    with tempfile.TemporaryDirectory() as tmp:
+        base = os.path.join(tmp, "test")
+        phsp_path = base + ".phsp"
+        out_dir = os.path.join(tmp, "out")
+        os.makedirs(out_dir)
+        rng = np.random.default_rng(13)
+        data = np.zeros(n_photons, dtype=PHSP_DTYPE_V3)
+        data["initX"] = rng.uniform(-5, 5, n_photons)
+        data["initY"] = rng.uniform(-5, 5, n_photons)
+        data["initZ"] = rng.uniform(25, 35, n_photons)
+        data["initDirZ"] = 1.0
+        data["finalEnergy"] = 2.0e6
+        data["event_id"] = rng.integers(0, n_primaries, n_photons).astype(np.uint32)
+        data["track_id"] = np.arange(1, n_photons + 1, dtype=np.int32)
+        data["weight"] = rng.choice([1.0, 10.0, 50.0], n_photons)
+        data.tofile(phsp_path)
+        with open(base + ".run_meta.json", "w") as f:
+            json.dump({"events": n_primaries, "total_photons": n_photons}, f)
+        with open(base + ".header", "w") as f:
+            f.write("format_version: 3\nbytes_per_photon: 64\nphoton_yield_fraction: 1\n"
+                    "absorption_weighting: 0\ndirection_biasing: 0\nimportance_roulette: 1\n")
+        config_path = os.path.join(_project_root(), "config.json")
+        ok, stdout, stderr = run_build_cherenkov_kernel(phsp_path, config_path, out_dir, n_primaries)
+        if not ok:
+            print("STDOUT:", stdout)
+            print("STDERR:", stderr)
+            assert ok
+        K = np.load(os.path.join(out_dir, "kernel_02_normalized.npy"))
+        assert np.isclose(K.sum() * n_primaries, data["weight"].astype(np.float64).sum())
+
 if __name__ == "__main__":
     test_build_cherenkov_kernel()
     print("test_build_cherenkov_kernel: OK")
+    test_build_cherenkov_kernel_creation_only()
+    print("test_build_cherenkov_kernel_creation_only: OK")
+    test_build_cherenkov_kernel_yield()
+    print("test_build_cherenkov_kernel_yield: OK")
+    test_build_cherenkov_kernel_weighted_v3()
+    print("test_build_cherenkov_kernel_weighted_v3: OK")
+    test_build_cherenkov_kernel_direction_biased_v3()
+    print("test_build_cherenkov_kernel_direction_biased_v3: OK")
+    test_build_cherenkov_kernel_importance_roulette_v3()
+    print("test_build_cherenkov_kernel_importance_roulette_v3: OK")
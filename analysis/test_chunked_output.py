@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Tests for chunked_output.py (chunked, zlib-compressed .phsp container) and its use in build_cherenkov_kernel."""
+
+import os
+import subprocess
+import sys
+import tempfile
+import zlib
+
+import numpy as np
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import chunked_output as co  # noqa: E402
+from build_cherenkov_kernel import build_histogram_chunked, get_n_photons  # noqa: E402
+from build_dose_kernel import build_dose_histogram_chunked, count_dose_records, count_unique_events_chunked  # noqa: E402
+
+
+def _script_dir():
+    return os.path.dirname(os.path.abspath(__file__))
+
+
+def make_photons(n, n_events, seed=0):
+    rng = np.random.default_rng(seed)
+    data = np.zeros(n, dtype=co.PHSP_DTYPE)
+    for axis in "XYZ":
+        data["init" + axis] = rng.uniform(-5.0, 5.0, n)
+        data["final" + axis] = rng.uniform(-30.0, 30.0, n)
+    data["initDirZ"] = 1.0
+    data["finalDirZ"] = 1.0
+    data["finalEnergy"] = rng.uniform(2.0e6, 4.0e6, n)
+    data["event_id"] = np.sort(rng.integers(0, n_events, n)).astype(np.uint32)
+    data["track_id"] = np.arange(1, n + 1, dtype=np.int32)
+    return data
+
+
+def write_container(path, data, chunk_records, shuffle_order=None, stored_chunks=()):
+    """
+    Same layout as AsyncWriter/ChunkedOutput: header, byte-shuffled zlib chunks, zone-map index, trailer.
+    Chunks numbered in stored_chunks are written as plain records with CHUNK_CODEC_NONE (failed compression).
+    """
+    header = np.zeros(1, dtype=co.FILE_HEADER_DTYPE)
+    header["magic"] = co.FILE_MAGIC
+    header["version"] = 1
+    header["codec"] = co.CODEC_ZLIB
+    header["filter"] = co.FILTER_BYTE_SHUFFLE
+    starts = list(range(0, len(data), chunk_records))
+    if shuffle_order is not None:
+        starts = [starts[i] for i in shuffle_order]  # pwrite mode: chunks land in completion order
+    entries = np.zeros(len(starts), dtype=co.INDEX_DTYPE)
+    with open(path, "wb") as f:
+        header.tofile(f)
+        for k, start in enumerate(starts):
+            chunk = data[start:start + chunk_records]
+            shuffled = chunk.view(np.uint8).reshape(len(chunk), -1).T.tobytes()
+            compressed = chunk.tobytes() if k in stored_chunks else zlib.compress(shuffled, 1)
+            e = entries[k]
+            e["flags"] = co.CHUNK_CODEC_NONE if k in stored_chunks else 0
+            e["offset"] = f.tell()
+            e["compressed_bytes"] = len(compressed)
+            e["records"] = len(chunk)
+            e["event_min"], e["event_max"] = chunk["event_id"].min(), chunk["event_id"].max()
+            # zone map: final position / energy for .phsp, deposit position / energy for .dose
+            px, py, pz, energy = (("finalX", "finalY", "finalZ", "finalEnergy") if "finalX" in data.dtype.names
+                                  else ("x", "y", "z", "energy"))
+            pos = np.column_stack([chunk[px], chunk[py], chunk[pz]])
+            e["pos_min"], e["pos_max"] = pos.min(axis=0), pos.max(axis=0)
+            e["energy_min"], e["energy_max"] = chunk[energy].min(), chunk[energy].max()
+            f.write(compressed)
+        entries.sort(order="offset")
+        trailer = np.zeros(1, dtype=co.TRAILER_DTYPE)
+        trailer["index_offset"] = f.tell()
+        trailer["total_records"] = len(data)
+        trailer["chunk_count"] = len(entries)
+        trailer["record_bytes"] = data.dtype.itemsize
+        trailer["magic"] = co.TRAILER_MAGIC
+        entries.tofile(f)
+        trailer.tofile(f)
+
+
+def test_chunked_roundtrip_to_raw():
+    with tempfile.TemporaryDirectory() as tmp:
+        data = make_photons(25000, 400)
+        path = os.path.join(tmp, "out.phsp")
+        raw = os.path.join(tmp, "raw.phsp")
+        write_container(path, data, chunk_records=4096, shuffle_order=[3, 0, 5, 1, 6, 2, 4], stored_chunks=(2,))
+        assert co.is_chunked(path)
+        info, index = co.read_index(path)
+        assert info["total_records"] == len(data) and info["chunk_count"] == 7
+        assert np.count_nonzero(index["flags"] & co.CHUNK_CODEC_NONE) == 1
+        assert np.all(np.diff(index["offset"].astype(np.int64)) > 0)
+        result = subprocess.run([sys.executable, os.path.join(_script_dir(), "chunked_output.py"), path,
+                                 "--to-raw", raw], capture_output=True, text=True)
+        assert result.returncode == 0, result.stderr
+        back = np.fromfile(raw, dtype=co.PHSP_DTYPE)
+        # chunks come back in file order: same records, reordered by chunk
+        assert len(back) == len(data)
+        assert np.array_equal(np.sort(back, order="track_id"), data)
+
+
+def test_chunked_event_selection_skips_chunks():
+    with tempfile.TemporaryDirectory() as tmp:
+        data = make_photons(40000, 1000, seed=1)
+        path = os.path.join(tmp, "out.phsp")
+        write_container(path, data, chunk_records=2000)
+        _, index = co.read_index(path)
+        mask = co.select_chunks(index, events=(500, 509))
+        assert 0 < mask.sum() <= 2
+        subset = co.read_chunked(path, mask=mask, workers=2)
+        sel = subset[(subset["event_id"] >= 500) & (subset["event_id"] <= 509)]
+        expected = data[(data["event_id"] >= 500) & (data["event_id"] <= 509)]
+        assert np.array_equal(sel, expected)
+        # a box outside every final position selects nothing
+        assert not co.select_chunks(index, pos_min=[100.0, np.nan, np.nan]).any()
+
+
+def test_kernel_histogram_chunked_matches_raw():
+    with tempfile.TemporaryDirectory() as tmp:
+        data = make_photons(30000, 300, seed=2)
+        raw = os.path.join(tmp, "raw.phsp")
+        packed = os.path.join(tmp, "packed.phsp")
+        data.tofile(raw)
+        write_container(packed, data, chunk_records=5000)
+        edges = tuple(np.linspace(-5.0, 5.0, 11) for _ in range(3))
+        counts_raw, n_raw, _, _ = build_histogram_chunked(raw, edges, chunk_size=7000)
+        counts_packed, n_packed, _, _ = build_histogram_chunked(packed, edges, chunk_size=7000)
+        assert n_raw == n_packed == len(data)
+        assert np.array_equal(counts_raw, counts_packed)
+        assert get_n_photons(packed, {"total_photons": len(data)}) == len(data)
+        assert os.path.getsize(packed) < os.path.getsize(raw)
+
+
+def test_dose_kernel_chunked_matches_raw():
+    with tempfile.TemporaryDirectory() as tmp:
+        rng = np.random.default_rng(3)
+        n = 18000
+        dose = np.zeros(n, dtype=co.DOSE_DTYPE)
+        for name in ("x", "y", "z", "dx", "dy", "dz"):
+            dose[name] = rng.uniform(-5.0, 5.0, n)
+        dose["energy"] = rng.exponential(0.1, n)
+        dose["event_id"] = np.sort(rng.integers(0, 250, n)).astype(np.uint32)
+        dose["pdg"] = 11
+        raw = os.path.join(tmp, "raw.dose")
+        packed = os.path.join(tmp, "packed.dose")
+        dose.tofile(raw)
+        write_container(packed, dose, chunk_records=4000, stored_chunks=(1,))
+        assert count_dose_records(packed) == count_dose_records(raw) == n
+        assert count_unique_events_chunked(packed, 1000) == count_unique_events_chunked(raw, 1000)
+        edges = tuple(np.linspace(-5.0, 5.0, 9) for _ in range(3))
+        packed_result = build_dose_histogram_chunked(packed, edges, 1000, use_xyz=True)
+        raw_result = build_dose_histogram_chunked(raw, edges, 1000, use_xyz=True)
+        # chunks of 4000 vs reads of 1000 records: same sums up to the summation order
+        assert np.allclose(packed_result[0], raw_result[0]) and np.allclose(packed_result[1], raw_result[1])
+        assert packed_result[4] == raw_result[4] == n
+
+
+if __name__ == "__main__":
+    test_chunked_roundtrip_to_raw()
+    print("test_chunked_roundtrip_to_raw: OK")
+    test_chunked_event_selection_skips_chunks()
+    print("test_chunked_event_selection_skips_chunks: OK")
+    test_kernel_histogram_chunked_matches_raw()
+    print("test_kernel_histogram_chunked_matches_raw: OK")
+    test_dose_kernel_chunked_matches_raw()
+    print("test_dose_kernel_chunked_matches_raw: OK")
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Tests for columnar_output.py (output_layout = columns, one .npy per field) and its use in the kernel builders."""
+
+import os
+import subprocess
+import sys
+import tempfile
+
+import numpy as np
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import columnar_output as col  # noqa: E402
+from build_cherenkov_kernel import build_histogram_chunked, get_n_photons  # noqa: E402
+from build_dose_kernel import DOSE_DTYPE, build_dose_histogram_chunked, count_unique_events_chunked  # noqa: E402
+
+PHSP_DTYPE_V3 = np.dtype([
+    ("initX", "<f4"), ("initY", "<f4"), ("initZ", "<f4"),
+    ("initDirX", "<f4"), ("initDirY", "<f4"), ("initDirZ", "<f4"),
+    ("finalX", "<f4"), ("finalY", "<f4"), ("finalZ", "<f4"),
+    ("finalDirX", "<f4"), ("finalDirY", "<f4"), ("finalDirZ", "<f4"),
+    ("finalEnergy", "<f4"), ("event_id", "<u4"), ("track_id", "<i4"), ("weight", "<f4"),
+])
+
+
+def _script_dir():
+    return os.path.dirname(os.path.abspath(__file__))
+
+
+def npy_header(descr, shape):
+    """Fixed 128-byte NPY v1.0 header, as ColumnarOutput::MakeHeader writes it."""
+    text = "{'descr': '%s', 'fortran_order': False, 'shape': (%d,%s), }" % (
+        descr, shape[0], " %d" % shape[1] if len(shape) > 1 else "")
+    text = text.ljust(117) + "\n"
+    return b"\x93NUMPY\x01\x00" + (118).to_bytes(2, "little") + text.encode("latin1")
+
+
+def write_columns(path, records, buffer_records):
+    """
+    Same files as AsyncWriter::OpenColumns / WriteColumns / CloseColumns: 0-row placeholder header,
+    one block of rows per submitted buffer, final header with the row count. The record file is absent.
+    """
+    layout = dict(col.COLUMNS[os.path.splitext(path)[1]])
+    columns = [(c, names) for c, names in layout.items() if names[0] in records.dtype.names]
+    files = {}
+    for c, names in columns:
+        f = open(col.column_path(path, c), "wb")
+        f.write(npy_header(records.dtype[names[0]].str, (0, len(names)) if len(names) > 1 else (0,)))
+        files[c] = f
+    for start in range(0, len(records), buffer_records):
+        block = records[start:start + buffer_records]
+        for c, names in columns:
+            files[c].write(np.column_stack([block[n] for n in names]).astype(block.dtype[names[0]]).tobytes())
+    for c, names in columns:
+        files[c].seek(0)
+        files[c].write(npy_header(records.dtype[names[0]].str, (len(records), len(names)) if len(names) > 1
+                                  else (len(records),)))
+        files[c].close()
+
+
+def make_photons(n, seed=0):
+    rng = np.random.default_rng(seed)
+    data = np.zeros(n, dtype=PHSP_DTYPE_V3)
+    for name in PHSP_DTYPE_V3.names:
+        data[name] = rng.uniform(-30.0, 30.0, n)
+    data["event_id"] = np.sort(rng.integers(0, 50, n)).astype(np.uint32)
+    data["track_id"] = rng.integers(1, 1000, n)
+    data["weight"] = rng.uniform(0.5, 4.0, n)
+    return data
+
+
+def test_columnar_roundtrip_subsets_and_to_raw():
+    with tempfile.TemporaryDirectory() as tmp:
+        data = make_photons(5000)
+        path = os.path.join(tmp, "out.phsp")
+        write_columns(path, data, buffer_records=777)
+        assert col.is_columnar(path)
+        assert col.n_records(path) == len(data)
+        pos = np.load(col.column_path(path, "final_pos"), mmap_mode="r")
+        assert pos.shape == (len(data), 3) and pos.dtype == np.float32
+        whole = col.read_fields(path)
+        assert whole.dtype == PHSP_DTYPE_V3
+        assert np.array_equal(whole, data)
+        part = col.read_fields(path, ["finalZ", "event_id"], start=10, step=7)
+        assert part.dtype.names == ("finalZ", "event_id")
+        assert np.array_equal(part["finalZ"], data["finalZ"][10::7])
+        assert np.array_equal(np.concatenate(list(col.iter_fields(path, ["weight"], chunk_size=600)))["weight"],
+                              data["weight"])
+        raw = os.path.join(tmp, "raw.phsp")
+        result = subprocess.run([sys.executable, os.path.join(_script_dir(), "columnar_output.py"), path,
+                                 "--to-raw", raw], capture_output=True, text=True)
+        assert result.returncode == 0, result.stderr
+        assert np.array_equal(np.fromfile(raw, dtype=PHSP_DTYPE_V3), data)
+        # a record file next to the columns (e.g. a later run with output_layout = records) takes precedence
+        data[:10].tofile(path)
+        assert not col.is_columnar(path)
+
+
+def test_kernel_histogram_columnar_matches_raw():
+    with tempfile.TemporaryDirectory() as tmp:
+        data = make_photons(20000, seed=1)
+        columns = os.path.join(tmp, "col.phsp")
+        raw = os.path.join(tmp, "raw.phsp")
+        write_columns(columns, data, buffer_records=3000)
+        data.tofile(raw)
+        for base in ("col", "raw"):
+            with open(os.path.join(tmp, base + ".header"), "w", encoding="utf-8") as f:
+                f.write("format_version: 3\nbytes_per_photon: 64\n")
+        edges = tuple(np.linspace(-30.0, 30.0, 11) for _ in range(3))
+        counts_col, n_col, sumw2_col, w_col = build_histogram_chunked(columns, edges, chunk_size=4096)
+        counts_raw, n_raw, sumw2_raw, w_raw = build_histogram_chunked(raw, edges, chunk_size=4096)
+        assert n_col == n_raw == len(data)
+        assert np.allclose(counts_col, counts_raw) and np.allclose(sumw2_col, sumw2_raw) and np.isclose(w_col, w_raw)
+        assert get_n_photons(columns, {"total_photons": len(data)}) == len(data)
+
+
+def test_dose_kernel_columnar_matches_raw():
+    with tempfile.TemporaryDirectory() as tmp:
+        rng = np.random.default_rng(2)
+        n = 12000
+        dose = np.zeros(n, dtype=DOSE_DTYPE)
+        for name in ("x", "y", "z", "dx", "dy", "dz"):
+            dose[name] = rng.uniform(-5.0, 5.0, n)
+        dose["energy"] = rng.exponential(0.1, n)
+        dose["event_id"] = np.sort(rng.integers(0, 300, n)).astype(np.uint32)
+        dose["pdg"] = 11
+        columns = os.path.join(tmp, "col.dose")
+        raw = os.path.join(tmp, "raw.dose")
+        write_columns(columns, dose, buffer_records=2500)
+        dose.tofile(raw)
+        assert count_unique_events_chunked(columns, 1000) == count_unique_events_chunked(raw, 1000)
+        edges = tuple(np.linspace(-5.0, 5.0, 9) for _ in range(3))
+        col_result = build_dose_histogram_chunked(columns, edges, 1000, use_xyz=True)
+        raw_result = build_dose_histogram_chunked(raw, edges, 1000, use_xyz=True)
+        assert np.array_equal(col_result[0], raw_result[0]) and np.array_equal(col_result[1], raw_result[1])
+        assert col_result[4] == raw_result[4] == n
+
+
+if __name__ == "__main__":
+    test_columnar_roundtrip_subsets_and_to_raw()
+    print("test_columnar_roundtrip_subsets_and_to_raw: OK")
+    test_kernel_histogram_columnar_matches_raw()
+    print("test_kernel_histogram_columnar_matches_raw: OK")
+    test_dose_kernel_columnar_matches_raw()
+    print("test_dose_kernel_columnar_matches_raw: OK")
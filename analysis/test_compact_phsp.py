@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+"""Tests for compact_phsp.py (photon_format = compact, format v4) and its use in build_cherenkov_kernel."""
+
+import os
+import subprocess
+import sys
+import tempfile
+
+import numpy as np
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import compact_phsp as cp  # noqa: E402
+from build_cherenkov_kernel import build_histogram_chunked, get_n_photons, get_record_layout  # noqa: E402
+
+BOX_MIN = np.array([-30.0, -30.0, -10.0])
+BOX_MAX = np.array([30.0, 30.0, 50.0])
+
+
+def _script_dir():
+    return os.path.dirname(os.path.abspath(__file__))
+
+
+# Same table as bench/bench_compact_codec.cc (kReference): position [cm], direction, energy [eV], weight ->
+# position code, direction code, wavelength code, weight (float16 bits), clamped.
+# The C++ check encodes these with CompactPhotonCodec; both sides must agree on every code.
+REFERENCE_VECTORS = [
+    ((0.0, 0.0, 20.0), (0.0, 0.0, 1.0), 2.5, 1.0, (32768, 32768, 32768), (0, 0), 28831, 0x3C00, False),
+    ((-12.345, 7.5, -3.25), (0.6, -0.48, 0.64), 1.9, 3.3, (19284, 40959, 7373), (11430, -9144), 40235, 0x429A, False),
+    ((29.999, -29.999, 49.9), (-0.36, 0.48, -0.8), 4.1, 0.25, (65534, 1, 65426), (-23177, 25574), 14738, 0x3400,
+     False),
+    ((5.0, 5.0, 5.0), (0.0, -1.0, 0.0), 3.0, 65510.0, (38229, 38229, 16384), (0, -32767), 22812, 0x7BFF, False),
+    ((31.0, -40.0, 20.0), (0.0, 0.0, -1.0), 2.0, 1.0, (65535, 0, 32768), (32767, 32767), 37859, 0x3C00, True),
+    ((0.0, 0.0, 0.0), (0.8, 0.0, -0.6), 13.0, 1.0, (32768, 32768, 10922), (32767, 14043), 0, 0x3C00, True),
+    ((0.0, 0.0, 0.0), (0.28, 0.96, 0.0), 2.0, 70000.0, (32768, 32768, 10922), (7399, 25368), 37859, 0x7BFF, True),
+    ((1.0, 2.0, 3.0), (-0.48, -0.6, -0.64), 2.2, 4.0e-6, (33860, 34952, 14199), (-21337, -23623), 33755, 0x0043,
+     False),
+]
+
+
+def random_units(rng, n):
+    v = rng.normal(size=(n, 3))
+    return v / np.linalg.norm(v, axis=1, keepdims=True)
+
+
+def make_photons(n_events, seed=0):
+    """Reference photons in double precision: positions [cm], unit directions, energy [eV], event_id, weight."""
+    rng = np.random.default_rng(seed)
+    counts = rng.integers(1, 400, n_events)
+    n = int(counts.sum())
+    return {
+        "init": BOX_MIN + rng.uniform(0.0, 1.0, (n, 3)) * (BOX_MAX - BOX_MIN),
+        "final": BOX_MIN + rng.uniform(0.0, 1.0, (n, 3)) * (BOX_MAX - BOX_MIN),
+        "init_dir": random_units(rng, n),
+        "final_dir": random_units(rng, n),
+        "energy_ev": rng.uniform(1.6, 5.5, n),
+        "event_id": np.repeat(np.arange(n_events, dtype=np.uint32), counts),
+        "weight": rng.uniform(0.5, 40.0, n),
+    }
+
+
+def encode_direction(d):
+    """Same mapping as CompactPhotonCodec::EncodeDirection."""
+    norm = np.abs(d).sum(axis=1)
+    u, v = d[:, 0] / norm, d[:, 1] / norm
+    lower = d[:, 2] < 0.0
+    fu = (1.0 - np.abs(v)) * np.where(u >= 0.0, 1.0, -1.0)
+    fv = (1.0 - np.abs(u)) * np.where(v >= 0.0, 1.0, -1.0)
+    u, v = np.where(lower, fu, u), np.where(lower, fv, v)
+    return np.rint(np.column_stack([u, v]) * 32767.0).astype(np.int16)
+
+
+def encode(photons, frame_records):
+    """Frames + photon records as PhotonBuffer writes them: a new frame per event and per buffer."""
+    n = len(photons["event_id"])
+    raw = np.zeros(n, dtype=cp.PHOTON_DTYPE)
+    scale = 65535.0 / (BOX_MAX - BOX_MIN)
+    raw["initPos"] = np.rint((photons["init"] - BOX_MIN) * scale).astype(np.uint16)
+    raw["finalPos"] = np.rint((photons["final"] - BOX_MIN) * scale).astype(np.uint16)
+    raw["initDir"] = encode_direction(photons["init_dir"])
+    raw["finalDir"] = encode_direction(photons["final_dir"])
+    wavelength = cp.HC_EV_NM / photons["energy_ev"]
+    raw["wavelength"] = np.rint((wavelength - cp.WAVELENGTH_MIN_NM) * 65535.0 /
+                                (cp.WAVELENGTH_MAX_NM - cp.WAVELENGTH_MIN_NM)).astype(np.uint16)
+    raw["weight"] = photons["weight"].astype(np.float16)
+    out = []
+    used = 0
+    i = 0
+    while i < n:
+        if used + 2 > frame_records:
+            used = 0  # buffer flushed: frames never span buffers
+        ev = photons["event_id"][i]
+        j = i
+        while j < n and photons["event_id"][j] == ev and used + 1 + (j - i + 1) <= frame_records:
+            j += 1
+        frame = np.zeros(1, dtype=cp.FRAME_DTYPE)
+        frame["magic"] = cp.FRAME_MAGIC
+        frame["event_id"] = ev
+        frame["n_photons"] = j - i
+        out.append(frame.view(np.uint8))
+        out.append(raw[i:j].view(np.uint8))
+        used += 1 + (j - i)
+        i = j
+    return np.concatenate(out)
+
+
+def write_compact(path, photons, frame_records=1000, weighted=True):
+    encode(photons, frame_records).tofile(path)
+    with open(os.path.splitext(path)[0] + ".header", "w", encoding="utf-8") as f:
+        f.write("format_version: 4\nbytes_per_photon: 24\n")
+        for k, axis in enumerate("xyz"):
+            f.write(f"position_min_{axis}_cm: {BOX_MIN[k]}\nposition_max_{axis}_cm: {BOX_MAX[k]}\n")
+        f.write(f"weighted: {int(weighted)}\nphoton_yield_fraction: 1\n")
+
+
+def test_compact_roundtrip_precision():
+    with tempfile.TemporaryDirectory() as tmp:
+        photons = make_photons(200)
+        path = os.path.join(tmp, "out.phsp")
+        write_compact(path, photons)
+        n = len(photons["event_id"])
+        assert os.path.getsize(path) < 25 * n  # 24 B per photon + one frame per event / buffer
+        data = cp.read_compact_phsp(path)
+        assert len(data) == n
+        assert np.array_equal(data["event_id"], photons["event_id"])
+        assert np.all(data["track_id"] == -1)
+        step = (BOX_MAX - BOX_MIN) / 65535.0
+        for prefix in ("init", "final"):
+            pos = np.column_stack([data[prefix + a] for a in "XYZ"]).astype(np.float64)
+            assert np.all(np.abs(pos - photons[prefix]) <= 0.5 * step + 1e-5)
+            d = np.column_stack([data[prefix + "Dir" + a] for a in "XYZ"]).astype(np.float64)
+            d /= np.linalg.norm(d, axis=1, keepdims=True)
+            angle = np.arccos(np.clip((d * photons[prefix + "_dir"]).sum(axis=1), -1.0, 1.0))
+            assert angle.max() < 1e-4
+        energy_ev = data["finalEnergy"].astype(np.float64) * 1e-6
+        assert np.abs(energy_ev / photons["energy_ev"] - 1.0).max() < 5e-5
+        assert np.abs(data["weight"] / photons["weight"] - 1.0).max() <= 2.0 ** -11
+
+
+def test_codec_reference_vectors():
+    rows = REFERENCE_VECTORS
+    pos = np.array([r[0] for r in rows])
+    photons = {
+        "init": pos, "final": pos,
+        "init_dir": np.array([r[1] for r in rows]), "final_dir": np.array([r[1] for r in rows]),
+        "energy_ev": np.array([r[2] for r in rows]), "event_id": np.zeros(len(rows), dtype=np.uint32),
+        "weight": np.array([r[3] for r in rows]),
+    }
+    with np.errstate(over="ignore"):
+        encoded = encode(photons, frame_records=len(rows) + 1)[cp.RECORD_BYTES:].view(cp.PHOTON_DTYPE)
+    codes = np.zeros(len(rows), dtype=cp.PHOTON_DTYPE)
+    for i, r in enumerate(rows):
+        codes[i] = (r[4], r[4], r[5], r[5], r[6], np.uint16(r[7]).view(np.float16))
+    # the test encoder does not clamp; in-range rows must match the C++ codes exactly
+    in_range = ~np.array([r[8] for r in rows])
+    assert np.array_equal(encoded[in_range].view(np.uint8), codes[in_range].view(np.uint8))
+    decoded = cp.decode_photons(codes, photons["event_id"], (BOX_MIN, BOX_MAX))
+    step = (BOX_MAX - BOX_MIN) / 65535.0
+    clipped = np.clip(pos, BOX_MIN, BOX_MAX)
+    assert np.all(np.abs(np.column_stack([decoded["final" + a] for a in "XYZ"]) - clipped) <= 0.5 * step + 1e-5)
+    energy_ev = decoded["finalEnergy"].astype(np.float64) * 1e-6
+    in_band = photons["energy_ev"] < cp.HC_EV_NM / cp.WAVELENGTH_MIN_NM
+    assert np.abs(energy_ev[in_band] / photons["energy_ev"][in_band] - 1.0).max() < 5e-5
+    assert np.all(decoded["weight"] <= 65504.0)
+
+
+def test_compact_frames_across_blocks_and_to_raw():
+    with tempfile.TemporaryDirectory() as tmp:
+        photons = make_photons(150, seed=1)
+        path = os.path.join(tmp, "out.phsp")
+        raw = os.path.join(tmp, "raw.phsp")
+        write_compact(path, photons, frame_records=257)  # events split over several frames
+        n_frames = os.path.getsize(path) // cp.RECORD_BYTES - len(photons["event_id"])
+        assert n_frames > 150
+        whole = cp.read_compact_phsp(path)
+        small = np.concatenate(list(cp.iter_compact(path, block_records=100)))
+        assert np.array_equal(whole, small)
+        assert cp.count_photons(path) == (len(whole), n_frames)
+        result = subprocess.run([sys.executable, os.path.join(_script_dir(), "compact_phsp.py"), path,
+                                 "--to-raw", raw], capture_output=True, text=True)
+        assert result.returncode == 0, result.stderr
+        assert np.array_equal(np.fromfile(raw, dtype=cp.PHSP_DTYPE_V3), whole)
+
+
+def test_kernel_histogram_compact_matches_decoded():
+    with tempfile.TemporaryDirectory() as tmp:
+        photons = make_photons(100, seed=2)
+        photons["weight"][:] = 1.0  # analog run: the stored weights are all 1
+        packed = os.path.join(tmp, "packed.phsp")
+        raw = os.path.join(tmp, "raw.phsp")
+        write_compact(packed, photons, weighted=False)
+        decoded = cp.read_compact_phsp(packed)
+        decoded.tofile(raw)
+        with open(os.path.join(tmp, "raw.header"), "w", encoding="utf-8") as f:
+            f.write("format_version: 3\nbytes_per_photon: 64\n")
+        assert get_record_layout(packed)[3] is None  # unweighted compact file: plain counts
+        edges = tuple(np.linspace(lo, hi, 13) for lo, hi in zip(BOX_MIN, BOX_MAX))
+        counts_packed, n_packed, _, _ = build_histogram_chunked(packed, edges, chunk_size=5000)
+        counts_raw, n_raw, _, _ = build_histogram_chunked(raw, edges, chunk_size=5000)
+        assert n_packed == n_raw == len(decoded)
+        assert np.array_equal(counts_packed, counts_raw)
+        assert get_n_photons(packed, {"total_photons": len(decoded)}) == len(decoded)
+
+
+if __name__ == "__main__":
+    test_compact_roundtrip_precision()
+    print("test_compact_roundtrip_precision: OK")
+    test_codec_reference_vectors()
+    print("test_codec_reference_vectors: OK")
+    test_compact_frames_across_blocks_and_to_raw()
+    print("test_compact_frames_across_blocks_and_to_raw: OK")
+    test_kernel_histogram_compact_matches_decoded()
+    print("test_kernel_histogram_compact_matches_decoded: OK")
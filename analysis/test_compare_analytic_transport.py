@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Regression tests for compare_analytic_transport.py (analytic vs full optical transport)."""
+
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import numpy as np
+
+PHSP_DTYPE = np.dtype([
+    ("initX", "<f4"), ("initY", "<f4"), ("initZ", "<f4"),
+    ("initDirX", "<f4"), ("initDirY", "<f4"), ("initDirZ", "<f4"),
+    ("finalX", "<f4"), ("finalY", "<f4"), ("finalZ", "<f4"),
+    ("finalDirX", "<f4"), ("finalDirY", "<f4"), ("finalDirZ", "<f4"),
+    ("finalEnergy", "<f4"), ("event_id", "<u4"), ("track_id", "<i4"),
+])
+PHSP_DTYPE_V3 = np.dtype(PHSP_DTYPE.descr + [("weight", "<f4")])
+
+# config.json phantom: 60 x 60 x 20 cm centered at (0, 0, 30)
+HALF = np.array([30.0, 30.0, 10.0])
+CENTER = np.array([0.0, 0.0, 30.0])
+
+def _script_dir():
+    return os.path.dirname(os.path.abspath(__file__))
+
+def _project_root():
+    return os.path.dirname(_script_dir())
+
+def create_straight_line_phsp(path, seed, n_photons=4000, abs_length_cm=30.0, n_events=20,
+                              absorption_weighted=False):
+    """
+    Isotropic photons in the phantom, straight line to the box or to an exponential absorption point.
+    absorption_weighted: every photon reaches the box with weight exp(-L/lambda) (v3 records).
+    """
+    rng = np.random.default_rng(seed)
+    init = CENTER + rng.uniform(-0.5, 0.5, (n_photons, 3)) * HALF
+    d = rng.normal(size=(n_photons, 3))
+    d /= np.linalg.norm(d, axis=1)[:, None]
+    with np.errstate(divide="ignore"):
+        t_planes = (CENTER + np.sign(d) * HALF - init) / d
+    t_exit = np.min(np.where(np.isfinite(t_planes), t_planes, np.inf), axis=1)
+    t_abs = rng.exponential(abs_length_cm, n_photons)
+    t = t_exit if absorption_weighted else np.minimum(t_exit, t_abs)
+    data = np.zeros(n_photons, dtype=PHSP_DTYPE_V3 if absorption_weighted else PHSP_DTYPE)
+    for i, axis in enumerate("XYZ"):
+        data["init" + axis] = init[:, i]
+        data["initDir" + axis] = d[:, i]
+        data["final" + axis] = init[:, i] + t * d[:, i]
+        data["finalDir" + axis] = d[:, i]
+    data["finalEnergy"] = rng.uniform(2.0e6, 4.0e6, n_photons)
+    data["event_id"] = np.sort(rng.integers(0, n_events, n_photons)).astype(np.uint32)
+    data["track_id"] = np.arange(1, n_photons + 1, dtype=np.int32)
+    if absorption_weighted:
+        data["weight"] = np.exp(-t_exit / abs_length_cm)
+        with open(os.path.splitext(path)[0] + ".header", "w") as f:
+            f.write("format_version: 3\nbytes_per_photon: 64\n"
+                    "photon_yield_fraction: 1\nabsorption_weighting: 1\n")
+    data.tofile(path)
+    with open(os.path.splitext(path)[0] + ".run_meta.json", "w") as f:
+        json.dump({"events": n_events, "total_photons": n_photons}, f)
+
+def run_compare(full, analytic, report):
+    script = os.path.join(_script_dir(), "compare_analytic_transport.py")
+    cmd = [sys.executable, script, "--full", full, "--analytic", analytic,
+           "--config", os.path.join(_project_root(), "config.json"), "--report", report]
+    result = subprocess.run(cmd, capture_output=True, text=True, cwd=_script_dir())
+    return result.returncode, result.stdout, result.stderr
+
+def test_compare_analytic_transport_same_physics_passes():
+    with tempfile.TemporaryDirectory() as tmp:
+        full = os.path.join(tmp, "full.phsp")
+        analytic = os.path.join(tmp, "analytic.phsp")
+        report = os.path.join(tmp, "cmp.json")
+        create_straight_line_phsp(full, seed=1)
+        create_straight_line_phsp(analytic, seed=2)
+        rc, stdout, stderr = run_compare(full, analytic, report)
+        if rc != 0:
+            print("STDOUT:", stdout)
+            print("STDERR:", stderr)
+        assert rc == 0
+        with open(report) as f:
+            r = json.load(f)
+        assert r["passed"]
+        fate = r["observables"]["fate"]["fraction_full"]
+        assert 0.0 < fate["absorbed"] < 1.0
+        assert abs(sum(fate.values()) - 1.0) < 1e-9
+
+def test_compare_analytic_transport_detects_wrong_absorption():
+    with tempfile.TemporaryDirectory() as tmp:
+        full = os.path.join(tmp, "full.phsp")
+        analytic = os.path.join(tmp, "analytic.phsp")
+        report = os.path.join(tmp, "cmp.json")
+        create_straight_line_phsp(full, seed=1, abs_length_cm=30.0)
+        create_straight_line_phsp(analytic, seed=2, abs_length_cm=5.0)
+        rc, _, _ = run_compare(full, analytic, report)
+        assert rc == 1
+        with open(report) as f:
+            r = json.load(f)
+        assert not r["passed"]
+        assert r["observables"]["path_length_cm"]["chi2_ndf"] > 2.0
+
+def test_compare_analytic_transport_absorption_weighted():
+    """Analytic run with absorption weighting (no absorbed photons, exit weights) vs analog full run."""
+    with tempfile.TemporaryDirectory() as tmp:
+        full = os.path.join(tmp, "full.phsp")
+        analytic = os.path.join(tmp, "analytic.phsp")
+        report = os.path.join(tmp, "cmp.json")
+        create_straight_line_phsp(full, seed=1, n_photons=20000)
+        create_straight_line_phsp(analytic, seed=2, absorption_weighted=True)
+        rc, stdout, stderr = run_compare(full, analytic, report)
+        if rc != 0:
+            print("STDOUT:", stdout)
+            print("STDERR:", stderr)
+        assert rc == 0
+        with open(report) as f:
+            r = json.load(f)
+        assert r["absorption_weighted_analytic"] and not r["absorption_weighted_full"]
+        fate = r["observables"]["fate"]
+        assert abs(fate["fraction_full"]["absorbed"] - fate["fraction_analytic"]["absorbed"]) < 0.03
+
+if __name__ == "__main__":
+    test_compare_analytic_transport_same_physics_passes()
+    print("test_compare_analytic_transport_same_physics_passes: OK")
+    test_compare_analytic_transport_detects_wrong_absorption()
+    print("test_compare_analytic_transport_detects_wrong_absorption: OK")
+    test_compare_analytic_transport_absorption_weighted()
+    print("test_compare_analytic_transport_absorption_weighted: OK")
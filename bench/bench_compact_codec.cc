@@ -0,0 +1,161 @@
+//
+// bench_compact_codec.cc - 紧凑光子格式（v4）编码的一致性检查与微基准
+//
+// 1. 参考向量：固定的一组光子（含越界位置/波长/权重）的编码结果必须与表中的码字完全一致。
+//    同一张表在 analysis/test_compact_phsp.py（test_codec_reference_vectors）中用 Python 的
+//    编码/解码核对，任一侧改动了量化方式都会有一侧失败。
+// 2. EncodeHalf：全部有限 half 值解码后再编码必须得到原码字，且不报截断；溢出 / 非有限值报截断。
+// 3. 每光子编码耗时（位置 ×2、方向 ×2、波长、权重）。
+// 有不一致时打印并返回 1。
+//
+// 用法: bench_compact_codec [photons]
+//   cmake -DBUILD_BENCHMARKS=ON .. && make bench_compact_codec && ./bench_compact_codec 10000000
+//
+
+#include "CompactPhoton.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+// 与 analysis/test_compact_phsp.py 的 BOX_MIN / BOX_MAX 相同 [cm]
+const double kBoxMin[3] = {-30.0, -30.0, -10.0};
+const double kBoxMax[3] = {30.0, 30.0, 50.0};
+
+struct ReferencePhoton {
+  double pos[3];       // [cm]
+  double dir[3];
+  double energyEv;
+  float weight;
+  uint16_t posQ[3];
+  int16_t dirQ[2];
+  uint16_t wavelengthQ;
+  uint16_t weightQ;
+  G4bool clamped;
+};
+
+// 与 analysis/test_compact_phsp.py 的 REFERENCE_VECTORS 相同
+const ReferencePhoton kReference[] = {
+  {{0.0, 0.0, 20.0}, {0.0, 0.0, 1.0}, 2.5, 1.0f, {32768, 32768, 32768}, {0, 0}, 28831, 0x3c00, false},
+  {{-12.345, 7.5, -3.25}, {0.6, -0.48, 0.64}, 1.9, 3.3f, {19284, 40959, 7373}, {11430, -9144}, 40235, 0x429a, false},
+  {{29.999, -29.999, 49.9}, {-0.36, 0.48, -0.8}, 4.1, 0.25f, {65534, 1, 65426}, {-23177, 25574}, 14738, 0x3400, false},
+  {{5.0, 5.0, 5.0}, {0.0, -1.0, 0.0}, 3.0, 65510.0f, {38229, 38229, 16384}, {0, -32767}, 22812, 0x7bff, false},
+  {{31.0, -40.0, 20.0}, {0.0, 0.0, -1.0}, 2.0, 1.0f, {65535, 0, 32768}, {32767, 32767}, 37859, 0x3c00, true},
+  {{0.0, 0.0, 0.0}, {0.8, 0.0, -0.6}, 13.0, 1.0f, {32768, 32768, 10922}, {32767, 14043}, 0, 0x3c00, true},
+  {{0.0, 0.0, 0.0}, {0.28, 0.96, 0.0}, 2.0, 70000.0f, {32768, 32768, 10922}, {7399, 25368}, 37859, 0x7bff, true},
+  {{1.0, 2.0, 3.0}, {-0.48, -0.6, -0.64}, 2.2, 4.0e-6f, {33860, 34952, 14199}, {-21337, -23623}, 33755, 0x0043, false},
+};
+
+float DecodeHalf(uint16_t h)
+{
+  const int exponent = (h >> 10) & 0x1f;
+  const int mantissa = h & 0x3ff;
+  const float magnitude = exponent == 0 ? std::ldexp(static_cast<float>(mantissa), -24)
+                                        : std::ldexp(static_cast<float>(1024 + mantissa), exponent - 25);
+  return (h & 0x8000) ? -magnitude : magnitude;
+}
+
+// 与 PhotonBuffer::FillCompact 相同的编码序列；返回是否有字段被截断
+G4bool Encode(const CompactPhotonCodec& codec, const ReferencePhoton& p, CompactPhotonRecord& record)
+{
+  G4bool clamped = codec.EncodePosition(p.pos[0] * cm, p.pos[1] * cm, p.pos[2] * cm, record.initPos);
+  clamped |= codec.EncodePosition(p.pos[0] * cm, p.pos[1] * cm, p.pos[2] * cm, record.finalPos);
+  CompactPhotonCodec::EncodeDirection(p.dir[0], p.dir[1], p.dir[2], record.initDir);
+  CompactPhotonCodec::EncodeDirection(p.dir[0], p.dir[1], p.dir[2], record.finalDir);
+  clamped |= CompactPhotonCodec::EncodeWavelength(p.energyEv * eV, record.wavelength);
+  clamped |= CompactPhotonCodec::EncodeHalf(p.weight, record.weight);
+  return clamped;
+}
+
+int CheckReference(const CompactPhotonCodec& codec)
+{
+  int failures = 0;
+  int row = 0;
+  for (const ReferencePhoton& p : kReference) {
+    CompactPhotonRecord record{};
+    const G4bool clamped = Encode(codec, p, record);
+    G4bool same = clamped == p.clamped && record.wavelength == p.wavelengthQ && record.weight == p.weightQ;
+    for (int k = 0; k < 3; ++k) same = same && record.initPos[k] == p.posQ[k] && record.finalPos[k] == p.posQ[k];
+    for (int k = 0; k < 2; ++k) same = same && record.initDir[k] == p.dirQ[k] && record.finalDir[k] == p.dirQ[k];
+    if (!same) {
+      std::printf("  MISMATCH reference row %d: pos %u %u %u dir %d %d wavelength %u weight 0x%04x clamped %d\n",
+                  row, record.initPos[0], record.initPos[1], record.initPos[2], record.initDir[0], record.initDir[1],
+                  record.wavelength, record.weight, static_cast<int>(clamped));
+      ++failures;
+    }
+    ++row;
+  }
+  return failures;
+}
+
+int CheckHalf()
+{
+  int failures = 0;
+  for (uint32_t h = 0; h <= 0xffff; ++h) {
+    if (((h >> 10) & 0x1f) == 0x1f) continue;  // inf / NaN
+    uint16_t out;
+    const G4bool clamped = CompactPhotonCodec::EncodeHalf(DecodeHalf(static_cast<uint16_t>(h)), out);
+    if (clamped || out != h) {
+      if (failures < 10) std::printf("  MISMATCH half 0x%04x -> 0x%04x clamped %d\n", h, out, static_cast<int>(clamped));
+      ++failures;
+    }
+  }
+  const float overflow[] = {65520.0f, 1.0e6f, -1.0e30f, std::numeric_limits<float>::infinity(),
+                            std::numeric_limits<float>::quiet_NaN()};
+  for (float v : overflow) {
+    uint16_t out;
+    if (!CompactPhotonCodec::EncodeHalf(v, out)) {
+      std::printf("  MISMATCH half %g not reported as clamped (0x%04x)\n", v, out);
+      ++failures;
+    }
+  }
+  return failures;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const int photons = argc > 1 ? std::atoi(argv[1]) : 10000000;
+  const CompactPhotonCodec codec(kBoxMin, kBoxMax);
+
+  const int referenceFailures = CheckReference(codec);
+  std::printf("reference vectors  %zu rows, %d mismatches\n", sizeof(kReference) / sizeof(kReference[0]),
+              referenceFailures);
+  const int halfFailures = CheckHalf();
+  std::printf("half round trip    %d mismatches\n", halfFailures);
+
+  std::mt19937_64 rng(12345);
+  std::uniform_real_distribution<double> unit(0.0, 1.0), dir(-1.0, 1.0), energy(1.6, 5.5), weight(0.5, 40.0);
+  std::vector<ReferencePhoton> input(4096);
+  for (ReferencePhoton& p : input) {
+    p = ReferencePhoton{};
+    for (int k = 0; k < 3; ++k) {
+      p.pos[k] = kBoxMin[k] + unit(rng) * (kBoxMax[k] - kBoxMin[k]);
+      p.dir[k] = dir(rng);
+    }
+    const double norm = std::sqrt(p.dir[0] * p.dir[0] + p.dir[1] * p.dir[1] + p.dir[2] * p.dir[2]);
+    for (double& d : p.dir) d /= norm;
+    p.energyEv = energy(rng);
+    p.weight = static_cast<float>(weight(rng));
+  }
+  std::vector<CompactPhotonRecord> out(input.size());
+  long clampedCount = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < photons; ++i) {
+    const size_t j = static_cast<size_t>(i) % input.size();
+    clampedCount += Encode(codec, input[j], out[j]) ? 1 : 0;
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("encode             %d photons  %6.2f ns/photon  (%ld clamped)\n",
+              photons, photons > 0 ? 1e9 * seconds / photons : 0.0, clampedCount);
+
+  return referenceFailures + halfFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+//
+// bench_photon_commit.cc - 事件末光子写入输出缓冲的微基准
+//
+// 对比两条路径（均不写盘，缓冲满时直接清空，只测提交开销）：
+//   per-photon : 旧路径，EventAction 逐个调用 RunAction::RecordPhotonData（15 个 double 参数、
+//                每次判断输出格式与线程角色），再由 PhotonBuffer::Fill 逐条换算单位并 push_back
+//   per-event  : PhotonBuffer::FillEvent，一次 reserve，整批换算追加
+//
+// 用法: bench_photon_commit [events] [photons_per_event]
+//   cmake -DBUILD_BENCHMARKS=ON .. && make bench_photon_commit && ./bench_photon_commit 200 100000
+//
+
+#include "PhotonBuffer.hh"
+#include "PhotonTable.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace {
+
+// RunAction::RecordPhotonData 的 binary 分支（跨编译单元调用，不内联）
+__attribute__((noinline))
+void RecordPhotonData(const std::string& outputFormat, PhotonBuffer* threadBuffer, PhotonBuffer* masterBuffer,
+                      G4double initX, G4double initY, G4double initZ,
+                      G4double initDirX, G4double initDirY, G4double initDirZ,
+                      G4double finalX, G4double finalY, G4double finalZ,
+                      G4double finalDirX, G4double finalDirY, G4double finalDirZ,
+                      G4double finalEnergy, G4int event_id, G4int track_id, G4double weight)
+{
+  if (outputFormat == "binary") {
+    PhotonBuffer* buffer = G4Threading::IsWorkerThread() ? threadBuffer : masterBuffer;
+    if (buffer == nullptr) return;
+    buffer->Fill(initX, initY, initZ, initDirX, initDirY, initDirZ,
+                 finalX, finalY, finalZ, finalDirX, finalDirY, finalDirZ,
+                 finalEnergy, event_id, track_id, weight);
+    if (buffer->IsBufferFull()) buffer->ClearBuffer();
+  }
+}
+
+void FillTable(PhotonTable& table, int photons, std::mt19937_64& rng)
+{
+  std::uniform_real_distribution<float> pos(-300.0f, 300.0f), dir(-1.0f, 1.0f), energy(2.0e-6f, 4.0e-6f);
+  table.Clear();
+  for (int i = 0; i < photons; ++i) {
+    PhotonData& d = table.Insert(i + 2);
+    d.initialX = pos(rng); d.initialY = pos(rng); d.initialZ = pos(rng);
+    d.initialDirX = dir(rng); d.initialDirY = dir(rng); d.initialDirZ = dir(rng);
+    d.weight = 1.0f;
+    if (i % 5 == 4) continue;  // 约 20% 没有终点
+    d.finalX = pos(rng); d.finalY = pos(rng); d.finalZ = pos(rng);
+    d.finalDirX = dir(rng); d.finalDirY = dir(rng); d.finalDirZ = dir(rng);
+    d.finalEnergy = energy(rng);
+    d.hasData = 1;
+  }
+}
+
+template <class Body>
+double TimeIt(Body&& body)
+{
+  const auto start = std::chrono::steady_clock::now();
+  body();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const int events = argc > 1 ? std::atoi(argv[1]) : 200;
+  const int photons = argc > 2 ? std::atoi(argv[2]) : 100000;
+  const std::string outputFormat = "binary";
+
+  std::mt19937_64 rng(12345);
+  PhotonTable table;
+  FillTable(table, photons, rng);
+
+  PhotonBuffer perPhoton(1000000, true);
+  const double tPerPhoton = TimeIt([&] {
+    for (int e = 0; e < events; ++e) {
+      table.ForEachComplete([&](G4int trackID, const PhotonData& d) {
+        RecordPhotonData(outputFormat, nullptr, &perPhoton,
+                         d.initialX, d.initialY, d.initialZ, d.initialDirX, d.initialDirY, d.initialDirZ,
+                         d.finalX, d.finalY, d.finalZ, d.finalDirX, d.finalDirY, d.finalDirZ,
+                         d.finalEnergy, e, trackID, d.weight);
+      });
+    }
+  });
+
+  PhotonBuffer perEvent(1000000, true);
+  const double tPerEvent = TimeIt([&] {
+    for (int e = 0; e < events; ++e) {
+      perEvent.FillEvent(table, e);
+      if (perEvent.IsBufferFull()) perEvent.ClearBuffer();
+    }
+  });
+
+  const double total = static_cast<double>(events) * photons * 0.8;
+  std::printf("events %d, completed photons/event %d\n", events, static_cast<int>(photons * 0.8));
+  std::printf("  per-photon  %8.3f s  %6.2f ns/photon\n", tPerPhoton, 1e9 * tPerPhoton / total);
+  std::printf("  per-event   %8.3f s  %6.2f ns/photon  (x%.1f)\n",
+              tPerEvent, 1e9 * tPerEvent / total, tPerEvent > 0 ? tPerPhoton / tPerEvent : 0.0);
+  if (perPhoton.GetTotalEntries() != perEvent.GetTotalEntries()) {
+    std::printf("  WARNING: entry counts differ (%ld vs %ld)\n",
+                static_cast<long>(perPhoton.GetTotalEntries()), static_cast<long>(perEvent.GetTotalEntries()));
+  }
+  return 0;
+}
@@ -0,0 +1,124 @@
+//
+// bench_photon_table.cc - EventAction 在途光子容器的微基准
+//
+// 对比旧的 std::map<G4int, PhotonData(double)> 与 PhotonTable（平铺 vector + 事件代号）：
+// 每个事件按 Geant4 的栈顺序（track ID 成块分配、后进先出地开始输运）创建光子，
+// 输运结束时查找并写终点，事件末按 track ID 升序遍历输出，再清空。
+//
+// 用法: bench_photon_table [events] [photons_per_event]
+//   cmake -DBUILD_BENCHMARKS=ON .. && make bench_photon_table && ./bench_photon_table 200 100000
+//
+
+#include "PhotonTable.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct LegacyPhotonData {
+  G4double initialX, initialY, initialZ;
+  G4double initialDirX, initialDirY, initialDirZ;
+  G4double finalX, finalY, finalZ;
+  G4double finalDirX, finalDirY, finalDirZ;
+  G4double finalEnergy;
+  G4double weight;
+  G4bool hasData;
+};
+
+// 一个事件的光子 track ID 输运顺序：每个带电步产生一块连续 ID，块内后进先出；约 80% 到达终点
+std::vector<G4int> MakeTrackOrder(int photons, std::mt19937_64& rng)
+{
+  std::vector<G4int> order;
+  order.reserve(photons);
+  std::uniform_int_distribution<int> blockSize(1, 40);
+  G4int next = 2;  // 1 = 初级粒子
+  while (static_cast<int>(order.size()) < photons) {
+    const int n = std::min(blockSize(rng), photons - static_cast<int>(order.size()));
+    for (int i = n - 1; i >= 0; --i) order.push_back(next + i);
+    next += n + 1;  // 中间夹一个带电次级
+  }
+  return order;
+}
+
+template <class Body>
+double TimeIt(Body&& body)
+{
+  const auto start = std::chrono::steady_clock::now();
+  body();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const int events = argc > 1 ? std::atoi(argv[1]) : 200;
+  const int photons = argc > 2 ? std::atoi(argv[2]) : 100000;
+
+  std::mt19937_64 rng(12345);
+  std::vector<std::vector<G4int>> orders;
+  for (int e = 0; e < std::min(events, 16); ++e) orders.push_back(MakeTrackOrder(photons, rng));
+
+  double sinkMap = 0.0, sinkTable = 0.0;
+
+  std::map<G4int, LegacyPhotonData> map;
+  const double tMap = TimeIt([&] {
+    for (int e = 0; e < events; ++e) {
+      map.clear();
+      const auto& order = orders[e % orders.size()];
+      for (size_t i = 0; i < order.size(); ++i) {
+        LegacyPhotonData& d = map[order[i]];
+        d.initialX = d.initialY = d.initialZ = static_cast<double>(i);
+        d.initialDirX = d.initialDirY = d.initialDirZ = 0.5;
+        d.weight = 1.0;
+        d.hasData = false;
+        if (i % 5 == 4) continue;  // 约 20% 没有终点（例如在模体外被杀）
+        auto it = map.find(order[i]);
+        if (it != map.end()) {
+          it->second.finalX = it->second.finalY = it->second.finalZ = 1.0;
+          it->second.finalDirX = it->second.finalDirY = it->second.finalDirZ = 0.5;
+          it->second.finalEnergy = 3.0e-6;
+          it->second.hasData = true;
+        }
+      }
+      for (const auto& pair : map) {
+        if (pair.second.hasData) sinkMap += pair.second.initialX + pair.first;
+      }
+    }
+  });
+
+  PhotonTable table;
+  const double tTable = TimeIt([&] {
+    for (int e = 0; e < events; ++e) {
+      table.Clear();
+      const auto& order = orders[e % orders.size()];
+      for (size_t i = 0; i < order.size(); ++i) {
+        PhotonData& d = table.Insert(order[i]);
+        d.initialX = d.initialY = d.initialZ = static_cast<float>(i);
+        d.initialDirX = d.initialDirY = d.initialDirZ = 0.5f;
+        d.weight = 1.0f;
+        if (i % 5 == 4) continue;
+        if (PhotonData* p = table.Find(order[i])) {
+          p->finalX = p->finalY = p->finalZ = 1.0f;
+          p->finalDirX = p->finalDirY = p->finalDirZ = 0.5f;
+          p->finalEnergy = 3.0e-6f;
+          p->hasData = 1;
+        }
+      }
+      table.ForEachComplete([&](G4int id, const PhotonData& d) { sinkTable += d.initialX + id; });
+    }
+  });
+
+  const double total = static_cast<double>(events) * photons;
+  std::printf("events %d, photons/event %d\n", events, photons);
+  std::printf("  std::map      %8.3f s  %7.1f ns/photon\n", tMap, 1e9 * tMap / total);
+  std::printf("  PhotonTable   %8.3f s  %7.1f ns/photon  (x%.1f, %zu slots retained)\n",
+              tTable, 1e9 * tTable / total, tTable > 0 ? tMap / tTable : 0.0, table.Capacity());
+  if (sinkMap != sinkTable) std::printf("  WARNING: checksums differ (%g vs %g)\n", sinkMap, sinkTable);
+  return 0;
+}
@@ -7,6 +7,8 @@
 
 #include "G4VUserActionInitialization.hh"
 
+class RunAction;
+
 class ActionInitialization : public G4VUserActionInitialization
 {
   public:
@@ -15,6 +17,10 @@ class ActionInitialization : public G4VUserActionInitialization
 
     virtual void BuildForMaster() const;
     virtual void Build() const;
+
+  private:
+    // 事件级 action（初级产生、事件、步、栈）；sub-event 模式下 master 也处理事件，同样需要
+    void BuildEventActions(RunAction* runAction) const;
 };
 
 #endif
@@ -0,0 +1,53 @@
+//
+// AnalyticOpticalTransport.hh
+// analytic 模式：水中只有 RINDEX/ABSLENGTH（无散射面），光子在模体内直线传播并按指数吸收。
+// 在入栈时解析地求出吸收点或出射点（含出射面的 Fresnel/全反射方向），不经过 Geant4 光学步进。
+// 结果与 full 模式 SteppingAction 的记录约定一致：光子第一次到达模体表面即记录并终止。
+//
+
+#ifndef AnalyticOpticalTransport_h
+#define AnalyticOpticalTransport_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include "G4MaterialPropertyVector.hh"
+#include "PhantomGeometry.hh"
+
+struct AnalyticPhotonEnd {
+  G4ThreeVector position;   // 终止位置（吸收点或模体表面）
+  G4ThreeVector direction;  // 终止方向（吸收：不变；表面：折射或反射后）
+  G4double energy;          // 光子能量（输运中不变）
+  G4bool absorbed;          // true = OpAbsorption，false = 到达表面
+  G4double survival;        // 吸收加权时 exp(-L/ABSLENGTH)，否则 1
+};
+
+class AnalyticOpticalTransport
+{
+  public:
+    AnalyticOpticalTransport();
+    ~AnalyticOpticalTransport() = default;
+
+    // 返回 false 表示无法解析处理（光子不在模体内或缺少光学表），调用方应交给 Geant4 正常追踪
+    G4bool Transport(const G4ThreeVector& position, const G4ThreeVector& direction,
+                     const G4ThreeVector& polarization, G4double energy,
+                     AnalyticPhotonEnd& end);
+
+  private:
+    // 首次调用时从几何中取模体及其母体的材料属性表（几何在 worker 构建完成后才可用）
+    G4bool Initialize();
+
+    // 与 G4OpBoundaryProcess::DielectricDielectric（polished，无光学表面）相同的抽样
+    G4ThreeVector SampleBoundaryDirection(const G4ThreeVector& direction,
+                                          const G4ThreeVector& polarization,
+                                          const G4ThreeVector& outwardNormal,
+                                          G4double rindex1, G4double rindex2) const;
+
+    PhantomGeometry fGeometry;
+    G4bool fInitialized;
+    G4MaterialPropertyVector* fPhantomRindex;
+    G4MaterialPropertyVector* fPhantomAbsLength;
+    G4MaterialPropertyVector* fOutsideRindex;
+    G4bool fAbsorptionWeighting;  // variance_reduction.optical_absorption_weighting：不抽样吸收，全部到达表面
+};
+
+#endif
@@ -0,0 +1,178 @@
+//
+// AsyncWriter.hh - Dedicated I/O thread for the binary output buffers
+//
+// PhotonBuffer / DoseBuffer / CreationBuffer 写盘时把整块 record vector move 进队列（不复制），
+// 由单独的 I/O 线程按提交顺序追加到文件；调用方立即换一块空缓冲继续模拟。
+// 队列中（含正在写）的缓冲数达到 writer_queue_depth 时 Submit 才阻塞（背压）；depth = 0 为同步写。
+// writer_mode = "pwrite"：已登记的文件不走队列，各线程在 Submit 处用原子 fetch_add
+// 预留文件偏移后直接 pwrite，互不等待；文件内容仍是连续的 record（缓冲粒度交错，与队列模式相同）。
+//
+// 输出文件每个 run 只打开一次（OpenFile/CloseFiles），每个缓冲一次 pwrite 整块写出。
+// writer_direct_io（queue 模式）：O_DIRECT 打开，I/O 线程把记录拼进对齐的大块再写，绕过页缓存；
+// writer_fsync："none" / "end_of_run" / "every_buffer"。
+// output_compression = "zlib"：登记时给出记录布局的文件写成分块压缩容器（ChunkedOutput.hh），
+// 压缩在写盘的线程里做（queue 模式为 I/O 线程，pwrite 模式为各 worker，彼此并行）。
+// output_layout = "columns"：OpenColumns 登记的流按列写成 .npy（ColumnarOutput.hh）；每个缓冲原子预留
+// 一段行号，各列写到同一行号，pwrite 模式下各线程并行写也保持各列行对齐。
+//
+
+#ifndef AsyncWriter_h
+#define AsyncWriter_h 1
+
+#include "globals.hh"
+#include "MemoryBudget.hh"
+#include "ChunkedOutput.hh"
+#include "ColumnarOutput.hh"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class AsyncWriter
+{
+public:
+  enum FsyncPolicy { kFsyncNone, kFsyncEndOfRun, kFsyncEveryBuffer };
+
+  static AsyncWriter* Instance();
+  ~AsyncWriter();
+
+  // 在第一次 Submit 之前设置（main 中按 Config 设置）
+  void SetQueueDepth(G4int depth) { fDepth = depth < 0 ? 0 : depth; }
+  G4int GetQueueDepth() const { return fDepth; }
+  void SetParallelAppend(G4bool enabled) { fParallelAppend = enabled; }
+  G4bool GetParallelAppend() const { return fParallelAppend; }
+  void SetDirectIO(G4bool enabled) { fDirectIO = enabled; }
+  G4bool GetDirectIO() const { return fDirectIO; }
+  void SetFsyncPolicy(FsyncPolicy policy) { fFsync = policy; }
+  FsyncPolicy GetFsyncPolicy() const { return fFsync; }
+  // chunkRecords：每个压缩 chunk 的记录数上限
+  void SetChunkedOutput(G4bool enabled, G4int chunkRecords)
+  {
+    fChunked = enabled;
+    fChunkRecords = chunkRecords > 0 ? static_cast<size_t>(chunkRecords) : 65536;
+  }
+  G4bool GetChunkedOutput() const { return fChunked; }
+  G4int GetChunkRecords() const { return static_cast<G4int>(fChunkRecords); }
+  void SetColumnarOutput(G4bool enabled) { fColumnar = enabled; }
+  G4bool GetColumnarOutput() const { return fColumnar; }
+
+  // 把 records 交给 I/O 线程追加到 path；每条写出前 recordBytes 字节（默认整条记录；
+  // 小于 sizeof(Record) 时只写结构的前缀）。
+  // records 被 move 走，返回后为空
+  template <class Record>
+  void Submit(const std::string& path, std::vector<Record>&& records, size_t recordBytes = sizeof(Record))
+  {
+    if (records.empty()) return;
+    auto holder = std::make_shared<std::vector<Record>>(std::move(records));
+    records = std::vector<Record>();
+    Job job;
+    job.path = path;
+    job.data = reinterpret_cast<char*>(holder->data());
+    job.count = holder->size();
+    job.stride = sizeof(Record);
+    job.recordBytes = recordBytes;
+    job.ownedBytes = static_cast<long long>(holder->capacity() * sizeof(Record));
+    job.owner = std::move(holder);
+    MemoryBudget::Add(MemoryBudget::kWriterQueue, job.ownedBytes);
+    Enqueue(std::move(job));
+  }
+
+  // 等待已提交的缓冲全部写完（EndOfRunAction 写 header / run_meta 前调用）
+  void Flush();
+
+  // OpenFile 由 master 在 BeginOfRunAction（文件已截断、worker 尚未开始）调用，CloseFiles 在 EndOfRunAction
+  // Flush 之后（worker 已结束）调用；run 期间文件表只读，查找不加锁。未登记的路径每次按追加方式打开。
+  // layout 非空且启用了 output_compression 时该文件写成分块压缩容器，CloseFiles 写出索引与 trailer
+  void OpenFile(const std::string& path, const ChunkedOutput::Layout* layout = nullptr);
+  // 按列登记 path：不写记录文件（删除已截断的空文件），每列一个 <path>.<column>.npy；不做压缩与 O_DIRECT
+  void OpenColumns(const std::string& path, const std::vector<ColumnarOutput::Column>& columns);
+  void CloseFiles();
+  // 已登记且按容器写出（写 .header 时标注）
+  G4bool IsChunked(const std::string& path) const;
+  // 已按列登记（写 .header 时列出列文件）；GetColumns 对未按列登记的路径返回空
+  G4bool IsColumnar(const std::string& path) const;
+  std::vector<ColumnarOutput::Column> GetColumns(const std::string& path) const;
+
+  // 因队列满而阻塞的 Submit 次数（写 run_meta 用）
+  G4long GetBackpressureWaits() const { return fBackpressureWaits; }
+  void ResetBackpressureWaits() { fBackpressureWaits = 0; }
+  // 失败的写盘（记录 / chunk / 列 / .npy 头的 pwrite 出错，或未登记文件打开/写入失败）次数（写 run_meta 用）
+  G4long GetWriteFailures() const { return fWriteFailures; }
+  void ResetWriteFailures() { fWriteFailures = 0; }
+  // 压缩失败、以 kChunkCodecNone 裸记录写出的 chunk 数（写 run_meta 用）
+  G4long GetUncompressedChunks() const { return fUncompressedChunks; }
+  void ResetUncompressedChunks() { fUncompressedChunks = 0; }
+
+private:
+  AsyncWriter() = default;
+
+  struct Job {
+    std::string path;
+    std::shared_ptr<void> owner;  // 持有 record vector，写完释放
+    char* data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    size_t recordBytes = 0;
+    long long ownedBytes = 0;     // owner 的容量，计入 MemoryBudget::kWriterQueue
+  };
+
+  struct OutputFile {
+    int fd = -1;
+    std::atomic<long long> offset{0};  // 下一个未预留的字节
+    // O_DIRECT：只由 I/O 线程访问的对齐暂存块
+    G4bool direct = false;
+    char* staging = nullptr;
+    size_t staged = 0;
+    // 分块压缩容器：chunk 可能由多个线程并行写出，索引加锁追加
+    G4bool chunked = false;
+    ChunkedOutput::Layout layout{};
+    std::mutex indexMutex;
+    std::vector<ChunkedOutput::ChunkIndexEntry> index;
+    // 列式输出（fd 为 -1）：每列一个 .npy，rows 为已预留的行数
+    std::vector<ColumnarOutput::Column> columns;
+    std::vector<int> columnFds;
+    std::atomic<unsigned long long> rows{0};
+  };
+
+  void Enqueue(Job&& job);
+  void Run();
+  void WriteJob(Job& job);
+  long long WriteAt(OutputFile& file, const char* data, size_t bytes);  // 返回写入的偏移
+  void WriteChunks(OutputFile& file, const char* data, size_t bytes);
+  void WriteIndex(OutputFile& file);
+  void WriteColumns(OutputFile& file, const char* data, size_t count, size_t stride);
+  void CloseColumns(const std::string& path, OutputFile& file);
+  void StageDirect(OutputFile& file, const char* data, size_t bytes);
+  static size_t Pack(Job& job);
+  static void Release(Job& job);
+
+  G4int fDepth = 4;
+  G4bool fParallelAppend = false;
+  G4bool fDirectIO = false;
+  FsyncPolicy fFsync = kFsyncNone;
+  G4bool fChunked = false;
+  size_t fChunkRecords = 65536;
+  G4bool fColumnar = false;
+
+  std::mutex fMutex;
+  std::condition_variable fWork;   // 队列非空 / 停止
+  std::condition_variable fSpace;  // 有缓冲写完（背压与 Flush）
+  std::deque<Job> fQueue;
+  size_t fInFlight = 0;            // 队列中 + 正在写
+  G4bool fStop = false;
+  G4long fBackpressureWaits = 0;
+  std::atomic<G4long> fUncompressedChunks{0};  // pwrite 模式下各 worker 并行压缩
+  std::atomic<G4long> fWriteFailures{0};       // pwrite 模式下各 worker 并行写
+  std::thread fThread;
+  std::mutex fSyncMutex;           // depth = 0 时串行化各线程的同步写
+
+  std::map<std::string, std::unique_ptr<OutputFile>> fFiles;
+};
+
+#endif
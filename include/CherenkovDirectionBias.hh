@@ -0,0 +1,42 @@
+//
+// CherenkovDirectionBias.hh
+// Cherenkov 发射方位角偏倚：光子方向在以带电粒子步方向为轴的锥面上，G4Cerenkov 均匀抽样方位角 φ。
+// 这里把 [0, 2π) 分成 N 个方位角 bin，能直线到达目标（模体的某个面，或给定方向锥）的 bin
+// 获得更大的抽样概率，重新抽样 φ 并返回精确的重要性权重 (1/2π) / q(φ)。
+// 防御比例 ε 保证每个 bin 的概率 ≥ ε/N，经散射/反射才到达目标的光子仍被（以大权重）抽到。
+//
+
+#ifndef CherenkovDirectionBias_h
+#define CherenkovDirectionBias_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include "PhantomGeometry.hh"
+#include <vector>
+
+class CherenkovDirectionBias
+{
+  public:
+    CherenkovDirectionBias();  // 从 Config 读取 variance_reduction.direction_bias_*
+    ~CherenkovDirectionBias() = default;
+
+    // axis：母粒子步方向（与 G4Cerenkov 使用的步弦方向一致）；direction / polarization 绕 axis 旋转到
+    // 新抽样的方位角。rindex > 1 时面目标额外要求在出射面不发生全反射（外部为空气）。
+    // 返回权重因子；所有 bin 都（不）可达时不改变方向，返回 1。
+    G4double Resample(const G4ThreeVector& position, const G4ThreeVector& axis, G4double rindex,
+                      G4ThreeVector& direction, G4ThreeVector& polarization);
+
+  private:
+    G4bool Reaches(const G4ThreeVector& position, const G4ThreeVector& direction, G4double rindex) const;
+
+    PhantomGeometry fGeometry;
+    G4bool fFaceTarget;            // true = 模体面，false = 方向锥
+    G4ThreeVector fFaceNormal;     // 目标面外法向（±x/±y/±z）
+    G4ThreeVector fConeAxis;       // 方向锥轴（单位向量）
+    G4double fConeCosHalfAngle;
+    G4int fBins;
+    G4double fDefensiveFraction;
+    std::vector<G4bool> fReachable;  // 每个 bin 中心方向是否可达（复用，避免每个光子分配）
+};
+
+#endif
@@ -0,0 +1,40 @@
+//
+// CherenkovYieldTable.hh
+// yield_only 模式：按 Frank–Tamm 公式计算单位长度期望 Cherenkov 光子数。
+// 与 G4Cerenkov 相同，对材料 RINDEX 表预先计算 ∫ 1/n² dE（CAI），
+// 因此对同一步给出的期望值与 G4Cerenkov::GetAverageNumberOfPhotons 一致。
+//
+
+#ifndef CherenkovYieldTable_h
+#define CherenkovYieldTable_h 1
+
+#include "globals.hh"
+#include "G4MaterialPropertyVector.hh"
+#include <vector>
+
+class G4Material;
+
+class CherenkovYieldTable
+{
+  public:
+    CherenkovYieldTable();
+    ~CherenkovYieldTable() = default;
+
+    // 每单位长度的期望光子数（Geant4 单位，1/mm）；材料无 RINDEX 或低于阈值时为 0
+    G4double GetAverageNumberOfPhotons(G4double charge, G4double beta, const G4Material* material);
+
+  private:
+    struct Entry {
+      G4bool built = false;
+      G4MaterialPropertyVector* rindex = nullptr;  // nullptr = 非光学材料
+      std::vector<G4double> energy;                // RINDEX 能量节点
+      std::vector<G4double> cai;                   // 累积 ∫ 1/n² dE
+    };
+
+    const Entry& GetEntry(const G4Material* material);
+    static G4double InterpolateCAI(const Entry& entry, G4double photonEnergy);
+
+    std::vector<Entry> fEntries;  // 以 G4Material::GetIndex() 为下标，首次使用时构建
+};
+
+#endif
@@ -0,0 +1,85 @@
+//
+// ChunkedOutput.hh - Chunked, compressed container for the binary output streams
+//
+// simulation.output_compression = "zlib"：.phsp / .dose / .creation 不再是裸记录流，而是
+//   FileHeader (16 B) | chunk 0 | chunk 1 | ... | ChunkIndexEntry × N (64 B each) | Trailer (32 B)
+// 每个 chunk 独立压缩：最多 output_chunk_records 条记录先按"记录内字节位置"重排
+// （所有记录的第 0 字节、所有记录的第 1 字节……，同一字段的同一字节相邻），再 zlib 压缩。
+// 索引（zone map）按文件偏移排序，记录每个 chunk 的记录数、event_id 范围、位置与能量的 min/max，
+// 读取端可以按条件跳过 chunk 并并行解压（analysis/chunked_output.py）。
+// 全部整数/浮点为 little-endian。
+//
+
+#ifndef ChunkedOutput_h
+#define ChunkedOutput_h 1
+
+#include "globals.hh"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ChunkedOutput {
+
+constexpr char kFileMagic[8] = {'C', 'H', 'E', 'R', 'C', 'H', 'N', 'K'};
+constexpr char kTrailerMagic[8] = {'C', 'H', 'E', 'R', 'I', 'D', 'X', '1'};
+constexpr uint16_t kVersion = 1;
+constexpr uint16_t kCodecZlib = 1;
+constexpr uint16_t kFilterByteShuffle = 1;
+// ChunkIndexEntry::flags：该 chunk 压缩失败，按原样存为未重排的裸记录（compressedBytes = 记录数 × 记录字节数）
+constexpr uint32_t kChunkCodecNone = 1;
+
+struct FileHeader {
+  char magic[8];
+  uint16_t version;
+  uint16_t codec;
+  uint16_t filter;
+  uint16_t reserved;
+};
+static_assert(sizeof(FileHeader) == 16, "FileHeader must be 16 bytes");
+
+// 一个 chunk 的索引项；位置为各流的"主"坐标：.phsp 的 final 位置、.dose 的沉积点、.creation 的产生点
+struct ChunkIndexEntry {
+  uint64_t offset;            // chunk 在文件中的字节偏移
+  uint32_t compressedBytes;
+  uint32_t records;
+  uint32_t eventMin, eventMax;
+  float posMin[3], posMax[3]; // [cm]
+  float energyMin, energyMax; // 与记录中的能量字段同单位
+  uint32_t flags;             // 0：按文件头的 codec/filter 压缩；kChunkCodecNone：裸记录
+  uint32_t reserved;
+};
+static_assert(sizeof(ChunkIndexEntry) == 64, "ChunkIndexEntry must be 64 bytes");
+
+struct Trailer {
+  uint64_t indexOffset;       // 第一个 ChunkIndexEntry 的偏移
+  uint64_t totalRecords;
+  uint32_t chunkCount;
+  uint32_t recordBytes;
+  char magic[8];
+};
+static_assert(sizeof(Trailer) == 32, "Trailer must be 32 bytes");
+
+// 记录中 zone map 字段的字节偏移（各 Buffer 的 GetChunkLayout() 提供）
+struct Layout {
+  size_t recordBytes;
+  size_t x, y, z;
+  size_t energy;
+  size_t eventId;
+};
+
+// 编译时找到 zlib（CHERENKOV_WITH_ZLIB）才可用；否则输出保持裸记录流
+G4bool Available();
+
+FileHeader MakeFileHeader();
+Trailer MakeTrailer(uint64_t indexOffset, uint64_t totalRecords, uint32_t chunkCount, uint32_t recordBytes);
+
+// count 条紧密排列的记录 -> 字节重排 + zlib（level 1）压缩到 out；填写 entry 中除 offset 外的字段。
+// 失败返回 false
+G4bool CompressChunk(const char* records, size_t count, const Layout& layout,
+                     std::vector<char>& out, ChunkIndexEntry& entry);
+// CompressChunk 失败时的退路：chunk 数据即 records 本身（不重排、不压缩），entry 带 kChunkCodecNone
+void StoreChunk(const char* records, size_t count, const Layout& layout, ChunkIndexEntry& entry);
+
+}  // namespace ChunkedOutput
+
+#endif
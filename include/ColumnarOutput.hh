@@ -0,0 +1,43 @@
+//
+// ColumnarOutput.hh - Column-per-file output (NumPy .npy) for the binary output streams
+//
+// simulation.output_layout = "columns"：.phsp / .dose / .creation 不再写记录文件，而是每个字段
+// （或 xyz 字段组）一个 <path>.<column>.npy，例如 output.phsp.final_pos.npy (float32, shape (n, 3))。
+// 每个 .npy 以固定 128 字节的 NPY v1.0 头开始，后面是按行排列的数据（C order，little-endian）；
+// run 中头里的 shape 是占位，CloseFiles 时按实际行数重写。各列的第 i 行属于同一条记录。
+// 读取端 np.load(path, mmap_mode="r") 只映射需要的列（analysis/columnar_output.py）。
+//
+
+#ifndef ColumnarOutput_h
+#define ColumnarOutput_h 1
+
+#include "globals.hh"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ColumnarOutput {
+
+// 头长度固定：数据从 kHeaderBytes 开始，行 i 的偏移 = kHeaderBytes + i × 每行字节数
+constexpr size_t kHeaderBytes = 128;
+
+// 记录中的一列（各 Buffer 的 GetColumns() 提供）
+struct Column {
+  const char* name;    // 文件名后缀：<path>.<name>.npy
+  size_t offset;       // 在记录中的字节偏移
+  size_t itemBytes;    // 单个元素字节数
+  G4int width;         // 1：shape (n,)；3：shape (n, 3)（相邻的 x/y/z 字段）
+  const char* descr;   // NumPy dtype，如 "<f4"
+};
+
+std::string ColumnPath(const std::string& path, const Column& column);
+
+// kHeaderBytes 字节的 NPY v1.0 头，shape 为 (rows,) 或 (rows, width)
+std::string MakeHeader(const Column& column, uint64_t rows);
+
+// count 条记录（间距 stride）中该列的字节 -> out（count × itemBytes × width 字节，紧密排列）
+void Gather(const char* records, size_t count, size_t stride, const Column& column, char* out);
+
+}  // namespace ColumnarOutput
+
+#endif
@@ -0,0 +1,163 @@
+//
+// CompactPhoton.hh - Compact photon record format (v4, 24 bytes per photon)
+//
+// simulation.photon_format = "compact"：.phsp 由 24 字节定长记录组成，分两种：
+//   CompactEventFrame  事件帧：event_id 与随后属于该事件的光子数（event_id 每个事件只存一次）
+//   CompactPhotonRecord 光子：
+//     位置    uint16 × 3（初始、终点各一组）：模体包围盒内的定点数，q = round((x - min) / (max - min) × 65535)，
+//             步长 = 边长 / 65535（60 cm -> 9.2 µm），越界的值截到边界（计数写入 run_meta）
+//     方向    int16 × 2（初始、终点各一组）：八面体映射后的 snorm16，角度误差 < 1e-4 rad
+//     能量    uint16 波长 bin：[100, 1000] nm 线性 65535 份，步长 0.0137 nm（约 3e-5 相对能量误差）
+//     权重    IEEE half（1 = analog），相对精度 2^-11，上限 65504（超出截断，同样计入截断计数）
+//   track_id 不保存（读取端为 -1，即 v2 的"未知"）。
+// 文件按帧顺序读：帧 -> n 个光子 -> 帧 -> ...；一个帧不跨越写盘缓冲。
+//
+
+#ifndef CompactPhoton_h
+#define CompactPhoton_h 1
+
+#include "globals.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+constexpr uint32_t kCompactFrameMagic = 0x34545645;  // "EVT4"
+constexpr double kCompactWavelengthMinNm = 100.0;
+constexpr double kCompactWavelengthMaxNm = 1000.0;
+
+struct CompactEventFrame {
+  uint32_t magic;           // kCompactFrameMagic
+  uint32_t event_id;
+  uint32_t n_photons;       // 随后的光子记录数
+  uint32_t reserved[3];
+};
+static_assert(sizeof(CompactEventFrame) == 24, "CompactEventFrame must be 24 bytes");
+
+struct CompactPhotonRecord {
+  uint16_t initPos[3];      // 定点位置（模体包围盒）
+  uint16_t finalPos[3];
+  int16_t initDir[2];       // 八面体映射方向
+  int16_t finalDir[2];
+  uint16_t wavelength;      // [100, 1000] nm 的 bin
+  uint16_t weight;          // IEEE half
+};
+static_assert(sizeof(CompactPhotonRecord) == 24, "CompactPhotonRecord must be 24 bytes for format v4");
+
+// 缓冲中的一条 24 字节记录：帧或光子
+union CompactRecord {
+  CompactEventFrame frame;
+  CompactPhotonRecord photon;
+};
+static_assert(sizeof(CompactRecord) == 24, "CompactRecord must be 24 bytes");
+
+class CompactPhotonCodec
+{
+public:
+  // 包围盒 [cm]
+  CompactPhotonCodec(const double boundsMin[3], const double boundsMax[3])
+  {
+    for (int k = 0; k < 3; ++k) {
+      fMin[k] = boundsMin[k];
+      fMax[k] = boundsMax[k];
+      fScale[k] = fMax[k] > fMin[k] ? 65535.0 / (fMax[k] - fMin[k]) : 0.0;
+    }
+  }
+
+  double GetMin(int k) const { return fMin[k]; }
+  double GetMax(int k) const { return fMax[k]; }
+
+  // 位置（G4 内部单位）-> 定点；越界时截断并返回 true
+  G4bool EncodePosition(double x, double y, double z, uint16_t out[3]) const
+  {
+    const double v[3] = {x / cm, y / cm, z / cm};
+    G4bool clamped = false;
+    for (int k = 0; k < 3; ++k) {
+      double q = std::nearbyint((v[k] - fMin[k]) * fScale[k]);
+      if (!(q >= 0.0)) { q = 0.0; clamped = true; }  // 含 NaN
+      if (q > 65535.0) { q = 65535.0; clamped = true; }
+      out[k] = static_cast<uint16_t>(q);
+    }
+    return clamped;
+  }
+
+  // 单位向量 -> 八面体映射 snorm16
+  static void EncodeDirection(double x, double y, double z, int16_t out[2])
+  {
+    const double norm = std::abs(x) + std::abs(y) + std::abs(z);
+    double u = norm > 0.0 ? x / norm : 0.0;
+    double v = norm > 0.0 ? y / norm : 0.0;
+    if (z < 0.0) {
+      const double fu = (1.0 - std::abs(v)) * (u >= 0.0 ? 1.0 : -1.0);
+      const double fv = (1.0 - std::abs(u)) * (v >= 0.0 ? 1.0 : -1.0);
+      u = fu;
+      v = fv;
+    }
+    out[0] = static_cast<int16_t>(std::nearbyint(std::clamp(u, -1.0, 1.0) * 32767.0));
+    out[1] = static_cast<int16_t>(std::nearbyint(std::clamp(v, -1.0, 1.0) * 32767.0));
+  }
+
+  // 光子能量（G4 内部单位）-> 波长 bin；范围外截断并返回 true
+  static G4bool EncodeWavelength(double energy, uint16_t& out)
+  {
+    const double lambda = energy > 0.0 ? (h_Planck * c_light / nm) / energy : 0.0;
+    double q = std::nearbyint((lambda - kCompactWavelengthMinNm) * 65535.0 /
+                              (kCompactWavelengthMaxNm - kCompactWavelengthMinNm));
+    G4bool clamped = false;
+    if (!(q >= 0.0)) { q = 0.0; clamped = true; }
+    if (q > 65535.0) { q = 65535.0; clamped = true; }
+    out = static_cast<uint16_t>(q);
+    return clamped;
+  }
+
+  // float -> IEEE half（就近舍入到偶数）；舍入后超出 65504 的值截断为 65504、非有限值写 0，此时返回 true
+  static G4bool EncodeHalf(float value, uint16_t& out)
+  {
+    if (!std::isfinite(value)) {
+      out = 0;
+      return true;
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const float magnitude = std::abs(value);
+    out = sign;
+    if (magnitude <= 2.9802322e-8f) return false;  // <= 最小次正规数的一半（2^-25，舍入到偶数）：0
+    int exponent;
+    const float mantissa = std::frexp(magnitude, &exponent);  // magnitude = mantissa * 2^exponent, [0.5, 1)
+    if (exponent < -13) {
+      // 次正规数：以 2^-24 为单位
+      const uint16_t q = static_cast<uint16_t>(std::nearbyint(std::ldexp(magnitude, 24)));
+      out = static_cast<uint16_t>(sign | q);
+      return false;
+    }
+    // 正规数：11 位有效数字（含隐含位），舍入进位可能使指数加一
+    uint32_t significand = static_cast<uint32_t>(std::nearbyint(std::ldexp(mantissa, 11)));
+    int biased = exponent - 1 + 15;
+    if (significand == 2048u) {
+      significand = 1024u;
+      ++biased;
+    }
+    if (biased >= 31) {  // >= 65520：舍入后溢出
+      out = static_cast<uint16_t>(sign | 0x7BFFu);
+      return true;
+    }
+    out = static_cast<uint16_t>(sign | (static_cast<uint32_t>(biased) << 10) | (significand - 1024u));
+    return false;
+  }
+
+  static CompactEventFrame MakeFrame(uint32_t eventId)
+  {
+    CompactEventFrame frame{};
+    frame.magic = kCompactFrameMagic;
+    frame.event_id = eventId;
+    return frame;
+  }
+
+private:
+  double fMin[3], fMax[3], fScale[3];
+};
+
+#endif
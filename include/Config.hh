@@ -7,6 +7,17 @@
 
 using json = nlohmann::json;
 
+// One entry of voxel_phantom.materials: the material index stored in the raw voxel file
+// selects the entry at that position
+struct VoxelMaterialSpec {
+  std::string name;        // Geant4 material name (unique)
+  std::string base;        // "water", "air" (materials section) or a NIST name, e.g. "G4_BONE_CORTICAL_ICRP"
+  double density;          // [g/cm3]; <= 0 = density of the base material
+  std::string optical;     // optical template: "water", "air" or "none" (no RINDEX: photons are killed on entry)
+  double refractiveIndex;  // constant RINDEX override; <= 0 = template values
+  double absorptionLength; // [m] constant ABSLENGTH override; <= 0 = template values
+};
+
 class Config {
 private:
   static Config* fInstance;
@@ -21,6 +32,11 @@ public:
   
   // Load config from JSON file
   void LoadConfig(const std::string& configFilePath);
+
+  // Checks option values and combinations the getters cannot fall back from; prints an ERROR
+  // line per problem and returns false if the run must not start. Values the getters replace by
+  // a default get one WARNING here instead of one per call
+  bool Validate() const;
   
   // Geometry parameters
   double GetWorldSizeX() const;
@@ -34,6 +50,15 @@ public:
   double GetWaterPositionZ() const;
   std::string GetPhantomVolumeName() const;
   bool GetCheckOverlaps() const;
+
+  // Voxel phantom (optional "voxel_phantom" section): replaces the homogeneous water box by
+  // dims[0] x dims[1] x dims[2] voxels filling the same box (water_size_xyz_cm / water_position_cm).
+  // raw_file: one material index per voxel (uint8 or uint16, little endian, x fastest, then y, z)
+  bool GetVoxelPhantomEnabled() const;
+  std::string GetVoxelPhantomFile() const;
+  std::vector<int> GetVoxelPhantomDims() const;
+  std::string GetVoxelPhantomDataType() const;  // "uint8" (default) or "uint16"
+  std::vector<VoxelMaterialSpec> GetVoxelPhantomMaterials() const;
   
   // Material parameters - Air
   double GetAirDensity() const;
@@ -64,12 +89,110 @@ public:
   // Output format: "csv" or "binary"
   std::string GetOutputFormat() const;
   int GetBufferSize() const;
+  // Binary output goes through an I/O thread (AsyncWriter); at most writer_queue_depth full buffers
+  // may be queued/being written before a writer blocks. 0 = write synchronously in the calling thread
+  int GetWriterQueueDepth() const;  // default 4
+  // writer_mode: "queue" (default, I/O thread) or "pwrite" (each thread reserves a file range with an
+  // atomic fetch-add on the offset and pwrite()s its own buffer; no master buffer, no lock)
+  std::string GetWriterMode() const;
+  // writer_direct_io: open output files with O_DIRECT and write 8 MiB aligned blocks ("queue" mode only)
+  // writer_fsync: "none" (default), "end_of_run" (fsync when the files are closed) or "every_buffer"
+  bool GetWriterDirectIO() const;
+  std::string GetWriterFsync() const;
+  // memory_budget_mb: total for output buffers, queued buffers and photon tables, re-divided every run
+  // by thread count (MemoryBudget); 0 (default) keeps buffer_size / nThreads per worker
+  double GetMemoryBudgetMB() const;
+  // output_compression: "none" (default, raw record streams) or "zlib" (chunked container, ChunkedOutput.hh)
+  // output_chunk_records: records per compressed chunk (default 65536)
+  std::string GetOutputCompression() const;
+  int GetOutputChunkRecords() const;
+  // photon_format: "full" (default, v2/v3 float32 records) or "compact" (v4, 24 bytes, CompactPhoton.hh)
+  std::string GetPhotonFormat() const;
+  // output_layout: "records" (default, one record file per stream) or "columns" (one .npy per field, ColumnarOutput.hh)
+  std::string GetOutputLayout() const;
 
   // Cherenkov / Dose output switches (use contains() + defaults)
   bool GetEnableCherenkovOutput() const;
   bool GetEnableDoseOutput() const;
   std::string GetDoseOutputFilePath() const;  // base path for .dose; if empty use output_file_path
   int GetDoseBufferSize() const;
+
+  // Cherenkov handling mode:
+  //   "full"          - track every photon to its exit/absorption point (.phsp, default)
+  //   "creation_only" - record photons at birth and kill them (.creation, no optical transport)
+  //   "analytic"      - straight-line transport + ABSLENGTH absorption + Fresnel at the exit face,
+  //                     computed at stacking time; writes the same .phsp records as "full"
+  //   "yield_only"    - no optical photons; Frank–Tamm expected yield per charged step into a voxel grid (.yield)
+  std::string GetCherenkovMode() const;
+  double GetYieldVoxelSize() const;  // [cm]; <= 0 (default) = same automatic dv as build_cherenkov_kernel.py
+  // optical_stacking: "immediate" (default, photons stacked as they are emitted, parent suspended) or
+  // "staged" (full mode only: Cherenkov photons are kept as compact records until the charged shower of
+  // the event is finished, then re-injected optical_batch_size at a time)
+  std::string GetOpticalStacking() const;
+  bool GetOpticalStagedStacking() const;
+  int GetOpticalBatchSize() const;  // default 10000
+  // optical_subevent_size > 0 (full mode, Geant4 >= 11.2 MT build): the master thread processes the
+  // events and, once an event has stacked optical_subevent_min_photons Cherenkov photons, classifies
+  // further photons fSubEvent_0; G4SubEvtRunManager hands them to the workers as sub-events of up to
+  // optical_subevent_size tracks. Takes precedence over optical_stacking = "staged"
+  int GetOpticalSubEventSize() const;        // default 0 = off (also 0 where sub-events are unavailable)
+  int GetOpticalSubEventMinPhotons() const;  // default 2000
+
+  // Variance reduction parameters (optional "variance_reduction" section)
+  // photon_yield_fraction f in (0, 1]: keep each Cherenkov photon with probability f, weight 1/f
+  double GetPhotonYieldFraction() const;
+  // optical_absorption_weighting: OpAbsorption off, photons carry survival weight exp(-L/ABSLENGTH(E))
+  bool GetOpticalAbsorptionWeighting() const;
+  // direction_bias_target: Cherenkov emission azimuth biasing toward "face" (phantom face
+  // direction_bias_face, e.g. "+z", reached in a straight line without total internal reflection) or
+  // "cone" (directions within direction_bias_half_angle_deg of direction_bias_axis); "none" (default) = off.
+  // Only in full / analytic modes. Photons carry the exact weight (1/2π)/q(φ), see CherenkovDirectionBias
+  std::string GetDirectionBiasTarget() const;
+  std::string GetDirectionBiasFace() const;
+  std::vector<double> GetDirectionBiasAxis() const;
+  double GetDirectionBiasHalfAngle() const;         // [deg], default 30
+  int GetDirectionBiasAzimuthBins() const;          // default 36
+  double GetDirectionBiasDefensiveFraction() const; // ε in [0, 1], default 0.1; 0 = unreachable azimuths never sampled
+  bool GetDirectionBiasEnabled() const;
+  // importance_roulette: Russian roulette of Cherenkov photons at stacking time with survival
+  // p = max(I, importance_min_survival), weight 1/p; I from the camera QE curve
+  // (importance_qe_energy_eV / importance_qe, empty = 1) and, with importance_target_face, the
+  // straight-line transmission to that face (importance_off_target for photons missing it).
+  // Only in full / analytic modes, see PhotonImportance
+  bool GetImportanceRouletteEnabled() const;
+  std::vector<double> GetImportanceQEEnergies() const;  // [eV]
+  std::vector<double> GetImportanceQE() const;
+  std::string GetImportanceTargetFace() const;          // "+z", "-x", ...; "" (default) = no target face
+  double GetImportanceOffTarget() const;                // default 0.1
+  double GetImportanceMinSurvival() const;              // default 0.02
+  // true when photon records carry a weight (.phsp format v3, 64 bytes)
+  bool GetPhotonWeightingEnabled() const;
+
+  // Optical physics parameters (optional "optical" section)
+  // optical.processes.<name>: activation of each G4OpticalPhysics process. Defaults: Scintillation,
+  // OpWLS, OpWLS2, OpMieHG off (water defines none of their properties); Cerenkov, OpAbsorption,
+  // OpRayleigh, OpBoundary on
+  static const std::vector<std::string>& GetOpticalProcessNames();
+  bool GetOpticalProcessActivation(const std::string& processName) const;
+  int GetCerenkovMaxPhotonsPerStep() const;   // <= 0 (default) = Geant4 default (100)
+  double GetCerenkovMaxBetaChange() const;    // [%]; <= 0 (default) = Geant4 default (10)
+
+  // Physics parameters (optional "physics" section)
+  // physics_list: "FTFP_BERT" (default) or "em_only" (EM constructor only, see EmOnlyPhysicsList)
+  std::string GetPhysicsList() const;
+  int GetEmOption() const;  // em_option: 0, 3 or 4 (default 4 = G4EmStandardPhysics_option4)
+  // phantom_production_cut_mm > 0: production cut (gamma/e-/e+) of a "PhantomRegion" around the phantom
+  double GetPhantomProductionCut() const;  // [mm]; <= 0 (default) = physics list default cuts
+  // cherenkov_threshold_kill: kill electrons in the phantom once below the Cherenkov threshold
+  bool GetCherenkovThresholdKill() const;
+  // scoring_envelope_margin_cm >= 0: kill non-optical particles outside the phantom box grown by this
+  // margin whose straight line no longer reaches the phantom; < 0 (default) = disabled
+  double GetScoringEnvelopeMargin() const;  // [cm]
+  // physics_table_cache_dir: store/retrieve physics tables under <dir>/<GetPhysicsConfigKey()>; "" = off
+  std::string GetPhysicsTableCacheDir() const;
+  // Stable hash (FNV-1a, hex) of everything the physics tables depend on: physics, optical, materials,
+  // the extra physics constructors registered (G4OpticalPhysics unless yield_only) and the active optical processes
+  std::string GetPhysicsConfigKey() const;
 };
 
 #endif // CONFIG_HH
@@ -0,0 +1,84 @@
+//
+// CreationBuffer.hh - Buffer management for creation-only Cherenkov output
+// Same pattern as PhotonBuffer/DoseBuffer: Master/Worker, thread-safe absorb, float32 binary
+//
+
+#ifndef CreationBuffer_h
+#define CreationBuffer_h 1
+
+#include "globals.hh"
+#include "MemoryBudget.hh"
+#include "ChunkedOutput.hh"
+#include "ColumnarOutput.hh"
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <fstream>
+#include <cstdint>
+
+// Structure for a Cherenkov photon recorded at birth (40 bytes, no padding)
+struct BinaryCreationData {
+  float x, y, z;           // creation position [cm]
+  float dirX, dirY, dirZ;  // initial direction (unit vector)
+  float energy;            // photon energy [microeV]
+  uint32_t event_id;       // G4Event::GetEventID()
+  int32_t track_id;        // G4Track::GetTrackID()
+  int32_t parent_id;       // G4Track::GetParentID() (emitting charged particle)
+};
+static_assert(sizeof(BinaryCreationData) == 40, "BinaryCreationData must be 40 bytes for format compatibility");
+
+class CreationBuffer
+{
+public:
+  CreationBuffer(G4int bufferSize = 10000);
+  ~CreationBuffer();
+
+  void Fill(G4double x, G4double y, G4double z,
+            G4double dirX, G4double dirY, G4double dirZ,
+            G4double energy, G4int event_id, G4int track_id, G4int parent_id);
+
+  void WriteBuffer(const std::string& filePath);
+  void SetOutputPath(const std::string& filePath) { fOutputPath = filePath; }
+  const std::string& GetOutputPath() const { return fOutputPath; }
+  void AbsorbWorkerBuffer(CreationBuffer* workerBuffer);
+  void ClearBuffer();
+  // Change the capacity between runs (memory_budget_mb); the buffer must be empty
+  void SetBufferSize(G4int bufferSize);
+
+  G4int GetBufferEntries() const { return fBufferEntries; }
+  G4long GetTotalEntries() const { return fTotalEntries.load(); }
+  G4int GetBufferSize() const { return fBufferSize; }
+  G4bool IsBufferFull() const { return fBufferEntries >= fBufferSize; }
+  // Zone-map fields for the chunked container
+  static ChunkedOutput::Layout GetChunkLayout()
+  {
+    return {sizeof(BinaryCreationData), offsetof(BinaryCreationData, x), offsetof(BinaryCreationData, y), offsetof(BinaryCreationData, z),
+            offsetof(BinaryCreationData, energy), offsetof(BinaryCreationData, event_id)};
+  }
+  // Column files for output_layout = "columns"
+  static std::vector<ColumnarOutput::Column> GetColumns()
+  {
+    return {
+      {"pos", offsetof(BinaryCreationData, x), sizeof(float), 3, "<f4"},
+      {"dir", offsetof(BinaryCreationData, dirX), sizeof(float), 3, "<f4"},
+      {"energy", offsetof(BinaryCreationData, energy), sizeof(float), 1, "<f4"},
+      {"event_id", offsetof(BinaryCreationData, event_id), sizeof(uint32_t), 1, "<u4"},
+      {"track_id", offsetof(BinaryCreationData, track_id), sizeof(int32_t), 1, "<i4"},
+      {"parent_id", offsetof(BinaryCreationData, parent_id), sizeof(int32_t), 1, "<i4"},
+    };
+  }
+
+private:
+  void TrackCapacity();  // report capacity changes to MemoryBudget
+
+  std::vector<BinaryCreationData> fBuffer;
+  G4int fBufferSize;
+  G4int fBufferEntries;
+  std::atomic<G4long> fTotalEntries;  // master: AbsorbWorkerBuffer from all workers, no lock
+  std::string fOutputPath;
+  MemoryBudget::Component fComponent;
+  long long fTrackedBytes;
+};
+
+#endif
@@ -17,9 +17,13 @@
 
 #include "G4VUserDetectorConstruction.hh"   // 【GEANT4 内核】用户定义的几何构造基类
 #include "globals.hh"                       // 【GEANT4 内核】全局定义
+#include "Config.hh"                        // 【配置文件】VoxelMaterialSpec
+
+#include <vector>
 
 class G4VPhysicalVolume;
 class G4LogicalVolume;
+class G4Material;
 
 // 用户自定义几何构造类，继承自 Geant4 的抽象基类
 class DetectorConstruction : public G4VUserDetectorConstruction
@@ -32,6 +36,13 @@ class DetectorConstruction : public G4VUserDetectorConstruction
 
   private:
     G4LogicalVolume* fWaterLogical;         // 成员变量，指向水体的逻辑体积，用于后续步骤中识别水体，只能在类内部访问
+
+    // 体素模体（voxel_phantom.enabled）：在水箱位置放置容器，内部为 G4PhantomParameterisation 体素，
+    // 返回容器逻辑体积（替代 fWaterLogical）
+    G4LogicalVolume* ConstructVoxelPhantom(G4LogicalVolume* motherLogical, G4Material* water,
+                                           G4Material* air, G4bool checkOverlaps);
+    G4Material* BuildVoxelMaterial(const VoxelMaterialSpec& spec, G4Material* water, G4Material* air);
+    std::vector<size_t> fVoxelMaterialIndices;  // 每个体素的材料序号；G4PhantomParameterisation 只保存指针
 };
 
 #endif
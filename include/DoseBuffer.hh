@@ -7,15 +7,16 @@
 #define DoseBuffer_h 1
 
 #include "globals.hh"
+#include "MemoryBudget.hh"
+#include "ChunkedOutput.hh"
+#include "ColumnarOutput.hh"
+#include <cstddef>
 #include <vector>
 #include <string>
+#include <atomic>
 #include <fstream>
 #include <cstdint>
 
-#ifdef G4MULTITHREADED
-#include "G4AutoLock.hh"
-#endif
-
 // Structure for single dose deposit record (36 bytes, no padding)
 struct BinaryDoseData {
   float x, y, z;           // deposition position [cm]
@@ -38,24 +39,44 @@ public:
 
   void WriteBuffer(const std::string& filePath);
   void SetOutputPath(const std::string& filePath) { fOutputPath = filePath; }
+  const std::string& GetOutputPath() const { return fOutputPath; }
   void AbsorbWorkerBuffer(DoseBuffer* workerBuffer);
   void ClearBuffer();
+  // Change the capacity between runs (memory_budget_mb); the buffer must be empty
+  void SetBufferSize(G4int bufferSize);
 
   G4int GetBufferEntries() const { return fBufferEntries; }
-  G4long GetTotalEntries() const { return fTotalEntries; }
+  G4long GetTotalEntries() const { return fTotalEntries.load(); }
   G4int GetBufferSize() const { return fBufferSize; }
   G4bool IsBufferFull() const { return fBufferEntries >= fBufferSize; }
+  // Zone-map fields for the chunked container
+  static ChunkedOutput::Layout GetChunkLayout()
+  {
+    return {sizeof(BinaryDoseData), offsetof(BinaryDoseData, x), offsetof(BinaryDoseData, y), offsetof(BinaryDoseData, z),
+            offsetof(BinaryDoseData, energy), offsetof(BinaryDoseData, event_id)};
+  }
+  // Column files for output_layout = "columns"
+  static std::vector<ColumnarOutput::Column> GetColumns()
+  {
+    return {
+      {"pos", offsetof(BinaryDoseData, x), sizeof(float), 3, "<f4"},
+      {"rel_pos", offsetof(BinaryDoseData, dx), sizeof(float), 3, "<f4"},
+      {"energy", offsetof(BinaryDoseData, energy), sizeof(float), 1, "<f4"},
+      {"event_id", offsetof(BinaryDoseData, event_id), sizeof(uint32_t), 1, "<u4"},
+      {"pdg", offsetof(BinaryDoseData, pdg), sizeof(int32_t), 1, "<i4"},
+    };
+  }
 
 private:
+  void TrackCapacity();  // report capacity changes to MemoryBudget
+
   std::vector<BinaryDoseData> fBuffer;
   G4int fBufferSize;
   G4int fBufferEntries;
-  G4long fTotalEntries;
+  std::atomic<G4long> fTotalEntries;  // master: AbsorbWorkerBuffer from all workers, no lock
   std::string fOutputPath;
-
-#ifdef G4MULTITHREADED
-  static G4Mutex fBufferMutex;
-#endif
+  MemoryBudget::Component fComponent;
+  long long fTrackedBytes;
 };
 
 #endif
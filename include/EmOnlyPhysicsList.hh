@@ -0,0 +1,26 @@
+//
+// EmOnlyPhysicsList.hh
+// 6 MV 光子束的精简物理列表：只注册电磁物理（option0/3/4 可选），不含强子、衰变、离子物理。
+// 光学物理仍由 CherenkovSim.cc 按 cherenkov_mode 统一注册。
+//
+
+#ifndef EmOnlyPhysicsList_h
+#define EmOnlyPhysicsList_h 1
+
+#include "G4VModularPhysicsList.hh"
+#include "globals.hh"
+
+class G4VPhysicsConstructor;
+
+class EmOnlyPhysicsList : public G4VModularPhysicsList
+{
+  public:
+    explicit EmOnlyPhysicsList(G4int emOption = 4);
+    ~EmOnlyPhysicsList() override = default;
+
+    // emOption: 0 = G4EmStandardPhysics, 3 = _option3, 4 = _option4（其他值按 4 处理）
+    // FTFP_BERT 替换电磁物理时也用这个工厂，两种列表的电磁模型保持一致
+    static G4VPhysicsConstructor* CreateEmPhysics(G4int emOption);
+};
+
+#endif
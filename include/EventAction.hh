@@ -7,22 +7,13 @@
 
 #include "G4UserEventAction.hh"
 #include "globals.hh"
-#include <map>
+#include "G4ThreeVector.hh"
+#include "PhotonTable.hh"
 #include <fstream>
 #include <chrono>
-#include <atomic>
 
 class RunAction;
 
-struct PhotonData {
-  G4double initialX, initialY, initialZ;
-  G4double initialDirX, initialDirY, initialDirZ;
-  G4double finalX, finalY, finalZ;
-  G4double finalDirX, finalDirY, finalDirZ;
-  G4double finalEnergy;
-  G4bool hasData;
-};
-
 class EventAction : public G4UserEventAction
 {
   public:
@@ -31,30 +22,53 @@ class EventAction : public G4UserEventAction
 
     virtual void BeginOfEventAction(const G4Event* event);
     virtual void EndOfEventAction(const G4Event* event);
+    // sub-event 模式（optical_subevent_size）：worker 处理完一个光子 sub-event 后在 master 上调用。
+    // 记录已由 worker 按母事件的 event_id 写出，这里只计数，run_meta 中与 photons_to_subevents 对照
+    virtual void MergeSubEvent(G4Event* masterEvent, const G4Event* subEvent);
+
+    // 当前事件是 sub-event：其光子已在 master 上做过子采样/轮盘赌并分类，StackingAction 直接放行
+    G4bool IsSubEvent() const { return fSubEvent; }
 
     void RecordPhotonCreation(G4int trackID, G4double x, G4double y, G4double z,
-                             G4double dirx, G4double diry, G4double dirz);
+                             G4double dirx, G4double diry, G4double dirz,
+                             G4double weight = 1.0);
+    // weight: 终止时的轨迹权重（吸收加权时含 exp(-L/ABSLENGTH) 衰减），覆盖产生时的权重
     void RecordPhotonEnd(G4int trackID, G4double x, G4double y, G4double z,
-                        G4double dirx, G4double diry, G4double dirz, G4double energy);
+                        G4double dirx, G4double diry, G4double dirz, G4double energy,
+                        G4double weight);
 
     void RecordDoseData(G4double x, G4double y, G4double z, G4double energy, G4int pdg);
 
+    // creation_only 模式：光子在入栈时记录并被杀掉，不经过 RecordPhotonCreation/End
+    void RecordPhotonBirth(G4int trackID, G4int parentID,
+                           G4double x, G4double y, G4double z,
+                           G4double dirx, G4double diry, G4double dirz, G4double energy);
+
+    // yield_only 模式：带电粒子步的 Frank–Tamm 期望光子数（转发给 RunAction 的体素网格）
+    void RecordCherenkovYield(const G4ThreeVector& pre, const G4ThreeVector& post,
+                              G4double yieldPre, G4double yieldPost, G4double expected);
+
+    // 步数 / 阈值截断统计：事件内累加，EndOfEventAction 时并入本线程的 RunStatistics
+    void CountStep() { ++fEventSteps; }
+    void CountThresholdKill(G4double kineticEnergy) { ++fEventThresholdKills; fEventThresholdKilledEnergy += kineticEnergy; }
+    void CountEnvelopeKill(G4bool charged) { ++(charged ? fEventEnvelopeKillsCharged : fEventEnvelopeKillsNeutral); }
+
   private:
     RunAction* fRunAction;
-    std::map<G4int, PhotonData> fPhotonDataMap;
+    PhotonTable fPhotonTable;  // 本事件在途光子，按 track ID 索引，容量跨事件复用
+    long long fPhotonTableBytes;  // 已计入 MemoryBudget 的表容量
 
     G4double fPrimaryVertexX, fPrimaryVertexY, fPrimaryVertexZ;
     G4int fCurrentEventId;
     G4bool fHasPrimaryVertex;
+    G4bool fSubEvent;
 
-  public:
-    static std::atomic<G4int> fTotalPhotonCount;
-    static G4int GetTotalPhotonCount() { return fTotalPhotonCount.load(); }
-    static void ResetPhotonCount() { fTotalPhotonCount.store(0); }
+    long fEventSteps;
+    long fEventThresholdKills;
+    G4double fEventThresholdKilledEnergy;
+    long fEventEnvelopeKillsCharged;
+    long fEventEnvelopeKillsNeutral;
 
-    static std::atomic<long> fDoseDepositsWithoutPrimary;
-    static long GetDoseDepositsWithoutPrimary() { return fDoseDepositsWithoutPrimary.load(); }
-    static void ResetDoseDepositsWithoutPrimary() { fDoseDepositsWithoutPrimary.store(0); }
 };
 
 #endif
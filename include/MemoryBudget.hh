@@ -0,0 +1,65 @@
+//
+// MemoryBudget.hh
+// 输出缓冲的内存预算（simulation.memory_budget_mb）：每个 run 开始时由 master 按当前线程数与写盘队列深度
+// 把预算切成若干"缓冲组"（每个 worker 一组、排队中的缓冲各一组、顺序模式下 master 一组），
+// 组内按各输出流原来的字节份额（buffer_size / dose_buffer_size × 记录字节）分给 .phsp / .dose / .creation；
+// full 模式另留 1/8 给各线程的 PhotonTable。预算为 0 时沿用 buffer_size / nThreads 的旧规则。
+// 不论是否设预算，各部分实际占用的字节数都会统计，峰值写入 run_meta 的 "memory"。
+//
+
+#ifndef MemoryBudget_h
+#define MemoryBudget_h 1
+
+#include "globals.hh"
+#include <cstddef>
+#include <string>
+
+namespace MemoryBudget {
+
+// 统计占用的部分
+enum Component {
+  kWorkerBuffers,   // worker 的 Photon/Dose/CreationBuffer
+  kMasterBuffers,   // master 的缓冲（顺序模式下即全部缓冲）
+  kWriterQueue,     // 已交给 AsyncWriter、尚未写完的缓冲
+  kPhotonTables,    // 各线程 EventAction 的在途光子表
+  kNumComponents
+};
+
+// 分配预算的输出流
+enum Stream {
+  kPhotonStream,    // .phsp
+  kDoseStream,      // .dose
+  kCreationStream,  // .creation
+  kNumStreams
+};
+
+// main 中按 Config 设置；0 = 不设预算
+void SetBudgetMB(G4double megabytes);
+G4double GetBudgetMB();
+G4bool IsEnabled();
+
+// master 的 BeginOfRunAction 调用（先于各 worker 的 BeginOfRunAction）。
+// nWorkers：MT 下的 worker 数，顺序模式为 0；queueDepth：最多同时在途的缓冲数（pwrite / 同步写为 0）；
+// recordBytes[s]：流 s 每条记录的字节数，0 = 本 run 未启用；weights[s]：组内份额；photonTables：full 模式
+void Plan(G4int nWorkers, G4int queueDepth, G4bool photonTables,
+          const size_t recordBytes[kNumStreams], const G4double weights[kNumStreams]);
+
+// 本 run 每个缓冲的记录数上限（调用线程是 worker 还是 master 决定取哪一份）；未设预算返回 0
+G4int GetBufferRecords(Stream stream);
+// 每线程 PhotonTable 在事件之间保留的槽数上限；0 = 不限
+size_t GetPhotonTableSlots();
+
+// 各部分的占用变化（字节，可为负）；只在缓冲换块/事件结束时调用，不在逐光子路径上
+void Add(Component component, long long bytes);
+
+// master 的 BeginOfRunAction：峰值从当前占用重新开始
+void ResetPeaks();
+long long GetPeak(Component component);
+long long GetTotalPeak();
+
+// run_meta 的 "memory" 字段
+std::string ToJson();
+
+}  // namespace MemoryBudget
+
+#endif
@@ -0,0 +1,38 @@
+//
+// PhantomGeometry.hh
+// 水模体（轴对齐长方体）的解析几何：包含判断、射线出射距离与出射面法向
+// 数值来自 config.json 的 geometry 段，与 DetectorConstruction 使用同一来源
+//
+
+#ifndef PhantomGeometry_h
+#define PhantomGeometry_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+class PhantomGeometry
+{
+  public:
+    PhantomGeometry();  // 从 Config 读取 water_size_xyz_cm / water_position_cm
+    ~PhantomGeometry() = default;
+
+    // margin > 0：判断是否在向外扩展 margin 的包络盒内
+    G4bool Contains(const G4ThreeVector& p, G4double margin = 0.0) const;
+
+    // 从模体内部点 p 沿单位方向 dir 到达表面的距离（Geant4 长度单位）。
+    // outwardNormal 返回出射面的外法向（±x/±y/±z）。p 不在模体内时返回 -1。
+    G4double DistanceToExit(const G4ThreeVector& p, const G4ThreeVector& dir,
+                            G4ThreeVector* outwardNormal = nullptr) const;
+
+    // 从模体外部点 p 沿 dir 到达模体表面的距离；射线不与模体相交（或 p 在模体内）时返回 -1
+    G4double DistanceToIn(const G4ThreeVector& p, const G4ThreeVector& dir) const;
+
+    const G4ThreeVector& GetCenter() const { return fCenter; }
+    const G4ThreeVector& GetHalfSize() const { return fHalf; }
+
+  private:
+    G4ThreeVector fCenter;
+    G4ThreeVector fHalf;
+};
+
+#endif
@@ -7,15 +7,19 @@
 #define PhotonBuffer_h 1
 
 #include "globals.hh"
+#include "PhotonTable.hh"
+#include "MemoryBudget.hh"
+#include "ChunkedOutput.hh"
+#include "ColumnarOutput.hh"
+#include "CompactPhoton.hh"
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
+#include <atomic>
 #include <fstream>
 
-#ifdef G4MULTITHREADED
-#include "G4AutoLock.hh"
-#endif
-
 // Structure to hold single photon data for binary output (v2, 60 bytes)
 struct BinaryPhotonData {
     float initX, initY, initZ;          // Initial position (cm)
@@ -28,10 +32,19 @@ struct BinaryPhotonData {
 };
 static_assert(sizeof(BinaryPhotonData) == 60, "BinaryPhotonData must be 60 bytes for format v2");
 
+// Weighted record (v3, 64 bytes): v2 record followed by the statistical weight.
+// Weighted runs buffer this layout; unweighted runs buffer BinaryPhotonData (60 bytes) directly.
+struct BinaryWeightedPhotonData {
+    BinaryPhotonData photon;
+    float weight;                       // photon weight (1 = analog)
+};
+static_assert(sizeof(BinaryWeightedPhotonData) == 64, "BinaryWeightedPhotonData must be 64 bytes for format v3");
+
 class PhotonBuffer
 {
 public:
-    PhotonBuffer(G4int bufferSize = 10000);
+    // compact != nullptr: photon_format = "compact" (v4, 24-byte records with event frames, CompactPhoton.hh)
+    PhotonBuffer(G4int bufferSize = 10000, G4bool weighted = false, const CompactPhotonCodec* compact = nullptr);
     ~PhotonBuffer();
     
     // Add photon data to buffer
@@ -39,13 +52,18 @@ public:
               G4double initDirX, G4double initDirY, G4double initDirZ,
               G4double finalX, G4double finalY, G4double finalZ,
               G4double finalDirX, G4double finalDirY, G4double finalDirZ,
-              G4double finalEnergy, G4int event_id, G4int track_id);
+              G4double finalEnergy, G4int event_id, G4int track_id,
+              G4double weight = 1.0);
+    
+    // Append all completed photons of one event (PhotonTable, G4 units) in one reserve-and-convert pass
+    void FillEvent(const PhotonTable& table, G4int event_id);
     
-    // Write buffer to binary file
+    // Write buffer to binary file (60 bytes per photon, or 64 when weighted; compact: 24 per photon/frame)
     void WriteBuffer(const std::string& filePath);
     
     // Set output path for automatic flush
     void SetOutputPath(const std::string& filePath) { fOutputPath = filePath; }
+    const std::string& GetOutputPath() const { return fOutputPath; }
     
     // Absorb data from worker buffer (for master thread)
     void AbsorbWorkerBuffer(PhotonBuffer* workerBuffer);
@@ -53,24 +71,81 @@ public:
     // Clear buffer
     void ClearBuffer();
     
+    // Change the capacity between runs (memory_budget_mb); the buffer must be empty
+    void SetBufferSize(G4int bufferSize);
+    
     // Get statistics
     G4int GetBufferEntries() const { return fBufferEntries; }
-    G4long GetTotalEntries() const { return fTotalEntries; }
+    // Records held (photons, plus event frames in compact format); capacity is counted in records
+    G4int GetBufferRecords() const { return fCompact ? static_cast<G4int>(fCompactBuffer.size()) : fBufferEntries; }
+    G4long GetTotalEntries() const { return fTotalEntries.load(); }
     G4int GetBufferSize() const { return fBufferSize; }
+    G4bool IsWeighted() const { return fWeighted; }
+    G4bool IsCompact() const { return fCompact != nullptr; }
+    const CompactPhotonCodec* GetCompactCodec() const { return fCompact.get(); }
+    size_t GetRecordBytes() const
+    {
+        if (fCompact) return sizeof(CompactRecord);
+        return fWeighted ? sizeof(BinaryWeightedPhotonData) : sizeof(BinaryPhotonData);
+    }
+    // Bytes one buffered record occupies in memory (MemoryBudget); equal to the written record size
+    size_t GetBufferRecordBytes() const { return GetRecordBytes(); }
+    // Compact format: photons whose position or wavelength was clamped to the encodable range since the last call
+    G4long TakeClampedPhotons() { const G4long n = fClampedPhotons; fClampedPhotons = 0; return n; }
+    // Zone-map fields for the chunked container: final position, final energy, event_id
+    // (full format only; compact records depend on their event frame and are never chunked)
+    ChunkedOutput::Layout GetChunkLayout() const
+    {
+        return {GetRecordBytes(), offsetof(BinaryPhotonData, finalX), offsetof(BinaryPhotonData, finalY),
+                offsetof(BinaryPhotonData, finalZ), offsetof(BinaryPhotonData, finalEnergy),
+                offsetof(BinaryPhotonData, event_id)};
+    }
+    // Column files for output_layout = "columns" (full format only; compact records stay a framed record stream)
+    std::vector<ColumnarOutput::Column> GetColumns() const
+    {
+        std::vector<ColumnarOutput::Column> columns = {
+            {"init_pos", offsetof(BinaryPhotonData, initX), sizeof(float), 3, "<f4"},
+            {"init_dir", offsetof(BinaryPhotonData, initDirX), sizeof(float), 3, "<f4"},
+            {"final_pos", offsetof(BinaryPhotonData, finalX), sizeof(float), 3, "<f4"},
+            {"final_dir", offsetof(BinaryPhotonData, finalDirX), sizeof(float), 3, "<f4"},
+            {"final_energy", offsetof(BinaryPhotonData, finalEnergy), sizeof(float), 1, "<f4"},
+            {"event_id", offsetof(BinaryPhotonData, event_id), sizeof(uint32_t), 1, "<u4"},
+            {"track_id", offsetof(BinaryPhotonData, track_id), sizeof(int32_t), 1, "<i4"},
+        };
+        if (fWeighted) {
+            columns.push_back({"weight", offsetof(BinaryWeightedPhotonData, weight), sizeof(float), 1, "<f4"});
+        }
+        return columns;
+    }
     
     // Check if buffer is full
-    G4bool IsBufferFull() const { return fBufferEntries >= fBufferSize; }
+    G4bool IsBufferFull() const { return GetBufferRecords() >= fBufferSize; }
     
 private:
-    std::vector<BinaryPhotonData> fBuffer;
+    // Report capacity changes to MemoryBudget (worker or master component)
+    void TrackCapacity();
+    // Reserve fBufferSize records in the vector of the active format
+    void Reserve();
+    // Compact format: encode one photon into fCompactBuffer, opening a new event frame when needed
+    void FillCompact(G4double initX, G4double initY, G4double initZ,
+                     G4double initDirX, G4double initDirY, G4double initDirZ,
+                     G4double finalX, G4double finalY, G4double finalZ,
+                     G4double finalDirX, G4double finalDirY, G4double finalDirZ,
+                     G4double finalEnergy, uint32_t event_id, G4double weight);
+    
+    std::vector<BinaryWeightedPhotonData> fBuffer;      // weighted (v3)
+    std::vector<BinaryPhotonData> fPlainBuffer;         // unweighted (v2): no unused weight slot per record
+    G4bool fWeighted;
     G4int fBufferSize;
     G4int fBufferEntries;
-    G4long fTotalEntries;
+    std::atomic<G4long> fTotalEntries;  // master: AbsorbWorkerBuffer from all workers, no lock
     std::string fOutputPath;  // Output file path for auto-flush
-    
-#ifdef G4MULTITHREADED
-    static G4Mutex fBufferMutex;
-#endif
+    MemoryBudget::Component fComponent;
+    long long fTrackedBytes;
+    std::unique_ptr<CompactPhotonCodec> fCompact;
+    std::vector<CompactRecord> fCompactBuffer;
+    long long fFrameIndex;    // open event frame in fCompactBuffer (-1 = none); frames never span buffers
+    G4long fClampedPhotons;
 };
 
 #endif
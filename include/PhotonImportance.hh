@@ -0,0 +1,46 @@
+//
+// PhotonImportance.hh
+// 光子产生时的重要性 I(位置, 方向, 能量) ∈ (0, 1]，用于入栈时的 Russian roulette：
+//   I = QE(E)/max(QE) × T(位置, 方向, E)
+// QE 为相机量子效率曲线（未配置时为 1）；配置了目标面时，直线到达该面且不全反射的光子
+// T = exp(-L/ABSLENGTH_水(E))（L 为到出射面的距离），其余 T = importance_off_target。
+// 存活概率 p = max(I, importance_min_survival)，存活光子权重乘 1/p，期望值不变。
+//
+
+#ifndef PhotonImportance_h
+#define PhotonImportance_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include "PhantomGeometry.hh"
+#include <vector>
+
+class PhotonImportance
+{
+  public:
+    PhotonImportance();  // 从 Config 读取 variance_reduction.importance_* 与水的光学表
+    ~PhotonImportance() = default;
+
+    G4double Evaluate(const G4ThreeVector& position, const G4ThreeVector& direction, G4double energy) const;
+
+    // Russian roulette 的存活概率
+    G4double SurvivalProbability(const G4ThreeVector& position, const G4ThreeVector& direction,
+                                 G4double energy) const;
+
+  private:
+    // 分段线性插值，超出范围取端点值
+    static G4double Interpolate(const std::vector<G4double>& x, const std::vector<G4double>& y, G4double at);
+
+    PhantomGeometry fGeometry;
+    std::vector<G4double> fQEEnergy;       // Geant4 能量单位
+    std::vector<G4double> fQE;             // 已除以 max(QE)
+    G4bool fHasTarget;
+    G4ThreeVector fTargetNormal;           // 目标面外法向
+    G4double fOffTarget;
+    G4double fMinSurvival;
+    std::vector<G4double> fWaterEnergy;    // 水的 RINDEX / ABSLENGTH 节点（Geant4 单位）
+    std::vector<G4double> fWaterRindex;
+    std::vector<G4double> fWaterAbsLength;
+};
+
+#endif
@@ -0,0 +1,99 @@
+//
+// PhotonTable.hh - Per-thread table of in-flight optical photons
+//
+// 取代 std::map<G4int, PhotonData>：按 track ID 直接索引的平铺 vector，容量跨事件保留。
+// 每个槽带事件代号（generation），Clear() 只递增代号，不逐个释放/清零；
+// 字段为 float（输出本来就是 float），一个槽 64 字节，恰好一条 cache line。
+//
+
+#ifndef PhotonTable_h
+#define PhotonTable_h 1
+
+#include "globals.hh"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+struct PhotonData {
+  float initialX, initialY, initialZ;
+  float initialDirX, initialDirY, initialDirZ;
+  float finalX, finalY, finalZ;
+  float finalDirX, finalDirY, finalDirZ;
+  float finalEnergy;
+  float weight;
+  uint32_t generation;  // 等于表的当前代号才有效
+  uint32_t hasData;     // RecordPhotonEnd 已填写终点
+};
+static_assert(sizeof(PhotonData) == 64, "PhotonData should fill one cache line");
+
+class PhotonTable
+{
+public:
+  PhotonTable() : fGeneration(1), fMinId(0), fMaxId(-1) {}
+
+  // 新事件：已有槽全部失效，容量保留
+  void Clear()
+  {
+    if (++fGeneration == 0) {  // 回绕：旧代号可能重新变得"有效"，只能真清零
+      for (auto& slot : fSlots) slot.generation = 0;
+      fGeneration = 1;
+    }
+    fMinId = 0;
+    fMaxId = -1;
+  }
+
+  // 释放全部槽（memory_budget_mb 的槽数上限；只在事件之间调用）
+  void Release()
+  {
+    std::vector<PhotonData>().swap(fSlots);
+    Clear();
+  }
+
+  // 创建（或覆盖）trackID 的槽；track ID 在事件内从 1 递增，几乎都是 O(1) 追加
+  PhotonData& Insert(G4int trackID)
+  {
+    const size_t index = static_cast<size_t>(trackID);
+    if (index >= fSlots.size()) {
+      fSlots.resize(std::max(index + 1, fSlots.size() * 2), PhotonData{});
+    }
+    if (fMaxId < fMinId) {
+      fMinId = fMaxId = trackID;
+    } else {
+      if (trackID < fMinId) fMinId = trackID;
+      if (trackID > fMaxId) fMaxId = trackID;
+    }
+    PhotonData& slot = fSlots[index];
+    slot.generation = fGeneration;
+    slot.hasData = 0;
+    return slot;
+  }
+
+  // 本事件中不存在返回 nullptr
+  PhotonData* Find(G4int trackID)
+  {
+    if (trackID < fMinId || trackID > fMaxId) return nullptr;
+    PhotonData& slot = fSlots[static_cast<size_t>(trackID)];
+    return slot.generation == fGeneration ? &slot : nullptr;
+  }
+
+  // 按 track ID 升序访问本事件有终点的光子（与原 std::map 的输出顺序一致）
+  template <class Func>
+  void ForEachComplete(Func&& func) const
+  {
+    for (G4int id = fMinId; id <= fMaxId; ++id) {
+      const PhotonData& slot = fSlots[static_cast<size_t>(id)];
+      if (slot.generation == fGeneration && slot.hasData) func(id, slot);
+    }
+  }
+
+  // 本事件用到的 track ID 个数，是有终点光子数的上界（批量写出时预留空间）
+  size_t RangeSize() const { return fMaxId >= fMinId ? static_cast<size_t>(fMaxId - fMinId + 1) : 0; }
+  size_t Capacity() const { return fSlots.size(); }
+
+private:
+  std::vector<PhotonData> fSlots;
+  uint32_t fGeneration;
+  G4int fMinId, fMaxId;  // 本事件用到的 track ID 范围，fMaxId < fMinId 表示空
+};
+
+#endif
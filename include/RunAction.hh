@@ -10,6 +10,8 @@
 #include "G4Threading.hh"
 #include "PhotonBuffer.hh"
 #include "DoseBuffer.hh"
+#include "CreationBuffer.hh"
+#include "YieldGrid.hh"
 #include <string>
 #include <fstream>
 #include <chrono>
@@ -31,12 +33,26 @@ class RunAction : public G4UserRunAction
                          G4double initDirX, G4double initDirY, G4double initDirZ,
                          G4double finalX, G4double finalY, G4double finalZ,
                          G4double finalDirX, G4double finalDirY, G4double finalDirZ,
-                         G4double finalEnergy, G4int event_id, G4int track_id);
+                         G4double finalEnergy, G4int event_id, G4int track_id,
+                         G4double weight = 1.0);
+
+    // 一个事件的全部完成光子：binary 时整批转换并追加到本线程缓冲，CSV 时逐个走 RecordPhotonData
+    void RecordPhotonEvent(const PhotonTable& table, G4int event_id);
 
     void RecordDoseData(G4double x, G4double y, G4double z,
                         G4double dx, G4double dy, G4double dz,
                         G4double energy, G4int event_id, G4int pdg);
 
+    // creation_only 模式：光子产生点记录，由 EventAction::RecordPhotonBirth 调用
+    void RecordCreationData(G4double x, G4double y, G4double z,
+                            G4double dirX, G4double dirY, G4double dirZ,
+                            G4double energy, G4int event_id, G4int track_id, G4int parent_id);
+
+    // yield_only 模式：带电粒子步的期望光子数，由 EventAction 转发；事件结束时提交
+    void RecordCherenkovYield(const G4ThreeVector& pre, const G4ThreeVector& post,
+                              G4double yieldPre, G4double yieldPost, G4double expected);
+    void EndOfEventYield();
+
   private:
     // Output format: CSV or Binary
     std::string fOutputFormat;
@@ -50,6 +66,17 @@ class RunAction : public G4UserRunAction
     static PhotonBuffer* fMasterBuffer;
     static thread_local DoseBuffer* fThreadDoseBuffer;
     static DoseBuffer* fMasterDoseBuffer;
+    static thread_local CreationBuffer* fThreadCreationBuffer;
+    static CreationBuffer* fMasterCreationBuffer;
+    static thread_local YieldGrid* fThreadYieldGrid;
+    static YieldGrid* fMasterYieldGrid;
+
+    // Cherenkov mode from config ("full", "creation_only", "analytic", "yield_only")
+    std::string fCherenkovMode;
+    // Photon records carry a weight (format v3, 64 bytes), see Config::GetPhotonWeightingEnabled
+    G4bool fPhotonWeighting;
+    // photon_format = "compact": v4 records (24 bytes, event frames), see CompactPhoton.hh
+    G4bool fCompactPhotons;
 
     // Performance timing
     std::chrono::high_resolution_clock::time_point fStartTime;
@@ -61,7 +88,16 @@ class RunAction : public G4UserRunAction
     void WriteCSVHeader(std::ofstream& out);
     void MergeCSVThreadFiles();
     void WriteBinaryHeader(const std::string& headerPath);
+    void WriteCompactBinaryHeader(std::ofstream& headerFile);
+    PhotonBuffer* NewPhotonBuffer(G4int bufferSize);
     void WriteDoseHeader(const std::string& headerPath);
+    void SetUpCreationOutput(G4int bufferSize);
+    void WriteCreationHeader(const std::string& headerPath);
+    void SetUpYieldOutput();
+    void FlushPhotonBufferIfFull(PhotonBuffer* buffer);
+    void FlushPhotonBuffer(PhotonBuffer* buffer);
+    void PlanMemoryBudget();
+    void ApplyMemoryBudget();
 };
 
 #endif
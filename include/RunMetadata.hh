@@ -7,6 +7,8 @@
 #define RunMetadata_h 1
 
 #include <string>
+#include <utility>
+#include <vector>
 
 class G4Run;
 
@@ -24,7 +26,9 @@ void Write(const std::string& metaPath,
            int numThreads,
            long totalDeposits = 0,
            const std::string& doseOutputBasePath = "",
-           long doseDepositsWithoutPrimary = 0);
+           long doseDepositsWithoutPrimary = 0,
+           const std::vector<std::pair<std::string, std::string>>& extraFields = {});
+// extraFields：按模式附加的字段，value 须是已格式化的 JSON 值（数字、或带引号的字符串）
 
 }  // namespace RunMetadata
 
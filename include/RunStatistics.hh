@@ -0,0 +1,59 @@
+//
+// RunStatistics.hh
+// Run 级计数（光子数、沉积数、步数、截断/子采样/轮盘赌统计、栈峰值）：每线程一份 64 位 G4Accumulable，
+// 热路径上只写本线程的值，无共享 cache line；EndOfRunAction 中 Merge 后 master 读合并结果
+//
+
+#ifndef RunStatistics_h
+#define RunStatistics_h 1
+
+#include "globals.hh"
+
+namespace RunStatistics {
+
+// 求和计数
+enum Counter {
+  kPhotons,                 // 记录的 Cherenkov 光子（full/analytic 的 RecordPhotonCreation，creation_only 的产生点）
+  kDeposits,                // 写入 dose 缓冲的沉积
+  kDepositsWithoutPrimary,  // 事件无初级顶点、相对坐标记为 0 的沉积
+  kPhotonsGenerated,        // photon_yield_fraction < 1：StackingAction 看到的 Cherenkov 光子
+  kPhotonsSubsampledAway,   //   其中按 1-f 概率丢弃的
+  kPhotonsRouletteTested,   // importance_roulette：参与轮盘赌的光子
+  kPhotonsRouletted,        //   其中被杀掉的
+  kPhotonsToSubEvents,      // optical_subevent_size：master 上分类为 sub-event 的光子
+  kSubEventsMerged,         //   worker 处理完、在 master 上合并的 sub-event
+  kSteps,                   // 全部粒子的步数
+  kThresholdKills,          // cherenkov_threshold_kill 杀掉的电子
+  kEnvelopeKillsCharged,    // scoring_envelope_margin_cm：离开包络被杀的带电 / 中性粒子
+  kEnvelopeKillsNeutral,
+  kCompactClamped,          // photon_format = compact：位置或波长超出可编码范围、被截断的光子
+  kNumCounters
+};
+
+// 取各线程最大值
+enum Peak {
+  kPeakStackedTracks,       // 单线程栈内 G4Track 数的峰值
+  kPeakDeferredPhotons,     // staged 模式下暂存光子记录数的峰值
+  kNumPeaks
+};
+
+// 为本线程创建并向 G4AccumulableManager 注册全部计数；每个线程的 RunAction 构造时调用一次
+void RegisterThread();
+void ReleaseThread();
+
+// BeginOfRunAction（每个线程）清零；EndOfRunAction（每个线程，worker 先于 master）合并
+void Reset();
+void Merge();
+
+void Add(Counter counter, G4long n = 1);
+void AddThresholdKilledEnergy(G4double energy);  // G4 内部单位
+void UpdatePeak(Peak peak, G4long value);
+
+// master 上 Merge 之后为全 run 合计；worker 上为本线程值
+G4long Get(Counter counter);
+G4long GetPeak(Peak peak);
+G4double GetThresholdKilledEnergy();
+
+}  // namespace RunStatistics
+
+#endif
@@ -0,0 +1,65 @@
+//
+// StackingAction.hh
+// 在光子入栈时做决定：creation_only 模式下记录产生点后直接杀掉，不做光学输运；
+// analytic 模式下解析计算吸收点/出射点，写出与 full 模式相同的记录后杀掉；
+// photon_yield_fraction f < 1 时按概率 f 保留 Cherenkov 光子并赋权重 1/f（其余直接杀掉）；
+// importance_roulette 时按产生点重要性 I 以概率 p = max(I, p_min) 保留，权重乘 1/p；
+// optical_stacking = "staged" 时 full 模式的 Cherenkov 光子先存为紧凑记录（不占 G4Track），
+// 带电簇射结束（urgent 栈空，NewStage）后每次重新注入 optical_batch_size 个，栈内峰值有界；
+// optical_subevent_size > 0 时 master 上重事件中超过阈值的光子分类为 fSubEvent_0，由 worker 以 sub-event 输运
+//
+
+#ifndef StackingAction_h
+#define StackingAction_h 1
+
+#include "G4UserStackingAction.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class EventAction;
+class AnalyticOpticalTransport;
+class PhotonImportance;
+class G4Track;
+class G4VProcess;
+
+class StackingAction : public G4UserStackingAction
+{
+  public:
+    StackingAction(EventAction* eventAction);
+    virtual ~StackingAction();
+
+    virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track);
+    virtual void NewStage();
+    virtual void PrepareNewEvent();
+
+  private:
+    EventAction* fEventAction;
+    G4bool       fCreationOnly;
+    G4double     fYieldFraction;
+    AnalyticOpticalTransport* fAnalyticTransport;  // 仅 analytic 模式下非空
+    PhotonImportance* fImportance;                 // 仅 importance_roulette 时非空
+
+    // staged stacking：重建 G4Track 所需的最小信息（约 120 字节，G4Track + G4DynamicParticle 约 5 倍）
+    struct DeferredPhoton {
+      G4ThreeVector position;
+      G4ThreeVector direction;
+      G4ThreeVector polarization;
+      G4double energy;
+      G4double time;
+      G4double weight;
+      G4int trackID;
+      G4int parentID;
+      const G4VProcess* creator;
+    };
+    G4bool fStaged;
+    size_t fBatchSize;
+    G4bool fReinjecting;                  // NewStage 重新注入期间，ClassifyNewTrack 直接返回 fUrgent
+    std::vector<DeferredPhoton> fDeferred;
+    G4int fSubEventSize;                  // > 0：重事件光子交给 sub-event 并行输运
+    long fSubEventMinPhotons;
+    long fEventPhotons;                   // 本事件已入栈的 Cherenkov 光子数
+};
+
+#endif
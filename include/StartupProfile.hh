@@ -0,0 +1,27 @@
+//
+// StartupProfile.hh
+// 记录 main() 中各启动阶段的墙钟耗时（配置、RunManager、物理表、宏等），由 RunAction 写入 run_meta.json
+//
+
+#ifndef StartupProfile_h
+#define StartupProfile_h 1
+
+#include <string>
+
+namespace StartupProfile {
+
+// 起点：main() 开头调用一次
+void Start();
+
+// 记录从上一个标记（或 Start）到现在的耗时，归入阶段 phase；同名阶段累加
+void Mark(const std::string& phase);
+
+// 物理表缓存状态："disabled" / "retrieved" / "stored"，以及缓存目录
+void SetPhysicsTableCache(const std::string& status, const std::string& directory);
+
+// {"phases_seconds": {...}, "total_seconds": x, "physics_table_cache": "...", ...}；未 Start 时返回空串
+std::string ToJson();
+
+}  // namespace StartupProfile
+
+#endif
@@ -6,10 +6,15 @@
 #define SteppingAction_h 1
 
 #include "G4UserSteppingAction.hh"
+#include "G4MaterialPropertyVector.hh"
 #include "globals.hh"
+#include "PhantomGeometry.hh"
 
 class EventAction;
+class CherenkovYieldTable;
+class CherenkovDirectionBias;
 class G4LogicalVolume;
+class G4Material;
 
 class SteppingAction : public G4UserSteppingAction
 {
@@ -21,6 +26,26 @@ class SteppingAction : public G4UserSteppingAction
 
   private:
     EventAction*  fEventAction;
+    CherenkovYieldTable* fYieldTable;  // 仅 yield_only 模式下非空
+
+    // optical_absorption_weighting：OpAbsorption 关闭，每步按 exp(-step/ABSLENGTH(E)) 衰减光子权重
+    G4bool fAbsorptionWeighting;
+    const G4Material* fAbsMaterial;        // 上一次查表的材料（光子通常整段都在同一材料内）
+    G4MaterialPropertyVector* fAbsLength;  // fAbsMaterial 的 ABSLENGTH，无则为 nullptr
+
+    // cherenkov_threshold_kill：模体内动能低于 Cherenkov 阈值的电子不再发光，直接终止
+    G4double ElectronCherenkovThreshold(const G4Material* material);
+    G4bool fThresholdKill;
+    G4double fElectronThreshold;  // 所有材料中最低的动能阈值；< 0 表示尚未计算
+
+    // direction_bias_target：本步产生的 Cherenkov 光子入栈前按目标重新抽样方位角
+    CherenkovDirectionBias* fDirectionBias;  // 未开启时为 nullptr
+    const G4Material* fBiasMaterial;         // 上一次取 RINDEX 的材料（全反射判断）
+    G4MaterialPropertyVector* fBiasRindex;
+
+    // scoring_envelope_margin_cm：模体外扩 margin 的包络，出包络且直线不再回到模体的粒子直接终止
+    PhantomGeometry fPhantomGeometry;
+    G4double fEnvelopeMargin;  // Geant4 长度单位；< 0 表示关闭
 };
 
 #endif
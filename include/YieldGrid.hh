@@ -0,0 +1,73 @@
+//
+// YieldGrid.hh
+// yield_only 模式的体素网格：累加每个事件的 Cherenkov 期望光子数，
+// 并按事件记录 Σy 与 Σy²，用于给出逐体素的统计不确定度。
+// 网格默认与 analysis/build_cherenkov_kernel.py 相同：水模体边界，
+// dv = clamp(L_max/100, 0.3, 0.8) cm；可用 simulation.yield_voxel_size_cm 覆盖。
+// 同 DoseBuffer 的 Master/Worker 模式：worker 独立累加，Run 结束时加锁合并到 master。
+//
+
+#ifndef YieldGrid_h
+#define YieldGrid_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include <vector>
+#include <string>
+
+#ifdef G4MULTITHREADED
+#include "G4AutoLock.hh"
+#endif
+
+class YieldGrid
+{
+  public:
+    YieldGrid();
+    ~YieldGrid() = default;
+
+    // 一个带电粒子步：总期望光子数 expected 沿步长按 yieldPre→yieldPost 线性分布
+    // （与 G4Cerenkov 在步内放置光子的方式一致），细分后累加到所经过的体素
+    void AddStep(const G4ThreeVector& pre, const G4ThreeVector& post,
+                 G4double yieldPre, G4double yieldPost, G4double expected);
+
+    // 事件结束：把本事件的体素值并入 Σy、Σy²，并清空事件暂存
+    void EndOfEvent();
+
+    // 清零累加值（网格不变）：每个 run 开始时调用，避免多次 beamOn 累加
+    void Reset();
+
+    // Master 合并 worker 网格（加锁）
+    void Merge(const YieldGrid& workerGrid);
+
+    // <base>.yield：float64 小端，先 Σy 再 Σy²，各 nx*ny*nz，C 顺序 (ix, iy, iz)
+    G4bool Write(const std::string& path) const;
+    void WriteHeader(const std::string& headerPath, G4int numEvents) const;
+
+    G4double GetYieldInGrid() const { return fYieldInGrid; }
+    G4double GetYieldOutsideGrid() const { return fYieldOutsideGrid; }
+    G4int GetNx() const { return fN[0]; }
+    G4int GetNy() const { return fN[1]; }
+    G4int GetNz() const { return fN[2]; }
+
+  private:
+    G4int VoxelIndex(const G4ThreeVector& p) const;  // -1 = 网格外
+
+    G4int fN[3];
+    G4double fMin[3], fMax[3];   // Geant4 长度单位
+    G4double fWidth[3];          // 实际体素宽度 (max-min)/n
+    G4double fNominalVoxelCm;    // 名义体素尺寸 dv [cm]
+    G4double fSubStep;           // 步内细分长度（最小体素宽度的一半）
+
+    std::vector<G4double> fSum;
+    std::vector<G4double> fSum2;
+    std::vector<G4double> fEvent;    // 当前事件暂存
+    std::vector<G4int> fTouched;     // 当前事件中非零的体素
+    G4double fYieldInGrid;
+    G4double fYieldOutsideGrid;
+
+#ifdef G4MULTITHREADED
+    static G4Mutex fMergeMutex;
+#endif
+};
+
+#endif
@@ -1,12 +1,19 @@
 #!/usr/bin/env python3
 """
-Read binary phase space file (v2, 60 bytes per photon) generated by Geant4 Cherenkov simulation.
+Read binary phase space file (v2, 60 bytes per photon; v3, 64 bytes with a
+trailing float32 weight; v4, compact 24-byte records with event frames)
+generated by Geant4 Cherenkov simulation.
 """
 
 import os
 import numpy as np
 import sys
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "analysis"))
+import chunked_output  # noqa: E402
+import columnar_output  # noqa: E402
+import compact_phsp  # noqa: E402
+
 BYTES_PER_PHOTON = 60
 
 # v2 compound dtype, explicit little-endian
@@ -20,6 +27,10 @@ PHSP_DTYPE = np.dtype([
     ("track_id", "<i4"),
 ])
 
+# v3 = v2 + float32 weight (variance_reduction.photon_yield_fraction < 1)
+BYTES_PER_WEIGHTED_PHOTON = 64
+PHSP_DTYPE_V3 = np.dtype(PHSP_DTYPE.descr + [("weight", "<f4")])
+
 
 def _path_header(phsp_file):
     """Same directory, same basename, .header."""
@@ -29,12 +40,12 @@ def _path_header(phsp_file):
 
 def _validate_header_if_present(phsp_file):
     """
-    If .header exists, validate format_version 2 and bytes_per_photon 60.
-    Raises ValueError if header exists and is not v2.
+    If .header exists, validate format_version 2/60 bytes, 3/64 bytes or 4/24 bytes (compact).
+    Raises ValueError if header exists and is neither. Returns the format version (2 without header).
     """
     header_path = _path_header(phsp_file)
     if not os.path.isfile(header_path):
-        return
+        return 2
     format_version = None
     bytes_per_photon = None
     with open(header_path, "r", encoding="utf-8") as f:
@@ -55,21 +66,25 @@ def _validate_header_if_present(phsp_file):
                         except ValueError:
                             pass
                     break
-    if format_version is not None and format_version != 2:
+    if format_version is not None and format_version not in (2, 3, 4):
         raise ValueError(
-            f"Header format_version={format_version} is not v2; "
-            f"only v2 (60 bytes per photon) is supported"
+            f"Header format_version={format_version} is not v2/v3/v4; "
+            f"only v2 (60 bytes), v3 (64 bytes) and v4 (24 bytes, compact) are supported"
         )
-    if bytes_per_photon is not None and bytes_per_photon != 60:
+    version = format_version or 2
+    expected = {2: BYTES_PER_PHOTON, 3: BYTES_PER_WEIGHTED_PHOTON, 4: compact_phsp.RECORD_BYTES}[version]
+    if bytes_per_photon is not None and bytes_per_photon != expected:
         raise ValueError(
-            f"Header bytes_per_photon={bytes_per_photon} is not 60; "
-            f"only v2 (60 bytes per photon) is supported"
+            f"Header bytes_per_photon={bytes_per_photon} does not match "
+            f"format_version={version} ({expected} bytes per photon)"
         )
+    return version
 
 
-def read_binary_phsp(phsp_file):
+def read_binary_phsp(phsp_file, fields=None, step=1):
     """
-    Read binary phase space file (v2, 60 bytes per photon).
+    Read binary phase space file (v2, 60 bytes per photon; v3 adds weight).
+    fields: record field names to return (default: all); step: keep every step-th photon.
 
     File format (15 fields, 60 bytes per photon, little-endian):
       initX, initY, initZ [cm]
@@ -79,26 +94,70 @@ def read_binary_phsp(phsp_file):
       finalEnergy [microeV]
       event_id (uint32, G4Event::GetEventID())
       track_id (int32, G4Track::GetTrackID(); -1 = unknown)
+      weight (float32, v3 only; 1/photon_yield_fraction)
+
+    Files written with output_compression = "zlib" (chunked container, see
+    analysis/chunked_output.py) are detected by their magic and decompressed.
+    Files written with photon_format = "compact" (format_version 4, see
+    analysis/compact_phsp.py) are decoded to v3 records (track_id = -1).
+    With output_layout = "columns" there is no record file, only <phsp_file>.<column>.npy
+    (see analysis/columnar_output.py): the columns holding `fields` are memory-mapped and only
+    the selected rows are copied.
 
     Validation:
-      - file_size % 60 != 0 -> ValueError
-      - If .header exists: format_version must be 2, bytes_per_photon must be 60
+      - file_size % record_size != 0 -> ValueError
+      - If .header exists: format_version 2 (60 bytes), 3 (64 bytes) or 4 (24 bytes)
 
     Returns:
-        Structured numpy array with PHSP_DTYPE (event_id, track_id included)
+        Structured numpy array with PHSP_DTYPE or PHSP_DTYPE_V3 (only `fields` if given)
     """
-    print(f"Reading binary file (v2, 60B): {phsp_file}")
+    version = _validate_header_if_present(phsp_file)
+    if columnar_output.is_columnar(phsp_file):
+        print(f"Reading columnar output (v{version}, .npy per field): {phsp_file}")
+        data = columnar_output.read_fields(phsp_file, fields, step=step)
+        print(f"Total photons: {columnar_output.n_records(phsp_file):,} (read {len(data):,})")
+        return data
+    data = _read_records(phsp_file, version)
+    if step > 1:
+        data = data[::step]
+    if fields is not None:
+        data = _select_fields(data, fields)
+    return data
+
+
+def _select_fields(data, fields):
+    """Copy of the given fields as a packed structured array."""
+    out = np.empty(len(data), dtype=[(f, data.dtype[f]) for f in fields])
+    for f in fields:
+        out[f] = data[f]
+    return out
+
+
+def _read_records(phsp_file, version):
+    """Whole record file (raw, chunked container or compact) as a structured array."""
+    if version == 4:
+        print(f"Reading binary file (v4 compact, {compact_phsp.RECORD_BYTES}B records): {phsp_file}")
+        data = compact_phsp.read_compact_phsp(phsp_file)
+        print(f"Total photons: {len(data):,} (decoded to v3 records)")
+        print(f"File size: {os.path.getsize(phsp_file) / (1024**3):.2f} GB")
+        return data
+    dtype = PHSP_DTYPE_V3 if version == 3 else PHSP_DTYPE
+    print(f"Reading binary file (v{version}, {dtype.itemsize}B): {phsp_file}")
+
+    if chunked_output.is_chunked(phsp_file):
+        data = chunked_output.read_chunked(phsp_file, dtype=dtype)
+        print(f"Total photons: {len(data):,} (chunked container)")
+        print(f"File size: {os.path.getsize(phsp_file) / (1024**3):.2f} GB")
+        return data
 
     file_size = os.path.getsize(phsp_file)
-    if file_size % BYTES_PER_PHOTON != 0:
+    if file_size % dtype.itemsize != 0:
         raise ValueError(
-            f"PHSP file size {file_size} is not divisible by {BYTES_PER_PHOTON}; "
-            f"expected v2 format (60 bytes per photon)"
+            f"PHSP file size {file_size} is not divisible by {dtype.itemsize}; "
+            f"expected v{version} format ({dtype.itemsize} bytes per photon)"
         )
 
-    _validate_header_if_present(phsp_file)
-
-    data = np.fromfile(phsp_file, dtype=PHSP_DTYPE)
+    data = np.fromfile(phsp_file, dtype=dtype)
     n_photons = len(data)
 
     print(f"Total photons: {n_photons:,}")
@@ -114,7 +173,7 @@ def extract_fields(data):
     Returns:
         Dictionary with field names as keys (including event_id, track_id)
     """
-    return {
+    fields = {
         "InitialX": data["initX"],
         "InitialY": data["initY"],
         "InitialZ": data["initZ"],
@@ -131,6 +190,9 @@ def extract_fields(data):
         "event_id": data["event_id"],
         "track_id": data["track_id"],
     }
+    if "weight" in data.dtype.names:
+        fields["Weight"] = data["weight"]
+    return fields
 
 
 def show_statistics(data):
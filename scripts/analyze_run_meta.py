@@ -5,6 +5,7 @@ Quick helper to inspect *.run_meta.json produced by RunAction.
 Usage:
   python3 scripts/analyze_run_meta.py                # auto-detect latest run_meta in output/
   python3 scripts/analyze_run_meta.py path/to/meta.json
+  python3 scripts/analyze_run_meta.py baseline.json candidate.json   # compare steps / time per event
 """
 
 import json
@@ -34,10 +35,70 @@ def format_seconds(s: int) -> str:
   return f"{h:02d} h {m:02d} m {sec:02d} s"
 
 
+def load_meta(meta_path: Path) -> dict | None:
+  if not meta_path.is_file():
+    print(f"Meta file not found: {meta_path}")
+    return None
+  with meta_path.open("r", encoding="utf-8") as f:
+    return json.load(f)
+
+
+def per_event(meta: dict, key: str) -> float | None:
+  events = int(meta.get("events", 0))
+  if events <= 0 or key not in meta:
+    return None
+  return float(meta[key]) / events
+
+
+def compare(path_a: Path, path_b: Path) -> int:
+  """Compare two runs (e.g. without / with cherenkov_threshold_kill), normalized per event."""
+  a, b = load_meta(path_a), load_meta(path_b)
+  if a is None or b is None:
+    return 1
+
+  print("=== Run Metadata Comparison ===")
+  print(f"A: {path_a}")
+  print(f"B: {path_b}")
+  print()
+  print(f"{'':<28} {'A':>16} {'B':>16} {'B/A':>8}")
+  rows = [
+    ("events", "events", False),
+    ("photons / event", "total_photons", True),
+    ("steps / event", "total_steps", True),
+    ("wall s / event", "wall_time_seconds", True),
+    ("cpu s / event", "cpu_time_seconds", True),
+    ("peak stacked tracks", "peak_stacked_tracks", False),
+  ]
+  for label, key, normalize in rows:
+    va = per_event(a, key) if normalize else a.get(key)
+    vb = per_event(b, key) if normalize else b.get(key)
+    if va is None or vb is None:
+      print(f"{label:<28} {'-':>16} {'-':>16}")
+      continue
+    ratio = f"{float(vb) / float(va):.3f}" if float(va) != 0 else "-"
+    print(f"{label:<28} {float(va):>16.6g} {float(vb):>16.6g} {ratio:>8}")
+
+  sa = a.get("startup", {}).get("total_seconds")
+  sb = b.get("startup", {}).get("total_seconds")
+  if sa is not None and sb is not None:
+    ratio = f"{sb / sa:.3f}" if sa else "-"
+    print(f"{'startup s':<28} {sa:>16.6g} {sb:>16.6g} {ratio:>8}")
+
+  print()
+  for key in ("cherenkov_threshold_kill", "phantom_production_cut_mm",
+              "threshold_killed_electrons", "threshold_killed_energy_MeV",
+              "scoring_envelope_margin_cm", "envelope_killed_charged", "envelope_killed_neutral",
+              "optical_stacking", "optical_batch_size", "peak_deferred_photons"):
+    print(f"{key:<28} {str(a.get(key, '-')):>16} {str(b.get(key, '-')):>16}")
+  return 0
+
+
 def main(argv: list[str]) -> int:
   script_dir = Path(__file__).resolve().parent
   project_root = script_dir.parent
 
+  if len(argv) >= 3:
+    return compare(Path(argv[1]), Path(argv[2]))
   if len(argv) >= 2:
     meta_path = Path(argv[1])
   else:
@@ -81,6 +142,31 @@ def main(argv: list[str]) -> int:
   print(f"Photons:     {photons}")
   if events > 0:
     print(f"Photons / event: {photons / events:.1f}")
+  if "total_steps" in meta:
+    steps = int(meta["total_steps"])
+    print(f"Steps:       {steps}")
+    if events > 0:
+      print(f"Steps / event:   {steps / events:.1f}")
+  if meta.get("cherenkov_threshold_kill"):
+    print(f"Sub-threshold e- killed: {meta.get('threshold_killed_electrons', 0)} "
+          f"({meta.get('threshold_killed_energy_MeV', 0)} MeV kinetic energy)")
+  if "scoring_envelope_margin_cm" in meta:
+    print(f"Killed leaving envelope ({meta['scoring_envelope_margin_cm']} cm): "
+          f"{meta.get('envelope_killed_charged', 0)} charged, {meta.get('envelope_killed_neutral', 0)} neutral")
+
+  if "peak_stacked_tracks" in meta:
+    line = f"Peak stacked tracks / thread: {meta['peak_stacked_tracks']} ({meta.get('optical_stacking', 'immediate')}"
+    if "peak_deferred_photons" in meta:
+      line += f", batch {meta.get('optical_batch_size')}, peak deferred photons {meta['peak_deferred_photons']}"
+    print(line + ")")
+
+  startup = meta.get("startup")
+  if startup:
+    print()
+    print(f"Startup:     {startup.get('total_seconds', 0):.1f} s "
+          f"(physics tables: {startup.get('physics_table_cache', 'disabled')})")
+    for phase, seconds in startup.get("phases_seconds", {}).items():
+      print(f"  {phase:<30} {seconds:8.2f} s")
 
   wall = int(meta.get("wall_time_seconds", 0))
   cpu = int(meta.get("cpu_time_seconds", 0))
@@ -0,0 +1,87 @@
+#!/bin/bash
+# Benchmark physics list choices (physics.physics_list / physics.em_option in config.json).
+#
+# For every variant a temporary config is derived from the base config (only the physics
+# section and output path change) and CherenkovSim runs the same number of events.
+# Reported per variant:
+#   total     - whole process wall time (startup + run + teardown)
+#   run       - wall_time_seconds from run_meta.json (BeginOfRun -> EndOfRun)
+#   startup   - total - run (geometry, physics table building, initialization)
+#   steps/evt - total_steps / events from run_meta.json
+#
+# Usage:
+#   bash scripts/benchmark_physics_lists.sh [events] [base_config]
+#   bash scripts/benchmark_physics_lists.sh 2000 config.json
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
+
+EVENTS="${1:-2000}"
+BASE_CONFIG="$(realpath "${2:-$PROJECT_ROOT/config.json}")"
+EXE="$PROJECT_ROOT/build/CherenkovSim"
+MACRO="$PROJECT_ROOT/macros/run_base.mac"
+BENCH_DIR="$PROJECT_ROOT/output/benchmark_physics_lists"
+
+# "physics_list:em_option"
+VARIANTS=("FTFP_BERT:4" "em_only:4" "em_only:3" "em_only:0")
+
+if [ ! -x "$EXE" ]; then
+  echo "CherenkovSim not found at $EXE; run scripts/build.sh first"
+  exit 1
+fi
+
+if [ -f /home/xhh2c/Applications/GEANT4/geant4-install/bin/geant4.sh ]; then
+  # shellcheck source=/dev/null
+  source /home/xhh2c/Applications/GEANT4/geant4-install/bin/geant4.sh
+fi
+
+mkdir -p "$BENCH_DIR"
+cd "$PROJECT_ROOT/build" || exit 1
+
+RESULTS="$BENCH_DIR/results.txt"
+printf "%-10s %3s %10s %10s %10s %12s\n" "list" "em" "total[s]" "run[s]" "startup[s]" "steps/evt" | tee "$RESULTS"
+
+for variant in "${VARIANTS[@]}"; do
+  LIST="${variant%%:*}"
+  EM="${variant##*:}"
+  TAG="${LIST}_em${EM}"
+  CFG="$BENCH_DIR/config_${TAG}.json"
+  OUT_BASE="$BENCH_DIR/${TAG}"
+
+  python3 - "$BASE_CONFIG" "$CFG" "$LIST" "$EM" "$OUT_BASE" <<'PY'
+import json, sys
+base, out, plist, em, out_base = sys.argv[1:6]
+with open(base) as f:
+    cfg = json.load(f)
+cfg.setdefault("physics", {})
+cfg["physics"]["physics_list"] = plist
+cfg["physics"]["em_option"] = int(em)
+cfg["simulation"]["output_file_path"] = out_base
+with open(out, "w") as f:
+    json.dump(cfg, f, indent=2)
+PY
+
+  START=$(date +%s.%N)
+  "$EXE" --config "$CFG" --mode custom --events "$EVENTS" --macro "$MACRO" > "$BENCH_DIR/${TAG}.log" 2>&1
+  END=$(date +%s.%N)
+
+  python3 - "$OUT_BASE.run_meta.json" "$LIST" "$EM" "$START" "$END" <<'PY' | tee -a "$RESULTS"
+import json, sys
+meta_path, plist, em, start, end = sys.argv[1:6]
+total = float(end) - float(start)
+try:
+    with open(meta_path) as f:
+        meta = json.load(f)
+except OSError:
+    print(f"{plist:<10} {em:>3} {total:>10.1f}  (no run_meta, see log)")
+    sys.exit(0)
+run = float(meta.get("wall_time_seconds", 0))
+events = int(meta.get("events", 0))
+steps = float(meta.get("total_steps", 0)) / events if events else 0.0
+print(f"{plist:<10} {em:>3} {total:>10.1f} {run:>10.1f} {total - run:>10.1f} {steps:>12.1f}")
+PY
+done
+
+echo ""
+echo "Results: $RESULTS  (logs and run_meta in $BENCH_DIR)"
+echo "Pairwise comparison: python3 scripts/analyze_run_meta.py <a>.run_meta.json <b>.run_meta.json"
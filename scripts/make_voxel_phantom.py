@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""
+Convert a CT volume (.npy, HU or density) into the raw material-index file read by the voxel phantom
+(config.json "voxel_phantom" section).
+
+The input array is indexed [z, y, x] (numpy / DICOM slice order); the raw file is written with x fastest,
+then y, then z, i.e. exactly array.astype(dtype).tofile(). Each voxel gets the index of the first
+threshold it is below; the last material takes everything above the last threshold.
+
+Usage:
+  python3 scripts/make_voxel_phantom.py ct_hu.npy phantom.raw --thresholds -950 -200 300
+      # 0: < -950 HU, 1: [-950, -200), 2: [-200, 300), 3: >= 300
+  python3 scripts/make_voxel_phantom.py ct_hu.npy phantom.raw --thresholds -950 -200 300 \\
+      --materials Air Lung Water Bone
+      # also prints a voxel_phantom snippet for config.json (material entries must be completed by hand)
+"""
+
+import argparse
+import json
+import sys
+
+import numpy as np
+
+
+def classify(volume: np.ndarray, thresholds: list[float]) -> np.ndarray:
+  """Material index per voxel: number of thresholds <= value."""
+  if any(b <= a for a, b in zip(thresholds, thresholds[1:])):
+    raise ValueError("thresholds must be strictly increasing")
+  return np.searchsorted(np.asarray(thresholds, dtype=float), volume, side="right")
+
+
+def main() -> int:
+  parser = argparse.ArgumentParser(description="CT volume (.npy) -> voxel phantom raw material indices")
+  parser.add_argument("input", help=".npy volume indexed [z, y, x]")
+  parser.add_argument("output", help="raw file for voxel_phantom.raw_file")
+  parser.add_argument("--thresholds", type=float, nargs="+", required=True,
+                      help="increasing bin edges (same unit as the input)")
+  parser.add_argument("--materials", nargs="*", default=None,
+                      help="material names, one per bin (len(thresholds) + 1)")
+  args = parser.parse_args()
+
+  volume = np.load(args.input)
+  if volume.ndim != 3:
+    print(f"Expected a 3D volume, got shape {volume.shape}")
+    return 1
+  indices = classify(volume, args.thresholds)
+  n_materials = len(args.thresholds) + 1
+  dtype = "uint8" if n_materials <= 256 else "uint16"
+  indices.astype("<u1" if dtype == "uint8" else "<u2").tofile(args.output)
+
+  nz, ny, nx = volume.shape
+  counts = np.bincount(indices.ravel(), minlength=n_materials)
+  print(f"Wrote {args.output}: dims [nx, ny, nz] = [{nx}, {ny}, {nz}], dtype {dtype}")
+  for i, c in enumerate(counts):
+    name = args.materials[i] if args.materials and i < len(args.materials) else f"material {i}"
+    print(f"  [{i}] {name}: {c} voxels ({100.0 * c / indices.size:.1f} %)")
+
+  if args.materials:
+    if len(args.materials) != n_materials:
+      print(f"--materials needs {n_materials} names")
+      return 1
+    snippet = {
+      "enabled": True,
+      "raw_file": args.output,
+      "dims": [nx, ny, nz],
+      "dtype": dtype,
+      "materials": [{"name": name, "base": "water", "optical": "water"} for name in args.materials],
+    }
+    print("\nvoxel_phantom (set base / density_g_cm3 / optical per material):")
+    print(json.dumps(snippet, indent=2))
+  return 0
+
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -7,6 +7,7 @@
 #include "RunAction.hh"
 #include "EventAction.hh"
 #include "SteppingAction.hh"
+#include "StackingAction.hh"
 #include "Config.hh"
 
 ActionInitialization::ActionInitialization()
@@ -20,9 +21,22 @@ void ActionInitialization::BuildForMaster() const
 {
   RunAction* runAction = new RunAction;
   SetUserAction(runAction);
+
+  // optical_subevent_size > 0（G4SubEvtRunManager）：master 自己跑事件循环（初级粒子与带电簇射），
+  // worker 只输运光子 sub-event；sub-event 完成后在 master 上调用 EventAction::MergeSubEvent
+  if (Config::GetInstance()->GetOpticalSubEventSize() > 0) {
+    BuildEventActions(runAction);
+  }
 }
 
 void ActionInitialization::Build() const
+{
+  RunAction* runAction = new RunAction;
+  SetUserAction(runAction);
+  BuildEventActions(runAction);
+}
+
+void ActionInitialization::BuildEventActions(RunAction* runAction) const
 {
   // Get PHSP file path from config
   Config* config = Config::GetInstance();
@@ -30,11 +44,10 @@ void ActionInitialization::Build() const
   
   SetUserAction(new PHSPPrimaryGeneratorAction(phspFilePath));
 
-  RunAction* runAction = new RunAction;
-  SetUserAction(runAction);
-  
   EventAction* eventAction = new EventAction(runAction);
   SetUserAction(eventAction);
   
   SetUserAction(new SteppingAction(eventAction));
+
+  SetUserAction(new StackingAction(eventAction));
 }  
@@ -0,0 +1,150 @@
+//
+// AnalyticOpticalTransport.cc
+//
+
+#include "AnalyticOpticalTransport.hh"
+#include "Config.hh"
+
+#include "G4PhysicalVolumeStore.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "Randomize.hh"
+
+#include <cfloat>
+
+namespace {
+  // Same tolerance G4OpBoundaryProcess uses to treat incidence as normal
+  constexpr G4double kNormalIncidenceTolerance = 1.0e-9;
+}
+
+AnalyticOpticalTransport::AnalyticOpticalTransport()
+: fGeometry(),
+  fInitialized(false),
+  fPhantomRindex(nullptr),
+  fPhantomAbsLength(nullptr),
+  fOutsideRindex(nullptr),
+  fAbsorptionWeighting(Config::GetInstance()->GetOpticalAbsorptionWeighting())
+{}
+
+G4bool AnalyticOpticalTransport::Initialize()
+{
+  if (fInitialized) return fPhantomRindex != nullptr;
+  fInitialized = true;
+
+  Config* config = Config::GetInstance();
+  if (config->GetVoxelPhantomEnabled()) {
+    // 直线输运假设模体为单一材料，体素模体中各材料的 RINDEX/ABSLENGTH 不同
+    G4cerr << "WARNING: analytic optical transport does not support the voxel phantom, photons will be tracked" << G4endl;
+    return false;
+  }
+  G4VPhysicalVolume* phantom =
+    G4PhysicalVolumeStore::GetInstance()->GetVolume(config->GetPhantomVolumeName(), false);
+  if (phantom == nullptr) {
+    G4cerr << "WARNING: analytic optical transport: phantom volume '"
+           << config->GetPhantomVolumeName() << "' not found, photons will be tracked" << G4endl;
+    return false;
+  }
+
+  G4MaterialPropertiesTable* phantomMPT = phantom->GetLogicalVolume()->GetMaterial()->GetMaterialPropertiesTable();
+  if (phantomMPT != nullptr) {
+    fPhantomRindex = phantomMPT->GetProperty("RINDEX");
+    fPhantomAbsLength = phantomMPT->GetProperty("ABSLENGTH");
+  }
+  if (phantom->GetMotherLogical() != nullptr) {
+    G4MaterialPropertiesTable* outsideMPT = phantom->GetMotherLogical()->GetMaterial()->GetMaterialPropertiesTable();
+    if (outsideMPT != nullptr) {
+      fOutsideRindex = outsideMPT->GetProperty("RINDEX");
+    }
+  }
+  if (fPhantomRindex == nullptr) {
+    G4cerr << "WARNING: analytic optical transport: phantom material has no RINDEX, photons will be tracked" << G4endl;
+  }
+  return fPhantomRindex != nullptr;
+}
+
+G4bool AnalyticOpticalTransport::Transport(const G4ThreeVector& position, const G4ThreeVector& direction,
+                                           const G4ThreeVector& polarization, G4double energy,
+                                           AnalyticPhotonEnd& end)
+{
+  if (!Initialize()) return false;
+
+  G4ThreeVector outwardNormal;
+  G4double exitDistance = fGeometry.DistanceToExit(position, direction, &outwardNormal);
+  if (exitDistance < 0.0) return false;
+
+  // G4OpAbsorption: mean free path = ABSLENGTH(E), no table -> never absorbed
+  G4double absorptionDistance = DBL_MAX;
+  end.survival = 1.0;
+  if (fPhantomAbsLength != nullptr) {
+    if (fAbsorptionWeighting) {
+      end.survival = std::exp(-exitDistance / fPhantomAbsLength->Value(energy));
+    } else {
+      absorptionDistance = -std::log(G4UniformRand()) * fPhantomAbsLength->Value(energy);
+    }
+  }
+
+  end.energy = energy;
+  if (absorptionDistance < exitDistance) {
+    end.position = position + absorptionDistance * direction;
+    end.direction = direction;
+    end.absorbed = true;
+    return true;
+  }
+
+  end.position = position + exitDistance * direction;
+  end.absorbed = false;
+  if (fOutsideRindex == nullptr) {
+    // 母体无 RINDEX：G4OpBoundaryProcess 在界面吸收光子（NoRINDEX），方向不变
+    end.direction = direction;
+  } else {
+    end.direction = SampleBoundaryDirection(direction, polarization, outwardNormal,
+                                            fPhantomRindex->Value(energy), fOutsideRindex->Value(energy));
+  }
+  return true;
+}
+
+G4ThreeVector AnalyticOpticalTransport::SampleBoundaryDirection(const G4ThreeVector& direction,
+                                                                const G4ThreeVector& polarization,
+                                                                const G4ThreeVector& outwardNormal,
+                                                                G4double rindex1, G4double rindex2) const
+{
+  // Geant4 convention: the facet normal points back into the incident medium
+  G4ThreeVector facetNormal = -outwardNormal;
+  G4double cost1 = -direction.dot(facetNormal);
+  G4double sint1 = 0.0;
+  G4double sint2 = 0.0;
+  if (std::abs(cost1) < 1.0 - kNormalIncidenceTolerance) {
+    sint1 = std::sqrt(1.0 - cost1 * cost1);
+    sint2 = sint1 * rindex1 / rindex2;
+  }
+
+  G4ThreeVector reflected = direction - (2.0 * direction.dot(facetNormal)) * facetNormal;
+  if (sint2 >= 1.0) {
+    return reflected;  // total internal reflection
+  }
+
+  G4double cost2 = (cost1 > 0.0) ? std::sqrt(1.0 - sint2 * sint2) : -std::sqrt(1.0 - sint2 * sint2);
+  G4double E1_perp = 0.0;
+  G4double E1_parl = 1.0;
+  if (sint1 > 0.0) {
+    G4ThreeVector A_trans = direction.cross(facetNormal).unit();
+    E1_perp = polarization.dot(A_trans);
+    G4ThreeVector E1pl = polarization - E1_perp * A_trans;
+    E1_parl = E1pl.mag();
+  }
+
+  G4double s1 = rindex1 * cost1;
+  G4double E2_perp = 2.0 * s1 * E1_perp / (rindex1 * cost1 + rindex2 * cost2);
+  G4double E2_parl = 2.0 * s1 * E1_parl / (rindex2 * cost1 + rindex1 * cost2);
+  G4double E2_total = E2_perp * E2_perp + E2_parl * E2_parl;
+  G4double s2 = rindex2 * cost2 * E2_total;
+  G4double transCoeff = (cost1 != 0.0) ? s2 / s1 : 0.0;
+
+  if (G4UniformRand() >= transCoeff) {
+    return reflected;  // Fresnel reflection
+  }
+  G4double alpha = cost1 - cost2 * (rindex2 / rindex1);
+  return (direction + alpha * facetNormal).unit();
+}
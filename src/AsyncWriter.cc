@@ -0,0 +1,411 @@
+//
+// AsyncWriter.cc
+//
+
+#include "AsyncWriter.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+  // O_DIRECT 要求地址、长度、偏移按逻辑块对齐；大块写减少系统调用
+  constexpr size_t kDirectAlignment = 4096;
+  constexpr size_t kDirectBlockBytes = 8u << 20;
+
+  // 在 offset 处写完 bytes 字节（处理部分写与 EINTR）
+  G4bool PwriteAll(int fd, const char* data, size_t bytes, long long offset)
+  {
+    while (bytes > 0) {
+      ssize_t written = ::pwrite(fd, data, bytes, static_cast<off_t>(offset));
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        G4cerr << "ERROR: pwrite failed: " << std::strerror(errno) << G4endl;
+        return false;
+      }
+      // 没有进展（如设备已满却未报 errno）：按失败处理，否则会一直重试
+      if (written == 0) {
+        G4cerr << "ERROR: pwrite wrote 0 of " << bytes << " bytes" << G4endl;
+        return false;
+      }
+      data += written;
+      offset += written;
+      bytes -= static_cast<size_t>(written);
+    }
+    return true;
+  }
+
+  // writer_fsync = every_buffer：每个缓冲后的 fdatasync，失败时告警
+  G4bool SyncData(int fd)
+  {
+    while (::fdatasync(fd) != 0) {
+      if (errno == EINTR) continue;
+      G4cerr << "WARNING: fdatasync failed: " << std::strerror(errno) << G4endl;
+      return false;
+    }
+    return true;
+  }
+}
+
+AsyncWriter* AsyncWriter::Instance()
+{
+  static AsyncWriter instance;
+  return &instance;
+}
+
+AsyncWriter::~AsyncWriter()
+{
+  Flush();
+  CloseFiles();
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fWork.notify_all();
+  if (fThread.joinable()) fThread.join();
+}
+
+void AsyncWriter::Enqueue(Job&& job)
+{
+  if (fParallelAppend) {
+    auto it = fFiles.find(job.path);
+    if (it != fFiles.end()) {
+      if (!it->second->columns.empty()) {
+        WriteColumns(*it->second, job.data, job.count, job.stride);
+        Release(job);
+        return;
+      }
+      size_t bytes = Pack(job);
+      if (it->second->chunked) {
+        WriteChunks(*it->second, job.data, bytes);
+      } else {
+        WriteAt(*it->second, job.data, bytes);
+      }
+      Release(job);
+      return;
+    }
+  }
+  if (fDepth == 0) {
+    std::lock_guard<std::mutex> lock(fSyncMutex);
+    WriteJob(job);
+    Release(job);
+    return;
+  }
+  std::unique_lock<std::mutex> lock(fMutex);
+  if (!fThread.joinable()) {
+    fThread = std::thread(&AsyncWriter::Run, this);
+  }
+  if (fInFlight >= static_cast<size_t>(fDepth)) {
+    ++fBackpressureWaits;
+    fSpace.wait(lock, [this] { return fInFlight < static_cast<size_t>(fDepth); });
+  }
+  fQueue.push_back(std::move(job));
+  ++fInFlight;
+  lock.unlock();
+  fWork.notify_one();
+}
+
+void AsyncWriter::Flush()
+{
+  std::unique_lock<std::mutex> lock(fMutex);
+  fSpace.wait(lock, [this] { return fInFlight == 0; });
+}
+
+void AsyncWriter::OpenFile(const std::string& path, const ChunkedOutput::Layout* layout)
+{
+  if (fFiles.count(path)) return;
+  auto file = std::make_unique<OutputFile>();
+  const G4bool wantChunked = fChunked && layout != nullptr;
+  if (wantChunked && !ChunkedOutput::Available()) {
+    G4cerr << "WARNING: output_compression requires zlib (not found at build time); writing raw " << path << G4endl;
+  }
+  file->chunked = wantChunked && ChunkedOutput::Available();
+  // O_DIRECT 只用于 queue 模式的裸记录流：pwrite 模式下各线程预留的偏移不对齐，压缩 chunk 长度不定
+  const G4bool wantDirect = fDirectIO && !fParallelAppend && !file->chunked;
+#ifdef O_DIRECT
+  if (wantDirect) {
+    file->fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_DIRECT, 0644);
+    if (file->fd < 0) {
+      G4cerr << "WARNING: O_DIRECT not available for " << path << " (" << std::strerror(errno)
+             << "), using buffered writes" << G4endl;
+    }
+  }
+#else
+  if (wantDirect) {
+    G4cerr << "WARNING: O_DIRECT not supported on this platform, using buffered writes" << G4endl;
+  }
+#endif
+  if (file->fd >= 0) {
+    file->direct = true;
+  } else {
+    file->fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+  }
+  if (file->fd < 0) {
+    G4cerr << "ERROR: Cannot open output file: " << path << " (" << std::strerror(errno)
+           << "), falling back to per-buffer appends" << G4endl;
+    return;
+  }
+  file->offset = static_cast<long long>(::lseek(file->fd, 0, SEEK_END));
+  if (file->direct) {
+    void* staging = nullptr;
+    if (file->offset % kDirectAlignment != 0 ||
+        ::posix_memalign(&staging, kDirectAlignment, kDirectBlockBytes) != 0) {
+      // 已有未对齐的内容（或内存不足）：退回普通写
+      ::close(file->fd);
+      file->fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+      file->direct = false;
+    } else {
+      file->staging = static_cast<char*>(staging);
+    }
+  }
+  if (file->chunked) {
+    file->layout = *layout;
+    const ChunkedOutput::FileHeader header = ChunkedOutput::MakeFileHeader();
+    WriteAt(*file, reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  fFiles[path] = std::move(file);
+}
+
+void AsyncWriter::OpenColumns(const std::string& path, const std::vector<ColumnarOutput::Column>& columns)
+{
+  if (fFiles.count(path) || columns.empty()) return;
+  auto file = std::make_unique<OutputFile>();
+  file->columns = columns;
+  for (const auto& column : columns) {
+    const std::string columnPath = ColumnarOutput::ColumnPath(path, column);
+    const int fd = ::open(columnPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      G4cerr << "ERROR: Cannot open column file: " << columnPath << " (" << std::strerror(errno)
+             << "), writing records to " << path << G4endl;
+      for (int opened : file->columnFds) ::close(opened);
+      return;
+    }
+    file->columnFds.push_back(fd);
+    // 0 行的占位头：run 中途中断时文件仍可读
+    const std::string header = ColumnarOutput::MakeHeader(column, 0);
+    if (!PwriteAll(fd, header.data(), header.size(), 0)) ++fWriteFailures;
+  }
+  // 记录文件不写：删掉截断留下的空文件，免得读取端当成 0 条记录
+  ::unlink(path.c_str());
+  fFiles[path] = std::move(file);
+}
+
+G4bool AsyncWriter::IsChunked(const std::string& path) const
+{
+  auto it = fFiles.find(path);
+  return it != fFiles.end() && it->second->chunked;
+}
+
+G4bool AsyncWriter::IsColumnar(const std::string& path) const
+{
+  auto it = fFiles.find(path);
+  return it != fFiles.end() && !it->second->columns.empty();
+}
+
+std::vector<ColumnarOutput::Column> AsyncWriter::GetColumns(const std::string& path) const
+{
+  auto it = fFiles.find(path);
+  return it != fFiles.end() ? it->second->columns : std::vector<ColumnarOutput::Column>();
+}
+
+void AsyncWriter::CloseFiles()
+{
+  for (auto& entry : fFiles) {
+    OutputFile& file = *entry.second;
+    if (!file.columns.empty()) {
+      CloseColumns(entry.first, file);
+      continue;
+    }
+    if (file.direct && file.staged > 0) {
+      // 最后不足一个对齐块的尾部：关掉 O_DIRECT 后按普通写补上
+#ifdef O_DIRECT
+      ::fcntl(file.fd, F_SETFL, ::fcntl(file.fd, F_GETFL) & ~O_DIRECT);
+#endif
+      file.direct = false;
+      WriteAt(file, file.staging, file.staged);
+      file.staged = 0;
+    }
+    if (file.chunked) WriteIndex(file);
+    if (fFsync != kFsyncNone && ::fsync(file.fd) != 0) {
+      G4cerr << "WARNING: fsync failed for " << entry.first << ": " << std::strerror(errno) << G4endl;
+    }
+    ::close(file.fd);
+    std::free(file.staging);
+  }
+  fFiles.clear();
+}
+
+size_t AsyncWriter::Pack(Job& job)
+{
+  // 只写记录结构的前 recordBytes 字节时：在自己持有的缓冲里原地压紧
+  if (job.recordBytes != job.stride) {
+    for (size_t i = 1; i < job.count; ++i) {
+      std::memmove(job.data + i * job.recordBytes, job.data + i * job.stride, job.recordBytes);
+    }
+  }
+  return job.count * job.recordBytes;
+}
+
+void AsyncWriter::Release(Job& job)
+{
+  job.owner.reset();
+  MemoryBudget::Add(MemoryBudget::kWriterQueue, -job.ownedBytes);
+  job.ownedBytes = 0;
+}
+
+long long AsyncWriter::WriteAt(OutputFile& file, const char* data, size_t bytes)
+{
+  const long long start = file.offset.fetch_add(static_cast<long long>(bytes));
+  if (!PwriteAll(file.fd, data, bytes, start)) {
+    ++fWriteFailures;
+    return start;
+  }
+  if (fFsync == kFsyncEveryBuffer && !SyncData(file.fd)) ++fWriteFailures;
+  return start;
+}
+
+void AsyncWriter::WriteChunks(OutputFile& file, const char* data, size_t bytes)
+{
+  const size_t recordBytes = file.layout.recordBytes;
+  const size_t records = bytes / recordBytes;
+  thread_local std::vector<char> compressed;
+  for (size_t first = 0; first < records; first += fChunkRecords) {
+    const size_t count = std::min(fChunkRecords, records - first);
+    const char* chunk = data + first * recordBytes;
+    ChunkedOutput::ChunkIndexEntry entry;
+    if (ChunkedOutput::CompressChunk(chunk, count, file.layout, compressed, entry)) {
+      entry.offset = static_cast<uint64_t>(WriteAt(file, compressed.data(), compressed.size()));
+    } else {
+      // 压缩失败不丢数据：按裸记录写出，索引项标 kChunkCodecNone
+      ChunkedOutput::StoreChunk(chunk, count, file.layout, entry);
+      entry.offset = static_cast<uint64_t>(WriteAt(file, chunk, count * recordBytes));
+      ++fUncompressedChunks;
+    }
+    std::lock_guard<std::mutex> lock(file.indexMutex);
+    file.index.push_back(entry);
+  }
+}
+
+void AsyncWriter::WriteIndex(OutputFile& file)
+{
+  // pwrite 模式下 chunk 的完成顺序不一定是偏移顺序：按偏移排好再写
+  std::sort(file.index.begin(), file.index.end(),
+            [](const ChunkedOutput::ChunkIndexEntry& a, const ChunkedOutput::ChunkIndexEntry& b) {
+              return a.offset < b.offset;
+            });
+  uint64_t totalRecords = 0;
+  for (const auto& entry : file.index) totalRecords += entry.records;
+  long long indexOffset = file.offset.load();
+  if (!file.index.empty()) {
+    indexOffset = WriteAt(file, reinterpret_cast<const char*>(file.index.data()),
+                          file.index.size() * sizeof(ChunkedOutput::ChunkIndexEntry));
+  }
+  const ChunkedOutput::Trailer trailer = ChunkedOutput::MakeTrailer(
+    static_cast<uint64_t>(indexOffset), totalRecords, static_cast<uint32_t>(file.index.size()),
+    static_cast<uint32_t>(file.layout.recordBytes));
+  WriteAt(file, reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+  file.index.clear();
+}
+
+void AsyncWriter::WriteColumns(OutputFile& file, const char* data, size_t count, size_t stride)
+{
+  // 整个缓冲一次预留行号：各列写到相同的行区间，与其它线程的缓冲不交叠
+  const unsigned long long first = file.rows.fetch_add(count);
+  thread_local std::vector<char> column;
+  for (size_t k = 0; k < file.columns.size(); ++k) {
+    const ColumnarOutput::Column& spec = file.columns[k];
+    const size_t rowBytes = spec.itemBytes * static_cast<size_t>(spec.width);
+    column.resize(count * rowBytes);
+    ColumnarOutput::Gather(data, count, stride, spec, column.data());
+    if (!PwriteAll(file.columnFds[k], column.data(), column.size(),
+                   static_cast<long long>(ColumnarOutput::kHeaderBytes + first * rowBytes))) {
+      ++fWriteFailures;
+    }
+    if (fFsync == kFsyncEveryBuffer && !SyncData(file.columnFds[k])) ++fWriteFailures;
+  }
+}
+
+void AsyncWriter::CloseColumns(const std::string& path, OutputFile& file)
+{
+  const unsigned long long rows = file.rows.load();
+  for (size_t k = 0; k < file.columns.size(); ++k) {
+    const int fd = file.columnFds[k];
+    const std::string header = ColumnarOutput::MakeHeader(file.columns[k], rows);
+    if (!PwriteAll(fd, header.data(), header.size(), 0)) ++fWriteFailures;
+    if (fFsync != kFsyncNone && ::fsync(fd) != 0) {
+      G4cerr << "WARNING: fsync failed for " << ColumnarOutput::ColumnPath(path, file.columns[k]) << ": "
+             << std::strerror(errno) << G4endl;
+    }
+    ::close(fd);
+  }
+}
+
+void AsyncWriter::StageDirect(OutputFile& file, const char* data, size_t bytes)
+{
+  while (bytes > 0) {
+    size_t n = std::min(bytes, kDirectBlockBytes - file.staged);
+    std::memcpy(file.staging + file.staged, data, n);
+    file.staged += n;
+    data += n;
+    bytes -= n;
+    if (file.staged == kDirectBlockBytes) {
+      WriteAt(file, file.staging, kDirectBlockBytes);
+      file.staged = 0;
+    }
+  }
+}
+
+void AsyncWriter::WriteJob(Job& job)
+{
+  auto it = fFiles.find(job.path);
+  if (it != fFiles.end() && !it->second->columns.empty()) {
+    // 列直接按 stride 从缓冲中取，不需要先压紧
+    WriteColumns(*it->second, job.data, job.count, job.stride);
+    return;
+  }
+  const size_t bytes = Pack(job);
+  if (it != fFiles.end()) {
+    OutputFile& file = *it->second;
+    if (file.chunked) {
+      WriteChunks(file, job.data, bytes);
+    } else if (file.direct) {
+      StageDirect(file, job.data, bytes);
+    } else {
+      WriteAt(file, job.data, bytes);
+    }
+    return;
+  }
+  std::ofstream outFile(job.path, std::ios::app | std::ios::binary);
+  if (!outFile.good()) {
+    G4cerr << "ERROR: Cannot open output file for writing: " << job.path
+           << " (" << std::strerror(errno) << ")" << G4endl;
+    ++fWriteFailures;
+    return;
+  }
+  outFile.write(job.data, static_cast<std::streamsize>(bytes));
+  if (!outFile.good()) {
+    G4cerr << "ERROR: Write failed for " << job.path << G4endl;
+    ++fWriteFailures;
+  }
+}
+
+void AsyncWriter::Run()
+{
+  std::unique_lock<std::mutex> lock(fMutex);
+  while (true) {
+    fWork.wait(lock, [this] { return fStop || !fQueue.empty(); });
+    if (fQueue.empty()) return;  // fStop 且已写完
+    Job job = std::move(fQueue.front());
+    fQueue.pop_front();
+    lock.unlock();
+    WriteJob(job);
+    Release(job);
+    lock.lock();
+    --fInFlight;
+    fSpace.notify_all();
+  }
+}
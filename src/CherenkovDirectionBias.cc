@@ -0,0 +1,105 @@
+//
+// CherenkovDirectionBias.cc
+//
+
+#include "CherenkovDirectionBias.hh"
+#include "Config.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <cmath>
+
+CherenkovDirectionBias::CherenkovDirectionBias()
+: fGeometry(),
+  fFaceTarget(true),
+  fFaceNormal(0.0, 0.0, 1.0),
+  fConeAxis(0.0, 0.0, 1.0),
+  fConeCosHalfAngle(1.0),
+  fBins(36),
+  fDefensiveFraction(0.1)
+{
+  Config* config = Config::GetInstance();
+  fFaceTarget = (config->GetDirectionBiasTarget() == "face");
+
+  const std::string face = config->GetDirectionBiasFace();  // "+z", "-x", ...
+  const int axis = (face.size() == 2) ? face[1] - 'x' : 2;
+  fFaceNormal = G4ThreeVector();
+  fFaceNormal[(axis >= 0 && axis < 3) ? axis : 2] = (face[0] == '-') ? -1.0 : 1.0;
+
+  std::vector<double> coneAxis = config->GetDirectionBiasAxis();
+  if (coneAxis.size() == 3) {
+    fConeAxis = G4ThreeVector(coneAxis[0], coneAxis[1], coneAxis[2]).unit();
+  }
+  fConeCosHalfAngle = std::cos(config->GetDirectionBiasHalfAngle() * deg);
+  fBins = std::max(2, config->GetDirectionBiasAzimuthBins());
+  fDefensiveFraction = std::min(1.0, std::max(0.0, config->GetDirectionBiasDefensiveFraction()));
+  fReachable.resize(fBins);
+}
+
+G4bool CherenkovDirectionBias::Reaches(const G4ThreeVector& position, const G4ThreeVector& direction,
+                                       G4double rindex) const
+{
+  if (!fFaceTarget) {
+    return direction.dot(fConeAxis) >= fConeCosHalfAngle;
+  }
+  G4ThreeVector normal;
+  if (fGeometry.DistanceToExit(position, direction, &normal) < 0.0 || !(normal == fFaceNormal)) {
+    return false;
+  }
+  if (rindex > 1.0) {
+    // 全反射：sin(入射角) > 1/n
+    G4double cosIncidence = direction.dot(fFaceNormal);
+    if (1.0 - cosIncidence * cosIncidence > 1.0 / (rindex * rindex)) return false;
+  }
+  return true;
+}
+
+G4double CherenkovDirectionBias::Resample(const G4ThreeVector& position, const G4ThreeVector& axis,
+                                          G4double rindex, G4ThreeVector& direction,
+                                          G4ThreeVector& polarization)
+{
+  if (fFaceTarget && !fGeometry.Contains(position)) return 1.0;
+
+  G4double cosTheta = direction.dot(axis);
+  G4double sinTheta2 = 1.0 - cosTheta * cosTheta;
+  if (sinTheta2 <= 0.0) return 1.0;
+  G4double sinTheta = std::sqrt(sinTheta2);
+
+  // 以 axis 为极轴的正交基；当前方位角 phi0 = atan2(d·e2, d·e1)
+  G4ThreeVector e1 = axis.orthogonal().unit();
+  G4ThreeVector e2 = axis.cross(e1);
+  const G4double binWidth = twopi / fBins;
+
+  G4int nReachable = 0;
+  for (G4int b = 0; b < fBins; ++b) {
+    G4double phi = (b + 0.5) * binWidth;
+    G4ThreeVector d = cosTheta * axis + sinTheta * (std::cos(phi) * e1 + std::sin(phi) * e2);
+    fReachable[b] = Reaches(position, d, rindex);
+    if (fReachable[b]) ++nReachable;
+  }
+  if (nReachable == 0 || nReachable == fBins) return 1.0;
+
+  // q(bin) = ε/N + (1-ε)/nReachable（可达 bin），bin 内均匀
+  const G4double pOther = fDefensiveFraction / fBins;
+  const G4double pReachable = pOther + (1.0 - fDefensiveFraction) / nReachable;
+  G4double u = G4UniformRand();
+  G4int bin = -1;
+  G4int lastReachable = 0;
+  for (G4int b = 0; b < fBins; ++b) {
+    if (fReachable[b]) lastReachable = b;
+    u -= fReachable[b] ? pReachable : pOther;
+    if (u < 0.0) {
+      bin = b;
+      break;
+    }
+  }
+  if (bin < 0) bin = lastReachable;  // 累积概率的舍入误差
+  G4double pBin = fReachable[bin] ? pReachable : pOther;
+
+  G4double phi = (bin + G4UniformRand()) * binWidth;
+  G4double phi0 = std::atan2(direction.dot(e2), direction.dot(e1));
+  direction.rotate(phi - phi0, axis);
+  polarization.rotate(phi - phi0, axis);
+  return 1.0 / (fBins * pBin);
+}
@@ -0,0 +1,92 @@
+//
+// CherenkovYieldTable.cc
+//
+
+#include "CherenkovYieldTable.hh"
+
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+
+CherenkovYieldTable::CherenkovYieldTable()
+{}
+
+const CherenkovYieldTable::Entry& CherenkovYieldTable::GetEntry(const G4Material* material)
+{
+  size_t index = material->GetIndex();
+  if (index >= fEntries.size()) {
+    fEntries.resize(G4Material::GetNumberOfMaterials() > index + 1 ? G4Material::GetNumberOfMaterials() : index + 1);
+  }
+  Entry& entry = fEntries[index];
+  if (entry.built) return entry;
+  entry.built = true;
+
+  G4MaterialPropertiesTable* mpt = material->GetMaterialPropertiesTable();
+  G4MaterialPropertyVector* rindex = (mpt != nullptr) ? mpt->GetProperty("RINDEX") : nullptr;
+  if (rindex == nullptr || rindex->GetVectorLength() == 0) return entry;
+
+  // Same trapezoidal integral as G4Cerenkov::BuildPhysicsTable
+  entry.rindex = rindex;
+  size_t n = rindex->GetVectorLength();
+  entry.energy.resize(n);
+  entry.cai.resize(n);
+  G4double prevPM = rindex->Energy(0);
+  G4double prevRI = (*rindex)[0];
+  entry.energy[0] = prevPM;
+  entry.cai[0] = 0.0;
+  for (size_t i = 1; i < n; ++i) {
+    G4double currentPM = rindex->Energy(i);
+    G4double currentRI = (*rindex)[i];
+    entry.energy[i] = currentPM;
+    entry.cai[i] = entry.cai[i - 1]
+                 + (currentPM - prevPM) * 0.5 * (1.0 / (prevRI * prevRI) + 1.0 / (currentRI * currentRI));
+    prevPM = currentPM;
+    prevRI = currentRI;
+  }
+  return entry;
+}
+
+G4double CherenkovYieldTable::InterpolateCAI(const Entry& entry, G4double photonEnergy)
+{
+  if (photonEnergy <= entry.energy.front()) return entry.cai.front();
+  if (photonEnergy >= entry.energy.back()) return entry.cai.back();
+  auto it = std::upper_bound(entry.energy.begin(), entry.energy.end(), photonEnergy);
+  size_t hi = static_cast<size_t>(it - entry.energy.begin());
+  size_t lo = hi - 1;
+  G4double t = (photonEnergy - entry.energy[lo]) / (entry.energy[hi] - entry.energy[lo]);
+  return entry.cai[lo] + t * (entry.cai[hi] - entry.cai[lo]);
+}
+
+G4double CherenkovYieldTable::GetAverageNumberOfPhotons(G4double charge, G4double beta,
+                                                         const G4Material* material)
+{
+  if (charge == 0.0 || beta <= 0.0 || material == nullptr) return 0.0;
+  const Entry& entry = GetEntry(material);
+  if (entry.rindex == nullptr) return 0.0;
+
+  // Formula and constant from G4Cerenkov::GetAverageNumberOfPhotons
+  const G4double Rfact = 369.81 / (eV * cm);
+  G4double BetaInverse = 1.0 / beta;
+  G4double Pmin = entry.energy.front();
+  G4double Pmax = entry.energy.back();
+  G4double nMin = entry.rindex->GetMinValue();
+  G4double nMax = entry.rindex->GetMaxValue();
+  G4double CAImax = entry.cai.back();
+
+  if (nMax < BetaInverse) return 0.0;
+
+  G4double dp, ge;
+  if (nMin > BetaInverse) {
+    dp = Pmax - Pmin;
+    ge = CAImax;
+  } else {
+    Pmin = entry.rindex->GetEnergy(BetaInverse);
+    dp = Pmax - Pmin;
+    ge = CAImax - InterpolateCAI(entry, Pmin);
+  }
+
+  G4double numPhotons = Rfact * (charge / eplus) * (charge / eplus) * (dp - ge * BetaInverse * BetaInverse);
+  return std::max(numPhotons, 0.0);
+}
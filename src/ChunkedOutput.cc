@@ -0,0 +1,137 @@
+//
+// ChunkedOutput.cc
+//
+
+#include "ChunkedOutput.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#ifdef CHERENKOV_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+  float LoadFloat(const char* p) { float v; std::memcpy(&v, p, sizeof(v)); return v; }
+  uint32_t LoadUInt(const char* p) { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+
+  void FillZoneMap(const char* records, size_t count, const ChunkedOutput::Layout& layout,
+                   ChunkedOutput::ChunkIndexEntry& entry)
+  {
+    const float inf = std::numeric_limits<float>::infinity();
+    const size_t posOffset[3] = {layout.x, layout.y, layout.z};
+    for (int k = 0; k < 3; ++k) {
+      entry.posMin[k] = inf;
+      entry.posMax[k] = -inf;
+    }
+    entry.energyMin = inf;
+    entry.energyMax = -inf;
+    entry.eventMin = std::numeric_limits<uint32_t>::max();
+    entry.eventMax = 0;
+    for (size_t i = 0; i < count; ++i) {
+      const char* r = records + i * layout.recordBytes;
+      for (int k = 0; k < 3; ++k) {
+        const float v = LoadFloat(r + posOffset[k]);
+        if (std::isnan(v)) continue;
+        entry.posMin[k] = std::min(entry.posMin[k], v);
+        entry.posMax[k] = std::max(entry.posMax[k], v);
+      }
+      const float e = LoadFloat(r + layout.energy);
+      if (!std::isnan(e)) {
+        entry.energyMin = std::min(entry.energyMin, e);
+        entry.energyMax = std::max(entry.energyMax, e);
+      }
+      const uint32_t event = LoadUInt(r + layout.eventId);
+      entry.eventMin = std::min(entry.eventMin, event);
+      entry.eventMax = std::max(entry.eventMax, event);
+    }
+  }
+
+  // out[j * count + i] = in[i * recordBytes + j]
+  void ByteShuffle(const char* in, size_t count, size_t recordBytes, char* out)
+  {
+    for (size_t i = 0; i < count; ++i) {
+      const char* r = in + i * recordBytes;
+      for (size_t j = 0; j < recordBytes; ++j) {
+        out[j * count + i] = r[j];
+      }
+    }
+  }
+}
+
+namespace ChunkedOutput {
+
+G4bool Available()
+{
+#ifdef CHERENKOV_WITH_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+FileHeader MakeFileHeader()
+{
+  FileHeader header{};
+  std::memcpy(header.magic, kFileMagic, sizeof(header.magic));
+  header.version = kVersion;
+  header.codec = kCodecZlib;
+  header.filter = kFilterByteShuffle;
+  return header;
+}
+
+Trailer MakeTrailer(uint64_t indexOffset, uint64_t totalRecords, uint32_t chunkCount, uint32_t recordBytes)
+{
+  Trailer trailer{};
+  trailer.indexOffset = indexOffset;
+  trailer.totalRecords = totalRecords;
+  trailer.chunkCount = chunkCount;
+  trailer.recordBytes = recordBytes;
+  std::memcpy(trailer.magic, kTrailerMagic, sizeof(trailer.magic));
+  return trailer;
+}
+
+G4bool CompressChunk(const char* records, size_t count, const Layout& layout,
+                     std::vector<char>& out, ChunkIndexEntry& entry)
+{
+#ifdef CHERENKOV_WITH_ZLIB
+  entry = ChunkIndexEntry{};
+  entry.records = static_cast<uint32_t>(count);
+  FillZoneMap(records, count, layout, entry);
+
+  // 重排缓冲与压缩输出都按线程复用，不在每个 chunk 上分配
+  thread_local std::vector<char> shuffled;
+  const size_t rawBytes = count * layout.recordBytes;
+  shuffled.resize(rawBytes);
+  ByteShuffle(records, count, layout.recordBytes, shuffled.data());
+
+  uLongf compressedBytes = compressBound(static_cast<uLong>(rawBytes));
+  out.resize(compressedBytes);
+  const int rc = compress2(reinterpret_cast<Bytef*>(out.data()), &compressedBytes,
+                           reinterpret_cast<const Bytef*>(shuffled.data()), static_cast<uLong>(rawBytes),
+                           Z_BEST_SPEED);
+  if (rc != Z_OK) {
+    G4cerr << "ERROR: zlib compress2 failed (" << rc << ")" << G4endl;
+    return false;
+  }
+  out.resize(compressedBytes);
+  entry.compressedBytes = static_cast<uint32_t>(compressedBytes);
+  return true;
+#else
+  (void)records; (void)count; (void)layout; (void)out; (void)entry;
+  return false;
+#endif
+}
+
+void StoreChunk(const char* records, size_t count, const Layout& layout, ChunkIndexEntry& entry)
+{
+  entry = ChunkIndexEntry{};
+  entry.records = static_cast<uint32_t>(count);
+  FillZoneMap(records, count, layout, entry);
+  entry.compressedBytes = static_cast<uint32_t>(count * layout.recordBytes);
+  entry.flags = kChunkCodecNone;
+}
+
+}  // namespace ChunkedOutput
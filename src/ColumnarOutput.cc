@@ -0,0 +1,45 @@
+//
+// ColumnarOutput.cc
+//
+
+#include "ColumnarOutput.hh"
+
+#include <cstring>
+#include <sstream>
+
+namespace ColumnarOutput {
+
+std::string ColumnPath(const std::string& path, const Column& column)
+{
+  return path + "." + column.name + ".npy";
+}
+
+std::string MakeHeader(const Column& column, uint64_t rows)
+{
+  std::ostringstream dict;
+  dict << "{'descr': '" << column.descr << "', 'fortran_order': False, 'shape': (" << rows << ",";
+  if (column.width > 1) dict << " " << column.width;
+  dict << "), }";
+  // magic(6) + version(2) + header_len(2) + dict，空格补齐到 kHeaderBytes，最后一个字节为 '\n'
+  std::string text = dict.str();
+  const size_t headerLen = kHeaderBytes - 10;
+  text.resize(headerLen - 1, ' ');
+  text += '\n';
+  std::string header("\x93NUMPY\x01\x00", 8);
+  header += static_cast<char>(headerLen & 0xff);
+  header += static_cast<char>((headerLen >> 8) & 0xff);
+  return header + text;
+}
+
+void Gather(const char* records, size_t count, size_t stride, const Column& column, char* out)
+{
+  const size_t bytes = column.itemBytes * static_cast<size_t>(column.width);
+  const char* in = records + column.offset;
+  for (size_t i = 0; i < count; ++i) {
+    std::memcpy(out, in, bytes);
+    out += bytes;
+    in += stride;
+  }
+}
+
+}  // namespace ColumnarOutput
@@ -1,6 +1,14 @@
 #include "Config.hh"
+#include "ChunkedOutput.hh"
+#include "G4Types.hh"
+#include "G4Version.hh"
 #include <fstream>
 #include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdint>
+#include <algorithm>
+#include <initializer_list>
 
 Config* Config::fInstance = nullptr;
 
@@ -32,6 +40,114 @@ void Config::LoadConfig(const std::string& configFilePath)
   }
 }
 
+namespace {
+  // "+x" / "-x" / "+y" / "-y" / "+z" / "-z"
+  bool IsAxisFace(const std::string& face)
+  {
+    return face.size() == 2 && (face[0] == '+' || face[0] == '-') && face[1] >= 'x' && face[1] <= 'z';
+  }
+
+  // RunAction 按小写比较 output_format
+  std::string Lower(std::string s)
+  {
+    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+    return s;
+  }
+
+  // 字符串选项的 getter 与使用处对未知取值静默退回默认行为：拼错的值在这里报错
+  bool CheckChoice(const char* key, const std::string& value, std::initializer_list<const char*> allowed)
+  {
+    std::string list;
+    for (const char* choice : allowed) {
+      if (value == choice) return true;
+      list += list.empty() ? choice : std::string(", ") + choice;
+    }
+    std::cerr << "ERROR: unknown " << key << " '" << value << "' (" << list << ")" << std::endl;
+    return false;
+  }
+}
+
+bool Config::Validate() const
+{
+  bool ok = true;
+  const std::string mode = GetCherenkovMode();
+  if (mode != "full" && mode != "creation_only" && mode != "analytic" && mode != "yield_only") {
+    std::cerr << "ERROR: unknown simulation.cherenkov_mode '" << mode
+              << "' (full, creation_only, analytic, yield_only)" << std::endl;
+    ok = false;
+  }
+  // 非 "binary" 的取值都会走 CSV 分支
+  if (!CheckChoice("simulation.output_format", Lower(GetOutputFormat()), {"binary", "csv"})) ok = false;
+  if (!CheckChoice("simulation.writer_mode", GetWriterMode(), {"queue", "pwrite"})) ok = false;
+  if (!CheckChoice("simulation.writer_fsync", GetWriterFsync(), {"none", "end_of_run", "every_buffer"})) ok = false;
+  const std::string compression = GetOutputCompression();
+  if (!CheckChoice("simulation.output_compression", compression, {"none", "zlib"})) ok = false;
+  // 没有 zlib 时 AsyncWriter 只能写裸记录流，与配置不符
+  if (compression == "zlib" && !ChunkedOutput::Available()) {
+    std::cerr << "ERROR: simulation.output_compression = zlib but this build has no zlib (CHERENKOV_WITH_ZLIB)" << std::endl;
+    ok = false;
+  }
+  if (!CheckChoice("simulation.photon_format", GetPhotonFormat(), {"full", "compact"})) ok = false;
+  if (!CheckChoice("simulation.output_layout", GetOutputLayout(), {"records", "columns"})) ok = false;
+  // creation_only 在入栈时记录并 kill 光子；不写 .creation 时光子会被丢弃而无任何输出
+  if (mode == "creation_only" && !GetEnableCherenkovOutput()) {
+    std::cerr << "ERROR: simulation.cherenkov_mode = creation_only requires enable_cherenkov_output = true" << std::endl;
+    ok = false;
+  }
+  // .creation 只有二进制格式：CSV 下光子照样在入栈时被 kill，却没有任何输出
+  if (mode == "creation_only" && Lower(GetOutputFormat()) != "binary") {
+    std::cerr << "ERROR: simulation.cherenkov_mode = creation_only requires output_format = binary" << std::endl;
+    ok = false;
+  }
+  // 同理：yield 网格只在二进制分支建立（SetUpYieldOutput），CSV 下不产生光子也不写 .yield
+  if (mode == "yield_only" && Lower(GetOutputFormat()) != "binary") {
+    std::cerr << "ERROR: simulation.cherenkov_mode = yield_only requires output_format = binary" << std::endl;
+    ok = false;
+  }
+  // 不支持的面（如 "z"）以前被当作无目标面 / +z，结果与配置不符
+  if (GetImportanceRouletteEnabled() && !GetImportanceTargetFace().empty() && !IsAxisFace(GetImportanceTargetFace())) {
+    std::cerr << "ERROR: unsupported variance_reduction.importance_target_face '" << GetImportanceTargetFace()
+              << "' (+x, -x, +y, -y, +z, -z, or \"\" for none)" << std::endl;
+    ok = false;
+  }
+  if (GetDirectionBiasEnabled() && GetDirectionBiasTarget() == "face" && !IsAxisFace(GetDirectionBiasFace())) {
+    std::cerr << "ERROR: unsupported variance_reduction.direction_bias_face '" << GetDirectionBiasFace()
+              << "' (+x, -x, +y, -y, +z, -z)" << std::endl;
+    ok = false;
+  }
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("photon_yield_fraction")) {
+    const double f = fConfig["variance_reduction"]["photon_yield_fraction"];
+    if (!(f > 0.0 && f <= 1.0)) {
+      std::cerr << "WARNING: variance_reduction.photon_yield_fraction must be in (0, 1]; using 1.0" << std::endl;
+    }
+  }
+  if (fConfig["simulation"].contains("optical_subevent_size") &&
+      fConfig["simulation"]["optical_subevent_size"].get<int>() > 0 && GetOpticalSubEventSize() == 0) {
+    std::cerr << "WARNING: simulation.optical_subevent_size needs cherenkov_mode = full and a multithreaded "
+              << "Geant4 >= 11.2; photons stay in their event" << std::endl;
+  }
+  // sub-event 模式下 master 也处理事件，CSV 只合并 worker 的 .thread_<i> 文件，master 的光子会丢失
+  if (GetOpticalSubEventSize() > 0 && Lower(GetOutputFormat()) != "binary") {
+    std::cerr << "ERROR: simulation.optical_subevent_size requires output_format = binary" << std::endl;
+    ok = false;
+  }
+  // GetPhysicsList 对未知取值退回 FTFP_BERT，EmOnlyPhysicsList::CreateEmPhysics 对未知 em_option 退回 option4
+  if (fConfig.contains("physics")) {
+    const auto& physics = fConfig["physics"];
+    if (physics.contains("physics_list") &&
+        !CheckChoice("physics.physics_list", physics["physics_list"].get<std::string>(), {"FTFP_BERT", "em_only"})) {
+      ok = false;
+    }
+    const int emOption = GetEmOption();
+    if (emOption != 0 && emOption != 3 && emOption != 4) {
+      std::cerr << "ERROR: unknown physics.em_option " << emOption << " (0, 3, 4)" << std::endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
 // Geometry parameters
 double Config::GetWorldSizeX() const
 {
@@ -88,6 +204,60 @@ bool Config::GetCheckOverlaps() const
   return fConfig["geometry"]["check_overlaps"];
 }
 
+bool Config::GetVoxelPhantomEnabled() const
+{
+  if (fConfig.contains("voxel_phantom") && fConfig["voxel_phantom"].contains("enabled")) {
+    return fConfig["voxel_phantom"]["enabled"];
+  }
+  return false;
+}
+
+std::string Config::GetVoxelPhantomFile() const
+{
+  if (fConfig.contains("voxel_phantom") && fConfig["voxel_phantom"].contains("raw_file")) {
+    return fConfig["voxel_phantom"]["raw_file"];
+  }
+  return "";
+}
+
+std::vector<int> Config::GetVoxelPhantomDims() const
+{
+  std::vector<int> dims;
+  if (fConfig.contains("voxel_phantom") && fConfig["voxel_phantom"].contains("dims")) {
+    for (const auto& n : fConfig["voxel_phantom"]["dims"]) {
+      dims.push_back(n);
+    }
+  }
+  return dims;
+}
+
+std::string Config::GetVoxelPhantomDataType() const
+{
+  if (fConfig.contains("voxel_phantom") && fConfig["voxel_phantom"].contains("dtype")) {
+    return fConfig["voxel_phantom"]["dtype"];
+  }
+  return "uint8";
+}
+
+std::vector<VoxelMaterialSpec> Config::GetVoxelPhantomMaterials() const
+{
+  std::vector<VoxelMaterialSpec> specs;
+  if (!fConfig.contains("voxel_phantom") || !fConfig["voxel_phantom"].contains("materials")) {
+    return specs;
+  }
+  for (const auto& m : fConfig["voxel_phantom"]["materials"]) {
+    VoxelMaterialSpec spec;
+    spec.name = m["name"].get<std::string>();
+    spec.base = m.contains("base") ? m["base"].get<std::string>() : std::string("water");
+    spec.density = m.contains("density_g_cm3") ? m["density_g_cm3"].get<double>() : 0.0;
+    spec.optical = m.contains("optical") ? m["optical"].get<std::string>() : std::string("water");
+    spec.refractiveIndex = m.contains("refractive_index") ? m["refractive_index"].get<double>() : 0.0;
+    spec.absorptionLength = m.contains("absorption_length_m") ? m["absorption_length_m"].get<double>() : 0.0;
+    specs.push_back(spec);
+  }
+  return specs;
+}
+
 // Material parameters - Air
 double Config::GetAirDensity() const
 {
@@ -200,6 +370,78 @@ int Config::GetBufferSize() const
   return 100000;
 }
 
+int Config::GetWriterQueueDepth() const
+{
+  if (fConfig["simulation"].contains("writer_queue_depth")) {
+    return std::max(0, fConfig["simulation"]["writer_queue_depth"].get<int>());
+  }
+  return 4;
+}
+
+std::string Config::GetWriterMode() const
+{
+  if (fConfig["simulation"].contains("writer_mode")) {
+    return fConfig["simulation"]["writer_mode"].get<std::string>();
+  }
+  return "queue";
+}
+
+bool Config::GetWriterDirectIO() const
+{
+  if (fConfig["simulation"].contains("writer_direct_io")) {
+    return fConfig["simulation"]["writer_direct_io"].get<bool>();
+  }
+  return false;
+}
+
+std::string Config::GetWriterFsync() const
+{
+  if (fConfig["simulation"].contains("writer_fsync")) {
+    return fConfig["simulation"]["writer_fsync"].get<std::string>();
+  }
+  return "none";
+}
+
+double Config::GetMemoryBudgetMB() const
+{
+  if (fConfig["simulation"].contains("memory_budget_mb")) {
+    return std::max(0.0, fConfig["simulation"]["memory_budget_mb"].get<double>());
+  }
+  return 0.0;
+}
+
+std::string Config::GetOutputCompression() const
+{
+  if (fConfig["simulation"].contains("output_compression")) {
+    return fConfig["simulation"]["output_compression"].get<std::string>();
+  }
+  return "none";
+}
+
+int Config::GetOutputChunkRecords() const
+{
+  if (fConfig["simulation"].contains("output_chunk_records")) {
+    return std::max(1, fConfig["simulation"]["output_chunk_records"].get<int>());
+  }
+  return 65536;
+}
+
+std::string Config::GetPhotonFormat() const
+{
+  if (fConfig["simulation"].contains("photon_format")) {
+    return fConfig["simulation"]["photon_format"].get<std::string>();
+  }
+  return "full";
+}
+
+std::string Config::GetOutputLayout() const
+{
+  if (fConfig["simulation"].contains("output_layout")) {
+    return fConfig["simulation"]["output_layout"].get<std::string>();
+  }
+  return "records";
+}
+
 bool Config::GetEnableCherenkovOutput() const
 {
   if (fConfig["simulation"].contains("enable_cherenkov_output")) {
@@ -232,3 +474,325 @@ int Config::GetDoseBufferSize() const
   }
   return GetBufferSize();
 }
+
+std::string Config::GetCherenkovMode() const
+{
+  if (fConfig["simulation"].contains("cherenkov_mode")) {
+    return fConfig["simulation"]["cherenkov_mode"].get<std::string>();
+  }
+  return "full";
+}
+
+std::string Config::GetOpticalStacking() const
+{
+  if (fConfig["simulation"].contains("optical_stacking")) {
+    return fConfig["simulation"]["optical_stacking"].get<std::string>();
+  }
+  return "immediate";
+}
+
+bool Config::GetOpticalStagedStacking() const
+{
+  // creation_only / analytic 在入栈时就杀掉光子，yield_only 没有光子：只有 full 需要分批
+  return GetOpticalStacking() == "staged" && GetCherenkovMode() == "full" && GetOpticalSubEventSize() == 0;
+}
+
+int Config::GetOpticalBatchSize() const
+{
+  if (fConfig["simulation"].contains("optical_batch_size")) {
+    return fConfig["simulation"]["optical_batch_size"];
+  }
+  return 10000;
+}
+
+int Config::GetOpticalSubEventSize() const
+{
+  // G4SubEvtRunManager 只在 Geant4 11.2+ 的 MT 构建中存在；只有 full 模式做光学输运
+#if defined(G4MULTITHREADED) && G4VERSION_NUMBER >= 1120
+  if (GetCherenkovMode() == "full" && fConfig["simulation"].contains("optical_subevent_size")) {
+    return std::max(0, fConfig["simulation"]["optical_subevent_size"].get<int>());
+  }
+#endif
+  return 0;
+}
+
+int Config::GetOpticalSubEventMinPhotons() const
+{
+  if (fConfig["simulation"].contains("optical_subevent_min_photons")) {
+    return fConfig["simulation"]["optical_subevent_min_photons"];
+  }
+  return 2000;
+}
+
+double Config::GetPhotonYieldFraction() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("photon_yield_fraction")) {
+    double f = fConfig["variance_reduction"]["photon_yield_fraction"];
+    if (f > 0.0 && f <= 1.0) return f;  // 范围外的值由 Validate() 警告一次
+  }
+  return 1.0;
+}
+
+bool Config::GetOpticalAbsorptionWeighting() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("optical_absorption_weighting")) {
+    return fConfig["variance_reduction"]["optical_absorption_weighting"];
+  }
+  return false;
+}
+
+std::string Config::GetDirectionBiasTarget() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("direction_bias_target")) {
+    return fConfig["variance_reduction"]["direction_bias_target"];
+  }
+  return "none";
+}
+
+std::string Config::GetDirectionBiasFace() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("direction_bias_face")) {
+    return fConfig["variance_reduction"]["direction_bias_face"];
+  }
+  return "+z";
+}
+
+std::vector<double> Config::GetDirectionBiasAxis() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("direction_bias_axis")) {
+    return fConfig["variance_reduction"]["direction_bias_axis"].get<std::vector<double>>();
+  }
+  return {0.0, 0.0, 1.0};
+}
+
+double Config::GetDirectionBiasHalfAngle() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("direction_bias_half_angle_deg")) {
+    return fConfig["variance_reduction"]["direction_bias_half_angle_deg"];
+  }
+  return 30.0;
+}
+
+int Config::GetDirectionBiasAzimuthBins() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("direction_bias_azimuth_bins")) {
+    return fConfig["variance_reduction"]["direction_bias_azimuth_bins"];
+  }
+  return 36;
+}
+
+double Config::GetDirectionBiasDefensiveFraction() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("direction_bias_defensive_fraction")) {
+    return fConfig["variance_reduction"]["direction_bias_defensive_fraction"];
+  }
+  return 0.1;
+}
+
+bool Config::GetDirectionBiasEnabled() const
+{
+  // creation_only 不做光学输运、yield_only 没有光子：方向偏倚无意义
+  const std::string mode = GetCherenkovMode();
+  return GetDirectionBiasTarget() != "none" && (mode == "full" || mode == "analytic");
+}
+
+bool Config::GetImportanceRouletteEnabled() const
+{
+  // creation_only 的产生点核要求均匀权重，不做轮盘赌
+  const std::string mode = GetCherenkovMode();
+  if (mode != "full" && mode != "analytic") return false;
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("importance_roulette")) {
+    return fConfig["variance_reduction"]["importance_roulette"];
+  }
+  return false;
+}
+
+std::vector<double> Config::GetImportanceQEEnergies() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("importance_qe_energy_eV")) {
+    return fConfig["variance_reduction"]["importance_qe_energy_eV"].get<std::vector<double>>();
+  }
+  return {};
+}
+
+std::vector<double> Config::GetImportanceQE() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("importance_qe")) {
+    return fConfig["variance_reduction"]["importance_qe"].get<std::vector<double>>();
+  }
+  return {};
+}
+
+std::string Config::GetImportanceTargetFace() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("importance_target_face")) {
+    return fConfig["variance_reduction"]["importance_target_face"];
+  }
+  return "";
+}
+
+double Config::GetImportanceOffTarget() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("importance_off_target")) {
+    return fConfig["variance_reduction"]["importance_off_target"];
+  }
+  return 0.1;
+}
+
+double Config::GetImportanceMinSurvival() const
+{
+  if (fConfig.contains("variance_reduction") &&
+      fConfig["variance_reduction"].contains("importance_min_survival")) {
+    return fConfig["variance_reduction"]["importance_min_survival"];
+  }
+  return 0.02;
+}
+
+bool Config::GetPhotonWeightingEnabled() const
+{
+  return GetPhotonYieldFraction() < 1.0 || GetOpticalAbsorptionWeighting() || GetDirectionBiasEnabled() ||
+         GetImportanceRouletteEnabled();
+}
+
+double Config::GetYieldVoxelSize() const
+{
+  if (fConfig["simulation"].contains("yield_voxel_size_cm")) {
+    return fConfig["simulation"]["yield_voxel_size_cm"];
+  }
+  return 0.0;
+}
+
+// Optical physics parameters
+const std::vector<std::string>& Config::GetOpticalProcessNames()
+{
+  static const std::vector<std::string> names = {
+    "Cerenkov", "Scintillation", "OpAbsorption", "OpRayleigh",
+    "OpMieHG", "OpBoundary", "OpWLS", "OpWLS2"
+  };
+  return names;
+}
+
+bool Config::GetOpticalProcessActivation(const std::string& processName) const
+{
+  if (fConfig.contains("optical") && fConfig["optical"].contains("processes") &&
+      fConfig["optical"]["processes"].contains(processName)) {
+    return fConfig["optical"]["processes"][processName];
+  }
+  return !(processName == "Scintillation" || processName == "OpWLS" ||
+           processName == "OpWLS2" || processName == "OpMieHG");
+}
+
+int Config::GetCerenkovMaxPhotonsPerStep() const
+{
+  if (fConfig.contains("optical") && fConfig["optical"].contains("cerenkov_max_photons_per_step")) {
+    return fConfig["optical"]["cerenkov_max_photons_per_step"];
+  }
+  return 0;
+}
+
+double Config::GetCerenkovMaxBetaChange() const
+{
+  if (fConfig.contains("optical") && fConfig["optical"].contains("cerenkov_max_beta_change")) {
+    return fConfig["optical"]["cerenkov_max_beta_change"];
+  }
+  return 0.0;
+}
+
+// Physics parameters
+std::string Config::GetPhysicsList() const
+{
+  if (fConfig.contains("physics") && fConfig["physics"].contains("physics_list")) {
+    std::string name = fConfig["physics"]["physics_list"];
+    if (name == "FTFP_BERT" || name == "em_only") return name;  // 未知取值由 Validate 报错
+  }
+  return "FTFP_BERT";
+}
+
+int Config::GetEmOption() const
+{
+  if (fConfig.contains("physics") && fConfig["physics"].contains("em_option")) {
+    return fConfig["physics"]["em_option"];
+  }
+  return 4;
+}
+
+double Config::GetPhantomProductionCut() const
+{
+  if (fConfig.contains("physics") && fConfig["physics"].contains("phantom_production_cut_mm")) {
+    return fConfig["physics"]["phantom_production_cut_mm"];
+  }
+  return 0.0;
+}
+
+bool Config::GetCherenkovThresholdKill() const
+{
+  if (fConfig.contains("physics") && fConfig["physics"].contains("cherenkov_threshold_kill")) {
+    return fConfig["physics"]["cherenkov_threshold_kill"];
+  }
+  return false;
+}
+
+double Config::GetScoringEnvelopeMargin() const
+{
+  if (fConfig.contains("physics") && fConfig["physics"].contains("scoring_envelope_margin_cm")) {
+    return fConfig["physics"]["scoring_envelope_margin_cm"];
+  }
+  return -1.0;
+}
+
+std::string Config::GetPhysicsTableCacheDir() const
+{
+  if (fConfig.contains("physics") && fConfig["physics"].contains("physics_table_cache_dir")) {
+    return fConfig["physics"]["physics_table_cache_dir"];
+  }
+  return "";
+}
+
+std::string Config::GetPhysicsConfigKey() const
+{
+  // 物理表取决于物理列表/EM 选项/cut（physics）、光学过程（optical）与材料（含体素模体材料）；
+  // cache 目录本身不参与，避免换目录后 key 改变
+  json keyed = json::object();
+  if (fConfig.contains("physics")) {
+    keyed["physics"] = fConfig["physics"];
+    keyed["physics"].erase("physics_table_cache_dir");
+  }
+  if (fConfig.contains("optical")) keyed["optical"] = fConfig["optical"];
+  if (fConfig.contains("materials")) keyed["materials"] = fConfig["materials"];
+  if (GetVoxelPhantomEnabled()) keyed["voxel_materials"] = fConfig["voxel_phantom"]["materials"];
+  // 物理列表之外注册的构造器与实际生效的光学过程开关（与 CherenkovSim.cc 中的注册逻辑一致）：
+  // yield_only 不注册 G4OpticalPhysics，吸收期望值加权关闭 OpAbsorption，两者的物理表不同
+  keyed["constructors"] = json::array();
+  if (GetCherenkovMode() != "yield_only") {
+    keyed["constructors"].push_back("G4OpticalPhysics");
+    json active = json::object();
+    for (const std::string& name : GetOpticalProcessNames()) {
+      active[name] = GetOpticalProcessActivation(name) &&
+                     !(name == "OpAbsorption" && GetOpticalAbsorptionWeighting());
+    }
+    keyed["optical_processes"] = active;
+  }
+  const std::string text = keyed.dump();
+
+  std::uint64_t hash = 1469598103934665603ULL;  // FNV-1a 64-bit
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  std::ostringstream out;
+  out << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return out.str();
+}
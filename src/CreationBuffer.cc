@@ -0,0 +1,111 @@
+//
+// CreationBuffer.cc - Implementation for creation-only Cherenkov binary output
+//
+
+#include "CreationBuffer.hh"
+#include "AsyncWriter.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include <fstream>
+#include <iostream>
+
+#ifdef G4MULTITHREADED
+#include "G4MTRunManager.hh"
+#endif
+
+CreationBuffer::CreationBuffer(G4int bufferSize)
+: fBufferSize(bufferSize), fBufferEntries(0), fTotalEntries(0), fOutputPath(""),
+  fComponent(G4Threading::IsWorkerThread() ? MemoryBudget::kWorkerBuffers : MemoryBudget::kMasterBuffers),
+  fTrackedBytes(0)
+{
+#ifdef G4MULTITHREADED
+  if (G4Threading::IsWorkerThread()) {
+    G4int nThreads = G4MTRunManager::GetMasterRunManager()->GetNumberOfThreads();
+    if (nThreads > 0) {
+      fBufferSize = bufferSize / nThreads;
+    }
+  }
+#endif
+  // memory_budget_mb: capacity planned by MemoryBudget for this run replaces the rule above
+  if (MemoryBudget::GetBufferRecords(MemoryBudget::kCreationStream) > 0) {
+    fBufferSize = MemoryBudget::GetBufferRecords(MemoryBudget::kCreationStream);
+  }
+
+  fBuffer.reserve(fBufferSize);
+  TrackCapacity();
+}
+
+CreationBuffer::~CreationBuffer()
+{
+  ClearBuffer();
+  std::vector<BinaryCreationData>().swap(fBuffer);
+  TrackCapacity();
+}
+
+void CreationBuffer::Fill(G4double x, G4double y, G4double z,
+                          G4double dirX, G4double dirY, G4double dirZ,
+                          G4double energy, G4int event_id, G4int track_id, G4int parent_id)
+{
+  BinaryCreationData data;
+  // Position in Geant4 internal units -> cm; energy -> microeV (same convention as .phsp)
+  data.x    = static_cast<float>(x / cm);
+  data.y    = static_cast<float>(y / cm);
+  data.z    = static_cast<float>(z / cm);
+  data.dirX = static_cast<float>(dirX);
+  data.dirY = static_cast<float>(dirY);
+  data.dirZ = static_cast<float>(dirZ);
+  data.energy    = static_cast<float>((energy / eV) * 1000000.0);
+  data.event_id  = static_cast<uint32_t>(event_id >= 0 ? event_id : 0);
+  data.track_id  = static_cast<int32_t>(track_id);
+  data.parent_id = static_cast<int32_t>(parent_id);
+
+  fBuffer.push_back(data);
+  fBufferEntries++;
+  fTotalEntries++;
+}
+
+void CreationBuffer::WriteBuffer(const std::string& filePath)
+{
+  if (fBufferEntries == 0) return;
+
+  // Hand the whole buffer to the I/O thread (moved, not copied)
+  std::vector<BinaryCreationData> full;
+  full.swap(fBuffer);
+  TrackCapacity();
+  AsyncWriter::Instance()->Submit(filePath, std::move(full));
+  fBuffer.reserve(fBufferSize);
+  TrackCapacity();
+}
+
+void CreationBuffer::AbsorbWorkerBuffer(CreationBuffer* workerBuffer)
+{
+  if (workerBuffer->GetBufferEntries() == 0) return;
+
+  fTotalEntries += workerBuffer->GetBufferEntries();
+
+  // Worker records go straight to the I/O thread (no copy into the master buffer)
+  workerBuffer->WriteBuffer(fOutputPath);
+  workerBuffer->ClearBuffer();
+}
+
+void CreationBuffer::ClearBuffer()
+{
+  fBuffer.clear();
+  fBufferEntries = 0;
+}
+
+void CreationBuffer::SetBufferSize(G4int bufferSize)
+{
+  if (bufferSize == fBufferSize) return;
+  fBufferSize = bufferSize;
+  std::vector<BinaryCreationData>().swap(fBuffer);
+  fBuffer.reserve(fBufferSize);
+  TrackCapacity();
+}
+
+void CreationBuffer::TrackCapacity()
+{
+  const long long bytes = static_cast<long long>(fBuffer.capacity() * sizeof(BinaryCreationData));
+  MemoryBudget::Add(fComponent, bytes - fTrackedBytes);
+  fTrackedBytes = bytes;
+}
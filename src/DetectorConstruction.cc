@@ -14,6 +14,48 @@
 #include "G4Material.hh"
 #include "G4Element.hh"
 #include "G4MaterialPropertiesTable.hh"
+#include "G4Region.hh"
+#include "G4ProductionCuts.hh"
+#include "G4PhantomParameterisation.hh"
+#include "G4PVParameterised.hh"
+
+#include <cstdint>
+#include <fstream>
+
+namespace {
+
+// 体素材料的光学性质：以配置中的水/空气光学表为模板，可用常数 RINDEX / ABSLENGTH 覆盖
+G4MaterialPropertiesTable* BuildVoxelOpticalTable(const VoxelMaterialSpec& spec)
+{
+  Config* config = Config::GetInstance();
+  if (spec.optical == "none") return nullptr;
+
+  const bool isAir = (spec.optical == "air");
+  std::vector<G4double> energies = isAir ? config->GetAirPhotonEnergies() : config->GetWaterPhotonEnergies();
+  for (auto& val : energies) {
+    val = val * eV;
+  }
+  std::vector<G4double> rindex = isAir ? std::vector<G4double>(energies.size(), config->GetAirRefractiveIndex())
+                                       : config->GetWaterRefractiveIndices();
+  if (spec.refractiveIndex > 0.0) {
+    rindex.assign(energies.size(), spec.refractiveIndex);
+  }
+
+  auto mpt = new G4MaterialPropertiesTable();
+  mpt->AddProperty("RINDEX", energies, rindex);
+  if (spec.absorptionLength > 0.0) {
+    mpt->AddProperty("ABSLENGTH", energies, std::vector<G4double>(energies.size(), spec.absorptionLength * m));
+  } else if (!isAir) {
+    std::vector<G4double> absorption = config->GetWaterAbsorptionLengths();
+    for (auto& val : absorption) {
+      val = val * m;
+    }
+    mpt->AddProperty("ABSLENGTH", energies, absorption);
+  }
+  return mpt;
+}
+
+}  // namespace
 
 // DetectorConstruction 继承自 G4VUserDetectorConstruction。
 // 当构造 DetectorConstruction 对象时，
@@ -121,32 +163,191 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   // Water Phantom
   // Phase space data has Z in range 17.77-27.35 cm originally
   // But we work in our own coordinate system where water is centered
-  G4double water_sizeX = config->GetWaterSizeX() * cm;
-  G4double water_sizeY = config->GetWaterSizeY() * cm;
-  G4double water_sizeZ = config->GetWaterSizeZ() * cm;
+  // voxel_phantom.enabled 时改为体素模体，外形与位置与水箱相同
+  if (config->GetVoxelPhantomEnabled()) {
+    fWaterLogical = ConstructVoxelPhantom(logicWorld, water, air, checkOverlaps);
+  } else {
+    G4double water_sizeX = config->GetWaterSizeX() * cm;
+    G4double water_sizeY = config->GetWaterSizeY() * cm;
+    G4double water_sizeZ = config->GetWaterSizeZ() * cm;
   
-  G4Box* solidWater =    
-    new G4Box("Water",                    //its name
-        0.5*water_sizeX, 0.5*water_sizeY, 0.5*water_sizeZ); //its size
+    G4Box* solidWater =    
+      new G4Box("Water",                    //its name
+          0.5*water_sizeX, 0.5*water_sizeY, 0.5*water_sizeZ); //its size
             
-  fWaterLogical =                         
-    new G4LogicalVolume(solidWater,         //its solid
-                        water,              //its material
-                        "Water");           //its name
+    fWaterLogical =                         
+      new G4LogicalVolume(solidWater,         //its solid
+                          water,              //its material
+                          "Water");           //its name
                
-  new G4PVPlacement(0,                       //no rotation
-                    G4ThreeVector(config->GetWaterPositionX() * cm, 
-                                  config->GetWaterPositionY() * cm,
-                                  config->GetWaterPositionZ() * cm),  //position from config
-                    fWaterLogical,           //its logical volume
-                    "Water",                 //its name
-                    logicWorld,              //its mother  volume
-                    false,                   //no boolean operation
-                    0,                       //copy number
-                    checkOverlaps);          //overlaps checking
+    new G4PVPlacement(0,                       //no rotation
+                      G4ThreeVector(config->GetWaterPositionX() * cm, 
+                                    config->GetWaterPositionY() * cm,
+                                    config->GetWaterPositionZ() * cm),  //position from config
+                      fWaterLogical,           //its logical volume
+                      "Water",                 //its name
+                      logicWorld,              //its mother  volume
+                      false,                   //no boolean operation
+                      0,                       //copy number
+                      checkOverlaps);          //overlaps checking
+  }
+
+  // 模体区域的产生阈：低于 Cherenkov 阈值的次级粒子无法发光，可用更大的 cut 减少步数
+  // （剂量输出开启时注意 cut 会改变能量沉积的空间分辨）
+  G4double phantomCut = config->GetPhantomProductionCut() * mm;
+  if (phantomCut > 0.0) {
+    auto phantomRegion = new G4Region("PhantomRegion");
+    phantomRegion->AddRootLogicalVolume(fWaterLogical);
+    auto cuts = new G4ProductionCuts();
+    cuts->SetProductionCut(phantomCut, "gamma");
+    cuts->SetProductionCut(phantomCut, "e-");
+    cuts->SetProductionCut(phantomCut, "e+");
+    phantomRegion->SetProductionCuts(cuts);
+  }
 
   //
   //always return the physical World
   //
   return physWorld;
 }
+
+G4Material* DetectorConstruction::BuildVoxelMaterial(const VoxelMaterialSpec& spec,
+                                                     G4Material* water, G4Material* air)
+{
+  G4Material* base = nullptr;
+  if (spec.base == "water") {
+    base = water;
+  } else if (spec.base == "air") {
+    base = air;
+  } else {
+    base = G4NistManager::Instance()->FindOrBuildMaterial(spec.base);
+  }
+  if (base == nullptr) {
+    G4ExceptionDescription msg;
+    msg << "voxel material '" << spec.name << "': unknown base material '" << spec.base << "'";
+    G4Exception("DetectorConstruction::BuildVoxelMaterial", "Voxel001", FatalException, msg);
+    return nullptr;
+  }
+
+  // 与配置中的水/空气完全相同的条目直接复用，避免重复材料（及重复的物理表）
+  const bool plain = spec.density <= 0.0 && spec.refractiveIndex <= 0.0 && spec.absorptionLength <= 0.0;
+  if (plain && ((base == water && spec.optical == "water") || (base == air && spec.optical == "air"))) {
+    return base;
+  }
+
+  G4double density = (spec.density > 0.0) ? spec.density * g / cm3 : base->GetDensity();
+  auto material = new G4Material(spec.name, density, base);
+  material->SetMaterialPropertiesTable(BuildVoxelOpticalTable(spec));
+  return material;
+}
+
+G4LogicalVolume* DetectorConstruction::ConstructVoxelPhantom(G4LogicalVolume* motherLogical,
+                                                             G4Material* water, G4Material* air,
+                                                             G4bool checkOverlaps)
+{
+  Config* config = Config::GetInstance();
+  const G4String phantomName = config->GetPhantomVolumeName();
+
+  std::vector<int> dims = config->GetVoxelPhantomDims();
+  std::vector<VoxelMaterialSpec> specs = config->GetVoxelPhantomMaterials();
+  if (dims.size() != 3 || dims[0] <= 0 || dims[1] <= 0 || dims[2] <= 0 || specs.empty()) {
+    G4Exception("DetectorConstruction::ConstructVoxelPhantom", "Voxel002", FatalException,
+                "voxel_phantom needs dims [nx, ny, nz] > 0 and a non-empty materials list");
+    return nullptr;
+  }
+  const size_t nx = dims[0], ny = dims[1], nz = dims[2];
+  const size_t nVoxels = nx * ny * nz;
+
+  // 读取体素材料序号（x 最快，其次 y、z；uint16 为 little endian）
+  const std::string rawPath = config->GetVoxelPhantomFile();
+  const std::string dtype = config->GetVoxelPhantomDataType();
+  const size_t bytesPerVoxel = (dtype == "uint16") ? 2 : 1;
+  std::ifstream rawFile(rawPath, std::ios::binary | std::ios::ate);
+  if (!rawFile.is_open() || static_cast<size_t>(rawFile.tellg()) != nVoxels * bytesPerVoxel) {
+    G4ExceptionDescription msg;
+    msg << "voxel file '" << rawPath << "' missing or not " << nx << " x " << ny << " x " << nz
+        << " x " << bytesPerVoxel << " bytes";
+    G4Exception("DetectorConstruction::ConstructVoxelPhantom", "Voxel003", FatalException, msg);
+    return nullptr;
+  }
+  rawFile.seekg(0);
+  fVoxelMaterialIndices.assign(nVoxels, 0);
+  if (bytesPerVoxel == 2) {
+    std::vector<std::uint16_t> raw(nVoxels);
+    rawFile.read(reinterpret_cast<char*>(raw.data()), nVoxels * 2);
+    std::copy(raw.begin(), raw.end(), fVoxelMaterialIndices.begin());
+  } else {
+    std::vector<std::uint8_t> raw(nVoxels);
+    rawFile.read(reinterpret_cast<char*>(raw.data()), nVoxels);
+    std::copy(raw.begin(), raw.end(), fVoxelMaterialIndices.begin());
+  }
+
+  std::vector<size_t> voxelsPerMaterial(specs.size(), 0);
+  for (size_t index : fVoxelMaterialIndices) {
+    if (index >= specs.size()) {
+      G4ExceptionDescription msg;
+      msg << "voxel file '" << rawPath << "' uses material index " << index
+          << " but only " << specs.size() << " materials are configured";
+      G4Exception("DetectorConstruction::ConstructVoxelPhantom", "Voxel004", FatalException, msg);
+      return nullptr;
+    }
+    ++voxelsPerMaterial[index];
+  }
+
+  std::vector<G4Material*> materials;
+  for (const auto& spec : specs) {
+    materials.push_back(BuildVoxelMaterial(spec, water, air));
+  }
+
+  // 容器：即原水箱（同尺寸同位置），体素恰好填满
+  G4double halfX = 0.5 * config->GetWaterSizeX() * cm;
+  G4double halfY = 0.5 * config->GetWaterSizeY() * cm;
+  G4double halfZ = 0.5 * config->GetWaterSizeZ() * cm;
+  G4double voxelHalfX = halfX / nx;
+  G4double voxelHalfY = halfY / ny;
+  G4double voxelHalfZ = halfZ / nz;
+
+  auto containerSolid = new G4Box(phantomName + "Container", halfX, halfY, halfZ);
+  auto containerLogical = new G4LogicalVolume(containerSolid, materials[0], phantomName + "Container");
+  // 容器与体素物理体积同名，SteppingAction 的按名判断（剂量、离开模体）保持不变
+  G4VPhysicalVolume* containerPhysical =
+    new G4PVPlacement(0,
+                      G4ThreeVector(config->GetWaterPositionX() * cm,
+                                    config->GetWaterPositionY() * cm,
+                                    config->GetWaterPositionZ() * cm),
+                      containerLogical,
+                      phantomName,
+                      motherLogical,
+                      false,
+                      0,
+                      checkOverlaps);
+
+  auto param = new G4PhantomParameterisation();
+  param->SetVoxelDimensions(voxelHalfX, voxelHalfY, voxelHalfZ);
+  param->SetNoVoxels(nx, ny, nz);
+  param->SetMaterials(materials);
+  param->SetMaterialIndices(fVoxelMaterialIndices.data());
+  param->BuildContainerSolid(containerPhysical);
+  param->CheckVoxelsFillContainer(halfX, halfY, halfZ);
+
+  auto voxelSolid = new G4Box("Voxel", voxelHalfX, voxelHalfY, voxelHalfZ);
+  auto voxelLogical = new G4LogicalVolume(voxelSolid, materials[0], "Voxel");
+  // kUndefined + RegularStructureId 1：由 G4RegularNavigation 直接按下标定位体素，
+  // 不走 smartvoxel，百万体素时导航开销与体素数无关
+  auto voxelPhysical = new G4PVParameterised(phantomName, voxelLogical, containerLogical,
+                                             kUndefined, static_cast<G4int>(nVoxels), param);
+  voxelPhysical->SetRegularStructureId(1);
+  // 相邻同材料体素合并为一步，减少体素边界上的步数（光子在同材料体素间也不会触发 OpBoundary）
+  param->SetSkipEqualMaterials(true);
+
+  G4cout << "Voxel phantom: " << nx << " x " << ny << " x " << nz << " voxels of "
+         << 2.0 * voxelHalfX / mm << " x " << 2.0 * voxelHalfY / mm << " x " << 2.0 * voxelHalfZ / mm
+         << " mm from " << rawPath << G4endl;
+  for (size_t i = 0; i < specs.size(); ++i) {
+    G4cout << "  [" << i << "] " << specs[i].name << " (" << materials[i]->GetName() << ", "
+           << materials[i]->GetDensity() / (g / cm3) << " g/cm3, optical " << specs[i].optical << "): "
+           << voxelsPerMaterial[i] << " voxels" << G4endl;
+  }
+
+  return containerLogical;
+}
@@ -3,6 +3,7 @@
 //
 
 #include "DoseBuffer.hh"
+#include "AsyncWriter.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4Threading.hh"
 #include <fstream>
@@ -10,11 +11,12 @@
 
 #ifdef G4MULTITHREADED
 #include "G4MTRunManager.hh"
-G4Mutex DoseBuffer::fBufferMutex = G4MUTEX_INITIALIZER;
 #endif
 
 DoseBuffer::DoseBuffer(G4int bufferSize)
-: fBufferSize(bufferSize), fBufferEntries(0), fTotalEntries(0), fOutputPath("")
+: fBufferSize(bufferSize), fBufferEntries(0), fTotalEntries(0), fOutputPath(""),
+  fComponent(G4Threading::IsWorkerThread() ? MemoryBudget::kWorkerBuffers : MemoryBudget::kMasterBuffers),
+  fTrackedBytes(0)
 {
 #ifdef G4MULTITHREADED
   if (G4Threading::IsWorkerThread()) {
@@ -24,13 +26,20 @@ DoseBuffer::DoseBuffer(G4int bufferSize)
     }
   }
 #endif
+  // memory_budget_mb: capacity planned by MemoryBudget for this run replaces the rule above
+  if (MemoryBudget::GetBufferRecords(MemoryBudget::kDoseStream) > 0) {
+    fBufferSize = MemoryBudget::GetBufferRecords(MemoryBudget::kDoseStream);
+  }
 
   fBuffer.reserve(fBufferSize);
+  TrackCapacity();
 }
 
 DoseBuffer::~DoseBuffer()
 {
   ClearBuffer();
+  std::vector<BinaryDoseData>().swap(fBuffer);
+  TrackCapacity();
 }
 
 void DoseBuffer::Fill(G4double x, G4double y, G4double z,
@@ -58,38 +67,23 @@ void DoseBuffer::WriteBuffer(const std::string& filePath)
 {
   if (fBufferEntries == 0) return;
 
-  std::ofstream outFile(filePath, std::ios::app | std::ios::binary);
-  if (!outFile.good()) {
-    G4cerr << "ERROR: Cannot open dose output file for writing: " << filePath << G4endl;
-    return;
-  }
-
-  for (const auto& rec : fBuffer) {
-    outFile.write(reinterpret_cast<const char*>(&rec), sizeof(BinaryDoseData));
-  }
-  outFile.close();
+  // Hand the whole buffer to the I/O thread (moved, not copied)
+  std::vector<BinaryDoseData> full;
+  full.swap(fBuffer);
+  TrackCapacity();
+  AsyncWriter::Instance()->Submit(filePath, std::move(full));
+  fBuffer.reserve(fBufferSize);
+  TrackCapacity();
 }
 
 void DoseBuffer::AbsorbWorkerBuffer(DoseBuffer* workerBuffer)
 {
-#ifdef G4MULTITHREADED
-  G4AutoLock lock(&fBufferMutex);
-#endif
-
   if (workerBuffer->GetBufferEntries() == 0) return;
 
-  if (fBufferEntries + workerBuffer->GetBufferEntries() > fBufferSize) {
-    if (fBufferEntries > 0) {
-      WriteBuffer(fOutputPath);
-      ClearBuffer();
-    }
-  }
+  fTotalEntries += workerBuffer->GetBufferEntries();
 
-  for (const auto& rec : workerBuffer->fBuffer) {
-    fBuffer.push_back(rec);
-  }
-  fBufferEntries += workerBuffer->GetBufferEntries();
-  fTotalEntries  += workerBuffer->GetBufferEntries();
+  // Worker records go straight to the I/O thread (no copy into the master buffer)
+  workerBuffer->WriteBuffer(fOutputPath);
   workerBuffer->ClearBuffer();
 }
 
@@ -98,3 +92,19 @@ void DoseBuffer::ClearBuffer()
   fBuffer.clear();
   fBufferEntries = 0;
 }
+
+void DoseBuffer::SetBufferSize(G4int bufferSize)
+{
+  if (bufferSize == fBufferSize) return;
+  fBufferSize = bufferSize;
+  std::vector<BinaryDoseData>().swap(fBuffer);
+  fBuffer.reserve(fBufferSize);
+  TrackCapacity();
+}
+
+void DoseBuffer::TrackCapacity()
+{
+  const long long bytes = static_cast<long long>(fBuffer.capacity() * sizeof(BinaryDoseData));
+  MemoryBudget::Add(fComponent, bytes - fTrackedBytes);
+  fTrackedBytes = bytes;
+}
@@ -0,0 +1,36 @@
+//
+// EmOnlyPhysicsList.cc
+//
+
+#include "EmOnlyPhysicsList.hh"
+
+#include "G4EmStandardPhysics.hh"
+#include "G4EmStandardPhysics_option3.hh"
+#include "G4EmStandardPhysics_option4.hh"
+#include "G4SystemOfUnits.hh"
+
+EmOnlyPhysicsList::EmOnlyPhysicsList(G4int emOption)
+: G4VModularPhysicsList()
+{
+  // 与 FTFP_BERT 相同的默认产生阈（0.7 mm），两种列表的结果可直接比较
+  SetDefaultCutValue(0.7 * mm);
+  SetVerboseLevel(1);
+
+  // 6 MV 光子低于 O-16 光核反应阈（15.7 MeV），去掉 G4EmExtraPhysics/强子物理不丢失任何过程
+  RegisterPhysics(CreateEmPhysics(emOption));
+}
+
+G4VPhysicsConstructor* EmOnlyPhysicsList::CreateEmPhysics(G4int emOption)
+{
+  switch (emOption) {
+    case 0:
+      return new G4EmStandardPhysics();
+    case 3:
+      return new G4EmStandardPhysics_option3();
+    case 4:
+      return new G4EmStandardPhysics_option4();
+    default:
+      G4cerr << "WARNING: physics.em_option " << emOption << " not supported (0, 3, 4); using option4" << G4endl;
+      return new G4EmStandardPhysics_option4();
+  }
+}
@@ -4,28 +4,50 @@
 
 #include "EventAction.hh"
 #include "RunAction.hh"
+#include "RunStatistics.hh"
+#include "MemoryBudget.hh"
 
 #include "G4Event.hh"
 #include "G4PrimaryVertex.hh"
 #include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Version.hh"
 
-std::atomic<G4int> EventAction::fTotalPhotonCount(0);
-std::atomic<long> EventAction::fDoseDepositsWithoutPrimary(0);
+#include <cmath>
 
 EventAction::EventAction(RunAction* runAction)
 : G4UserEventAction(),
-  fRunAction(runAction)
+  fRunAction(runAction),
+  fPhotonTableBytes(0),
+  fHasPrimaryVertex(false),
+  fSubEvent(false),
+  fEventSteps(0),
+  fEventThresholdKills(0),
+  fEventThresholdKilledEnergy(0.0),
+  fEventEnvelopeKillsCharged(0),
+  fEventEnvelopeKillsNeutral(0)
 {}
 
 EventAction::~EventAction()
-{}
+{
+  MemoryBudget::Add(MemoryBudget::kPhotonTables, -fPhotonTableBytes);
+}
 
 void EventAction::BeginOfEventAction(const G4Event* event)
 {
-  fPhotonDataMap.clear();
+  fPhotonTable.Clear();
 
-  G4PrimaryVertex* pv = event->GetPrimaryVertex(0);
+  // sub-event 没有初级顶点：顶点与 event_id 取自 master 上的母事件（母事件在全部 sub-event 返回前不会删除），
+  // 记录与母事件在 master 上写出的部分同属一个 event_id
+  const G4Event* primaryEvent = event;
+  fSubEvent = false;
+#if defined(G4MULTITHREADED) && G4VERSION_NUMBER >= 1120
+  if (event->GetMotherEvent() != nullptr) {
+    primaryEvent = event->GetMotherEvent();
+    fSubEvent = true;
+  }
+#endif
+  G4PrimaryVertex* pv = primaryEvent->GetPrimaryVertex(0);
   if (pv) {
     G4ThreeVector pos = pv->GetPosition();
     fPrimaryVertexX = pos.x() / cm;
@@ -36,58 +58,94 @@ void EventAction::BeginOfEventAction(const G4Event* event)
     fPrimaryVertexX = fPrimaryVertexY = fPrimaryVertexZ = 0.0;
     fHasPrimaryVertex = false;
   }
-  fCurrentEventId = event->GetEventID();
+  fCurrentEventId = primaryEvent->GetEventID();
+  fEventSteps = 0;
+  fEventThresholdKills = 0;
+  fEventThresholdKilledEnergy = 0.0;
+  fEventEnvelopeKillsCharged = 0;
+  fEventEnvelopeKillsNeutral = 0;
 }
 
 void EventAction::EndOfEventAction(const G4Event*)
 {   
-  // Write out all complete photon data
-  for (const auto& pair : fPhotonDataMap) {
-    const PhotonData& data = pair.second;
-    if (data.hasData) {
-      fRunAction->RecordPhotonData(
-        data.initialX, data.initialY, data.initialZ,
-        data.initialDirX, data.initialDirY, data.initialDirZ,
-        data.finalX, data.finalY, data.finalZ,
-        data.finalDirX, data.finalDirY, data.finalDirZ,
-        data.finalEnergy, fCurrentEventId, pair.first
-      );
-    }
+  // Write out all complete photon data (one batch per event)
+  fRunAction->RecordPhotonEvent(fPhotonTable, fCurrentEventId);
+
+  // 表容量计入 MemoryBudget；超过预算槽数的表不跨事件保留（事件内仍按需增长，不能丢光子）
+  const long long tableBytes = static_cast<long long>(fPhotonTable.Capacity() * sizeof(PhotonData));
+  MemoryBudget::Add(MemoryBudget::kPhotonTables, tableBytes - fPhotonTableBytes);
+  fPhotonTableBytes = tableBytes;
+  const size_t maxSlots = MemoryBudget::GetPhotonTableSlots();
+  if (maxSlots > 0 && fPhotonTable.Capacity() > maxSlots) {
+    fPhotonTable.Release();
+    MemoryBudget::Add(MemoryBudget::kPhotonTables, -fPhotonTableBytes);
+    fPhotonTableBytes = 0;
+  }
+  fRunAction->EndOfEventYield();
+
+  RunStatistics::Add(RunStatistics::kSteps, fEventSteps);
+  if (fEventThresholdKills > 0) {
+    RunStatistics::Add(RunStatistics::kThresholdKills, fEventThresholdKills);
+    RunStatistics::AddThresholdKilledEnergy(fEventThresholdKilledEnergy);
   }
+  if (fEventEnvelopeKillsCharged > 0) RunStatistics::Add(RunStatistics::kEnvelopeKillsCharged, fEventEnvelopeKillsCharged);
+  if (fEventEnvelopeKillsNeutral > 0) RunStatistics::Add(RunStatistics::kEnvelopeKillsNeutral, fEventEnvelopeKillsNeutral);
+}
+
+void EventAction::MergeSubEvent(G4Event*, const G4Event*)
+{
+  RunStatistics::Add(RunStatistics::kSubEventsMerged);
 }
 
 void EventAction::RecordPhotonCreation(G4int trackID, G4double x, G4double y, G4double z,
-                                       G4double dirx, G4double diry, G4double dirz)
+                                       G4double dirx, G4double diry, G4double dirz,
+                                       G4double weight)
 {
-  fTotalPhotonCount.fetch_add(1);  // 原子递增，MT 安全
+  RunStatistics::Add(RunStatistics::kPhotons);  // 本线程计数，run 结束时合并
   
-  PhotonData& data = fPhotonDataMap[trackID];
+  PhotonData& data = fPhotonTable.Insert(trackID);
   data.initialX = x;
   data.initialY = y;
   data.initialZ = z;
   data.initialDirX = dirx;
   data.initialDirY = diry;
   data.initialDirZ = dirz;
-  data.hasData = false;
+  data.weight = weight;
 }
 
 void EventAction::RecordPhotonEnd(G4int trackID, G4double x, G4double y, G4double z,
-                                  G4double dirx, G4double diry, G4double dirz, G4double energy)
+                                  G4double dirx, G4double diry, G4double dirz, G4double energy,
+                                  G4double weight)
 {
-  auto it = fPhotonDataMap.find(trackID);
-  if (it != fPhotonDataMap.end()) {
-    PhotonData& data = it->second;
-    data.finalX = x;
-    data.finalY = y;
-    data.finalZ = z;
-    data.finalDirX = dirx;
-    data.finalDirY = diry;
-    data.finalDirZ = dirz;
-    data.finalEnergy = energy;
-    data.hasData = true;
+  PhotonData* data = fPhotonTable.Find(trackID);
+  if (data != nullptr) {
+    data->finalX = x;
+    data->finalY = y;
+    data->finalZ = z;
+    data->finalDirX = dirx;
+    data->finalDirY = diry;
+    data->finalDirZ = dirz;
+    data->finalEnergy = energy;
+    data->weight = weight;
+    data->hasData = 1;
   }
 }
 
+void EventAction::RecordPhotonBirth(G4int trackID, G4int parentID,
+                                    G4double x, G4double y, G4double z,
+                                    G4double dirx, G4double diry, G4double dirz, G4double energy)
+{
+  RunStatistics::Add(RunStatistics::kPhotons);  // 本线程计数，run 结束时合并
+  fRunAction->RecordCreationData(x, y, z, dirx, diry, dirz, energy,
+                                 fCurrentEventId, trackID, parentID);
+}
+
+void EventAction::RecordCherenkovYield(const G4ThreeVector& pre, const G4ThreeVector& post,
+                                       G4double yieldPre, G4double yieldPost, G4double expected)
+{
+  fRunAction->RecordCherenkovYield(pre, post, yieldPre, yieldPost, expected);
+}
+
 void EventAction::RecordDoseData(G4double x, G4double y, G4double z, G4double energy, G4int pdg)
 {
   G4double x_cm = x / cm;
@@ -99,7 +157,7 @@ void EventAction::RecordDoseData(G4double x, G4double y, G4double z, G4double en
     dy = y_cm - fPrimaryVertexY;
     dz = z_cm - fPrimaryVertexZ;
   } else {
-    fDoseDepositsWithoutPrimary.fetch_add(1);
+    RunStatistics::Add(RunStatistics::kDepositsWithoutPrimary);
   }
   fRunAction->RecordDoseData(x_cm, y_cm, z_cm, dx, dy, dz, energy, fCurrentEventId, pdg);
 }
@@ -0,0 +1,144 @@
+//
+// MemoryBudget.cc
+//
+
+#include "MemoryBudget.hh"
+#include "PhotonTable.hh"
+
+#include "G4Threading.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+  const char* const kComponentNames[MemoryBudget::kNumComponents] = {
+    "worker_buffers", "master_buffers", "writer_queue", "photon_tables"
+  };
+  const char* const kStreamNames[MemoryBudget::kNumStreams] = {
+    "photon", "dose", "creation"
+  };
+
+  // full 模式下 PhotonTable 占预算的比例（其余给输出缓冲）
+  constexpr double kPhotonTableShare = 0.125;
+  // 每个缓冲少于这么多记录时写盘过于零碎：提示预算过小
+  constexpr G4int kMinUsefulRecords = 1000;
+
+  G4double gBudgetMB = 0.0;
+  G4int gBufferRecords[MemoryBudget::kNumStreams] = {0, 0, 0};
+  size_t gPhotonTableSlots = 0;
+
+  // 占用由各线程在缓冲换块时更新：全局原子量，峰值用 CAS 取最大
+  std::atomic<long long> gCurrent[MemoryBudget::kNumComponents];
+  std::atomic<long long> gPeak[MemoryBudget::kNumComponents];
+  std::atomic<long long> gTotal{0};
+  std::atomic<long long> gTotalPeak{0};
+
+  void RaisePeak(std::atomic<long long>& peak, long long value)
+  {
+    long long seen = peak.load(std::memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+  }
+
+  double ToMB(long long bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+}
+
+namespace MemoryBudget {
+
+void SetBudgetMB(G4double megabytes) { gBudgetMB = megabytes > 0.0 ? megabytes : 0.0; }
+G4double GetBudgetMB() { return gBudgetMB; }
+G4bool IsEnabled() { return gBudgetMB > 0.0; }
+
+void Plan(G4int nWorkers, G4int queueDepth, G4bool photonTables,
+          const size_t recordBytes[kNumStreams], const G4double weights[kNumStreams])
+{
+  if (!IsEnabled()) return;
+
+  const double budget = gBudgetMB * 1024.0 * 1024.0;
+  const double tableBytes = photonTables ? budget * kPhotonTableShare : 0.0;
+  // 每个 worker 与 master 各持有一组缓冲，队列里最多再有 queueDepth 组
+  const G4int sets = std::max(nWorkers, 0) + 1 + std::max(queueDepth, 0);
+  const double setBytes = (budget - tableBytes) / sets;
+
+  double weightSum = 0.0;
+  for (G4int s = 0; s < kNumStreams; ++s) {
+    if (recordBytes[s] > 0) weightSum += std::max(weights[s], 0.0);
+  }
+  for (G4int s = 0; s < kNumStreams; ++s) {
+    gBufferRecords[s] = 0;
+    if (recordBytes[s] == 0 || weightSum <= 0.0) continue;
+    const double share = setBytes * std::max(weights[s], 0.0) / weightSum;
+    gBufferRecords[s] = std::max<G4int>(1, static_cast<G4int>(std::min(share / recordBytes[s], 2.0e9)));
+    if (gBufferRecords[s] < kMinUsefulRecords) {
+      G4cerr << "WARNING: memory_budget_mb = " << gBudgetMB << " leaves only " << gBufferRecords[s]
+             << " records per " << kStreamNames[s] << " buffer (" << sets << " buffer sets)" << G4endl;
+    }
+  }
+  const G4int tableThreads = std::max(nWorkers, 1);
+  gPhotonTableSlots = photonTables ? static_cast<size_t>(tableBytes / tableThreads / sizeof(PhotonData)) : 0;
+
+  G4cout << "Memory budget " << gBudgetMB << " MB: " << sets << " buffer sets, records per buffer";
+  for (G4int s = 0; s < kNumStreams; ++s) {
+    if (gBufferRecords[s] > 0) G4cout << " " << kStreamNames[s] << "=" << gBufferRecords[s];
+  }
+  if (photonTables) G4cout << ", photon table slots per thread " << gPhotonTableSlots;
+  G4cout << G4endl;
+}
+
+G4int GetBufferRecords(Stream stream)
+{
+  return IsEnabled() ? gBufferRecords[stream] : 0;
+}
+
+size_t GetPhotonTableSlots()
+{
+  return IsEnabled() ? gPhotonTableSlots : 0;
+}
+
+void Add(Component component, long long bytes)
+{
+  if (bytes == 0) return;
+  const long long now = gCurrent[component].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  const long long total = gTotal.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  if (bytes > 0) {
+    RaisePeak(gPeak[component], now);
+    RaisePeak(gTotalPeak, total);
+  }
+}
+
+void ResetPeaks()
+{
+  for (G4int c = 0; c < kNumComponents; ++c) {
+    gPeak[c].store(gCurrent[c].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+  gTotalPeak.store(gTotal.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+long long GetPeak(Component component) { return gPeak[component].load(std::memory_order_relaxed); }
+long long GetTotalPeak() { return gTotalPeak.load(std::memory_order_relaxed); }
+
+std::string ToJson()
+{
+  std::ostringstream json;
+  json << std::fixed << std::setprecision(3);
+  json << "{\"budget_mb\": " << gBudgetMB;
+  if (IsEnabled()) {
+    json << ", \"buffer_records\": {";
+    G4bool first = true;
+    for (G4int s = 0; s < kNumStreams; ++s) {
+      if (gBufferRecords[s] == 0) continue;
+      json << (first ? "" : ", ") << "\"" << kStreamNames[s] << "\": " << gBufferRecords[s];
+      first = false;
+    }
+    json << "}, \"photon_table_slots\": " << gPhotonTableSlots;
+  }
+  json << ", \"peak_mb\": {";
+  for (G4int c = 0; c < kNumComponents; ++c) {
+    json << "\"" << kComponentNames[c] << "\": " << ToMB(GetPeak(static_cast<Component>(c))) << ", ";
+  }
+  json << "\"total\": " << ToMB(GetTotalPeak()) << "}}";
+  return json.str();
+}
+
+}  // namespace MemoryBudget
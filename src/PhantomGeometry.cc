@@ -0,0 +1,83 @@
+//
+// PhantomGeometry.cc
+//
+
+#include "PhantomGeometry.hh"
+#include "Config.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <limits>
+#include <utility>
+
+PhantomGeometry::PhantomGeometry()
+{
+  Config* config = Config::GetInstance();
+  fCenter = G4ThreeVector(config->GetWaterPositionX() * cm,
+                          config->GetWaterPositionY() * cm,
+                          config->GetWaterPositionZ() * cm);
+  fHalf = G4ThreeVector(0.5 * config->GetWaterSizeX() * cm,
+                        0.5 * config->GetWaterSizeY() * cm,
+                        0.5 * config->GetWaterSizeZ() * cm);
+}
+
+G4bool PhantomGeometry::Contains(const G4ThreeVector& p, G4double margin) const
+{
+  for (int i = 0; i < 3; ++i) {
+    if (std::abs(p[i] - fCenter[i]) > fHalf[i] + margin) return false;
+  }
+  return true;
+}
+
+G4double PhantomGeometry::DistanceToExit(const G4ThreeVector& p, const G4ThreeVector& dir,
+                                         G4ThreeVector* outwardNormal) const
+{
+  if (!Contains(p)) return -1.0;
+
+  // Slab method from the inside: the exit is the nearest of the three far planes
+  G4double tExit = std::numeric_limits<G4double>::max();
+  int exitAxis = 0;
+  G4double exitSign = 1.0;
+  for (int i = 0; i < 3; ++i) {
+    if (dir[i] == 0.0) continue;
+    G4double sign = (dir[i] > 0.0) ? 1.0 : -1.0;
+    G4double t = (fCenter[i] + sign * fHalf[i] - p[i]) / dir[i];
+    if (t < tExit) {
+      tExit = t;
+      exitAxis = i;
+      exitSign = sign;
+    }
+  }
+  if (tExit < 0.0) tExit = 0.0;
+
+  if (outwardNormal != nullptr) {
+    G4ThreeVector n;
+    n[exitAxis] = exitSign;
+    *outwardNormal = n;
+  }
+  return tExit;
+}
+
+G4double PhantomGeometry::DistanceToIn(const G4ThreeVector& p, const G4ThreeVector& dir) const
+{
+  if (Contains(p)) return -1.0;
+
+  // Slab method: entry = latest near-plane crossing, exit = earliest far-plane crossing
+  G4double tNear = 0.0;
+  G4double tFar = std::numeric_limits<G4double>::max();
+  for (int i = 0; i < 3; ++i) {
+    G4double lo = fCenter[i] - fHalf[i];
+    G4double hi = fCenter[i] + fHalf[i];
+    if (dir[i] == 0.0) {
+      if (p[i] < lo || p[i] > hi) return -1.0;
+      continue;
+    }
+    G4double t1 = (lo - p[i]) / dir[i];
+    G4double t2 = (hi - p[i]) / dir[i];
+    if (t1 > t2) std::swap(t1, t2);
+    if (t1 > tNear) tNear = t1;
+    if (t2 < tFar) tFar = t2;
+    if (tNear > tFar) return -1.0;
+  }
+  return tNear;
+}
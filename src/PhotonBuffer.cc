@@ -4,6 +4,7 @@
 //
 
 #include "PhotonBuffer.hh"
+#include "AsyncWriter.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4Threading.hh"
 #include <fstream>
@@ -11,12 +12,38 @@
 
 #ifdef G4MULTITHREADED
 #include "G4MTRunManager.hh"
-G4Mutex PhotonBuffer::fBufferMutex = G4MUTEX_INITIALIZER;
 #endif
 
-PhotonBuffer::PhotonBuffer(G4int bufferSize)
-: fBufferSize(bufferSize), fBufferEntries(0), fTotalEntries(0), fOutputPath("")
+namespace {
+    // PhotonTable slot (G4 units) -> v2 record (cm, microeV)
+    inline void ConvertSlot(const PhotonData& slot, uint32_t eventId, G4int trackID, BinaryPhotonData& data)
+    {
+        data.initX = static_cast<float>(slot.initialX / cm);
+        data.initY = static_cast<float>(slot.initialY / cm);
+        data.initZ = static_cast<float>(slot.initialZ / cm);
+        data.initDirX = slot.initialDirX;
+        data.initDirY = slot.initialDirY;
+        data.initDirZ = slot.initialDirZ;
+        data.finalX = static_cast<float>(slot.finalX / cm);
+        data.finalY = static_cast<float>(slot.finalY / cm);
+        data.finalZ = static_cast<float>(slot.finalZ / cm);
+        data.finalDirX = slot.finalDirX;
+        data.finalDirY = slot.finalDirY;
+        data.finalDirZ = slot.finalDirZ;
+        data.finalEnergy = static_cast<float>((slot.finalEnergy / eV) * 1000000.0);
+        data.event_id = eventId;
+        data.track_id = static_cast<int32_t>(trackID);
+    }
+}
+
+PhotonBuffer::PhotonBuffer(G4int bufferSize, G4bool weighted, const CompactPhotonCodec* compact)
+: fWeighted(weighted), fBufferSize(bufferSize), fBufferEntries(0), fTotalEntries(0), fOutputPath(""),
+  fComponent(G4Threading::IsWorkerThread() ? MemoryBudget::kWorkerBuffers : MemoryBudget::kMasterBuffers),
+  fTrackedBytes(0), fFrameIndex(-1), fClampedPhotons(0)
 {
+    if (compact != nullptr) {
+        fCompact.reset(new CompactPhotonCodec(*compact));
+    }
 #ifdef G4MULTITHREADED
     // Adjust buffer size per worker thread (TOPAS 风格: 使用 GetNumberOfThreads)
     if (G4Threading::IsWorkerThread()) {
@@ -26,21 +53,40 @@ PhotonBuffer::PhotonBuffer(G4int bufferSize)
         }
     }
 #endif
+    // memory_budget_mb: capacity planned by MemoryBudget for this run replaces the rule above
+    if (MemoryBudget::GetBufferRecords(MemoryBudget::kPhotonStream) > 0) {
+        fBufferSize = MemoryBudget::GetBufferRecords(MemoryBudget::kPhotonStream);
+    }
     
-    fBuffer.reserve(fBufferSize);
+    Reserve();
+    TrackCapacity();
 }
 
 PhotonBuffer::~PhotonBuffer()
 {
     ClearBuffer();
+    std::vector<BinaryWeightedPhotonData>().swap(fBuffer);
+    std::vector<BinaryPhotonData>().swap(fPlainBuffer);
+    std::vector<CompactRecord>().swap(fCompactBuffer);
+    TrackCapacity();
 }
 
 void PhotonBuffer::Fill(G4double initX, G4double initY, G4double initZ,
                         G4double initDirX, G4double initDirY, G4double initDirZ,
                         G4double finalX, G4double finalY, G4double finalZ,
                         G4double finalDirX, G4double finalDirY, G4double finalDirZ,
-                        G4double finalEnergy, G4int event_id, G4int track_id)
+                        G4double finalEnergy, G4int event_id, G4int track_id,
+                        G4double weight)
 {
+    if (fCompact) {
+        FillCompact(initX, initY, initZ, initDirX, initDirY, initDirZ,
+                    finalX, finalY, finalZ, finalDirX, finalDirY, finalDirZ,
+                    finalEnergy, static_cast<uint32_t>(event_id >= 0 ? event_id : 0), weight);
+        fBufferEntries++;
+        fTotalEntries++;
+        return;
+    }
+    
     BinaryPhotonData data;
     
     // Convert to float and store in cm
@@ -66,64 +112,166 @@ void PhotonBuffer::Fill(G4double initX, G4double initY, G4double initZ,
     data.event_id = static_cast<uint32_t>(event_id >= 0 ? event_id : 0);
     data.track_id = static_cast<int32_t>(track_id);
     
-    fBuffer.push_back(data);
+    if (fWeighted) {
+        fBuffer.push_back({data, static_cast<float>(weight)});
+    } else {
+        fPlainBuffer.push_back(data);
+    }
     fBufferEntries++;
     fTotalEntries++;
 }
 
-void PhotonBuffer::WriteBuffer(const std::string& filePath)
+void PhotonBuffer::FillCompact(G4double initX, G4double initY, G4double initZ,
+                               G4double initDirX, G4double initDirY, G4double initDirZ,
+                               G4double finalX, G4double finalY, G4double finalZ,
+                               G4double finalDirX, G4double finalDirY, G4double finalDirZ,
+                               G4double finalEnergy, uint32_t event_id, G4double weight)
 {
-    if (fBufferEntries == 0) return;
+    // 事件变化（或本缓冲还没有帧）时先写一个事件帧，之后的光子计入该帧
+    if (fFrameIndex < 0 || fCompactBuffer[fFrameIndex].frame.event_id != event_id) {
+        fFrameIndex = static_cast<long long>(fCompactBuffer.size());
+        fCompactBuffer.emplace_back();
+        fCompactBuffer.back().frame = CompactPhotonCodec::MakeFrame(event_id);
+    }
+    fCompactBuffer[fFrameIndex].frame.n_photons++;
     
-    std::ofstream outFile(filePath, std::ios::app | std::ios::binary);
-    if (!outFile.good()) {
-        G4cerr << "ERROR: Cannot open output file for writing: " << filePath << G4endl;
+    fCompactBuffer.emplace_back();
+    CompactPhotonRecord& record = fCompactBuffer.back().photon;
+    G4bool clamped = fCompact->EncodePosition(initX, initY, initZ, record.initPos);
+    clamped |= fCompact->EncodePosition(finalX, finalY, finalZ, record.finalPos);
+    CompactPhotonCodec::EncodeDirection(initDirX, initDirY, initDirZ, record.initDir);
+    CompactPhotonCodec::EncodeDirection(finalDirX, finalDirY, finalDirZ, record.finalDir);
+    clamped |= CompactPhotonCodec::EncodeWavelength(finalEnergy, record.wavelength);
+    clamped |= CompactPhotonCodec::EncodeHalf(static_cast<float>(weight), record.weight);
+    if (clamped) fClampedPhotons++;
+}
+
+void PhotonBuffer::FillEvent(const PhotonTable& table, G4int event_id)
+{
+    if (fCompact) {
+        // 一个事件一个帧（预留帧 + 光子）；编码本身逐光子
+        const uint32_t eventId = static_cast<uint32_t>(event_id >= 0 ? event_id : 0);
+        const size_t before = fCompactBuffer.size();
+        fCompactBuffer.reserve(before + table.RangeSize() + 1);
+        G4int added = 0;
+        table.ForEachComplete([&](G4int, const PhotonData& slot) {
+            FillCompact(slot.initialX, slot.initialY, slot.initialZ,
+                        slot.initialDirX, slot.initialDirY, slot.initialDirZ,
+                        slot.finalX, slot.finalY, slot.finalZ,
+                        slot.finalDirX, slot.finalDirY, slot.finalDirZ,
+                        slot.finalEnergy, eventId, slot.weight);
+            ++added;
+        });
+        fBufferEntries += added;
+        fTotalEntries += added;
+        TrackCapacity();
         return;
     }
     
-    // Write all photon data in buffer (60 bytes per photon, v2)
-    for (const auto& photon : fBuffer) {
-        outFile.write(reinterpret_cast<const char*>(&photon), sizeof(BinaryPhotonData));
+    // Same conversion as Fill(), but one reserve per event and no per-photon call:
+    // the loop body is straight-line float/double arithmetic on contiguous slots
+    const uint32_t eventId = static_cast<uint32_t>(event_id >= 0 ? event_id : 0);
+    G4int added = 0;
+    if (fWeighted) {
+        const size_t before = fBuffer.size();
+        fBuffer.reserve(before + table.RangeSize());
+        table.ForEachComplete([&](G4int trackID, const PhotonData& slot) {
+            fBuffer.emplace_back();
+            ConvertSlot(slot, eventId, trackID, fBuffer.back().photon);
+            fBuffer.back().weight = slot.weight;
+        });
+        added = static_cast<G4int>(fBuffer.size() - before);
+    } else {
+        const size_t before = fPlainBuffer.size();
+        fPlainBuffer.reserve(before + table.RangeSize());
+        table.ForEachComplete([&](G4int trackID, const PhotonData& slot) {
+            fPlainBuffer.emplace_back();
+            ConvertSlot(slot, eventId, trackID, fPlainBuffer.back());
+        });
+        added = static_cast<G4int>(fPlainBuffer.size() - before);
     }
+    fBufferEntries += added;
+    fTotalEntries += added;
+    TrackCapacity();
+}
+
+void PhotonBuffer::WriteBuffer(const std::string& filePath)
+{
+    if (fBufferEntries == 0) return;
     
-    outFile.close();
-    
-    // 不打印每次写入，避免 14 亿光子时刷屏（约 1400 次）
-    // G4cout << "Wrote " << fBufferEntries << " photons to " << filePath << G4endl;
+    // Hand the whole buffer to the I/O thread (moved, not copied); 60 bytes per photon v2, 64 bytes v3,
+    // 24 bytes per photon or event frame v4 (compact).
+    // 不打印每次写入，避免 14 亿光子时刷屏
+    // 先换出再提交：内存统计从本缓冲转到写盘队列，不重复计入
+    if (fCompact) {
+        // 缓冲内的帧都是完整的（帧不跨缓冲），下一块缓冲从新帧开始
+        std::vector<CompactRecord> full;
+        full.swap(fCompactBuffer);
+        fFrameIndex = -1;
+        TrackCapacity();
+        AsyncWriter::Instance()->Submit(filePath, std::move(full));
+    } else if (fWeighted) {
+        std::vector<BinaryWeightedPhotonData> full;
+        full.swap(fBuffer);
+        TrackCapacity();
+        AsyncWriter::Instance()->Submit(filePath, std::move(full));
+    } else {
+        std::vector<BinaryPhotonData> full;
+        full.swap(fPlainBuffer);
+        TrackCapacity();
+        AsyncWriter::Instance()->Submit(filePath, std::move(full));
+    }
+    Reserve();
+    TrackCapacity();
 }
 
 void PhotonBuffer::AbsorbWorkerBuffer(PhotonBuffer* workerBuffer)
 {
-#ifdef G4MULTITHREADED
-    G4AutoLock lock(&fBufferMutex);
-#endif
-    
     if (workerBuffer->GetBufferEntries() == 0) return;
     
-    // If master buffer cannot accommodate worker buffer, write to disk first
-    if (fBufferEntries + workerBuffer->GetBufferEntries() > fBufferSize) {
-        if (fBufferEntries > 0) {
-            // 不打印每次 flush，避免 MT 下大量 worker 吸收时刷屏
-            // G4cout << "Master buffer full, writing " << fBufferEntries << " photons to disk before absorbing worker buffer" << G4endl;
-            WriteBuffer(fOutputPath);
-            ClearBuffer();
-        }
-    }
-    
-    // Absorb worker buffer data
-    for (const auto& photon : workerBuffer->fBuffer) {
-        fBuffer.push_back(photon);
-    }
-    
-    fBufferEntries += workerBuffer->GetBufferEntries();
     fTotalEntries += workerBuffer->GetBufferEntries();
     
-    // Clear worker buffer
+    // Worker records go straight to the I/O thread: no copy into the master buffer
+    workerBuffer->WriteBuffer(fOutputPath);
     workerBuffer->ClearBuffer();
 }
 
 void PhotonBuffer::ClearBuffer()
 {
     fBuffer.clear();
+    fPlainBuffer.clear();
+    fCompactBuffer.clear();
+    fFrameIndex = -1;
     fBufferEntries = 0;
 }
+
+void PhotonBuffer::SetBufferSize(G4int bufferSize)
+{
+    if (bufferSize == fBufferSize) return;
+    fBufferSize = bufferSize;
+    std::vector<BinaryWeightedPhotonData>().swap(fBuffer);
+    std::vector<BinaryPhotonData>().swap(fPlainBuffer);
+    std::vector<CompactRecord>().swap(fCompactBuffer);
+    Reserve();
+    TrackCapacity();
+}
+
+void PhotonBuffer::Reserve()
+{
+    if (fCompact) {
+        fCompactBuffer.reserve(fBufferSize);
+    } else if (fWeighted) {
+        fBuffer.reserve(fBufferSize);
+    } else {
+        fPlainBuffer.reserve(fBufferSize);
+    }
+}
+
+void PhotonBuffer::TrackCapacity()
+{
+    const long long bytes = static_cast<long long>(fBuffer.capacity() * sizeof(BinaryWeightedPhotonData) +
+                                                   fPlainBuffer.capacity() * sizeof(BinaryPhotonData) +
+                                                   fCompactBuffer.capacity() * sizeof(CompactRecord));
+    MemoryBudget::Add(fComponent, bytes - fTrackedBytes);
+    fTrackedBytes = bytes;
+}
@@ -0,0 +1,85 @@
+//
+// PhotonImportance.cc
+//
+
+#include "PhotonImportance.hh"
+#include "Config.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <cmath>
+
+PhotonImportance::PhotonImportance()
+: fGeometry(),
+  fHasTarget(false),
+  fTargetNormal(0.0, 0.0, 1.0),
+  fOffTarget(1.0),
+  fMinSurvival(1.0)
+{
+  Config* config = Config::GetInstance();
+
+  std::vector<double> qeEnergy = config->GetImportanceQEEnergies();
+  std::vector<double> qe = config->GetImportanceQE();
+  if (!qeEnergy.empty() && qeEnergy.size() == qe.size()) {
+    G4double qeMax = *std::max_element(qe.begin(), qe.end());
+    for (size_t i = 0; i < qe.size(); ++i) {
+      fQEEnergy.push_back(qeEnergy[i] * eV);
+      fQE.push_back(qeMax > 0.0 ? qe[i] / qeMax : 1.0);
+    }
+  } else if (!qeEnergy.empty() || !qe.empty()) {
+    G4cerr << "WARNING: importance_qe_energy_eV and importance_qe differ in length, QE term ignored" << G4endl;
+  }
+
+  const std::string face = config->GetImportanceTargetFace();  // "+z", "-x", ... 或 "" = 无目标面
+  if (face.size() == 2 && (face[0] == '+' || face[0] == '-') && face[1] >= 'x' && face[1] <= 'z') {  // 其它值由 Config::Validate 拒绝
+    fHasTarget = true;
+    fTargetNormal = G4ThreeVector();
+    fTargetNormal[face[1] - 'x'] = (face[0] == '-') ? -1.0 : 1.0;
+  }
+  fOffTarget = std::min(1.0, std::max(0.0, config->GetImportanceOffTarget()));
+  fMinSurvival = std::min(1.0, std::max(1.0e-6, config->GetImportanceMinSurvival()));
+
+  for (double e : config->GetWaterPhotonEnergies()) fWaterEnergy.push_back(e * eV);
+  for (double n : config->GetWaterRefractiveIndices()) fWaterRindex.push_back(n);
+  for (double l : config->GetWaterAbsorptionLengths()) fWaterAbsLength.push_back(l * m);
+}
+
+G4double PhotonImportance::Interpolate(const std::vector<G4double>& x, const std::vector<G4double>& y,
+                                       G4double at)
+{
+  if (x.empty()) return 1.0;
+  if (at <= x.front()) return y.front();
+  if (at >= x.back()) return y.back();
+  size_t i = std::upper_bound(x.begin(), x.end(), at) - x.begin();
+  G4double t = (at - x[i - 1]) / (x[i] - x[i - 1]);
+  return y[i - 1] + t * (y[i] - y[i - 1]);
+}
+
+G4double PhotonImportance::Evaluate(const G4ThreeVector& position, const G4ThreeVector& direction,
+                                    G4double energy) const
+{
+  G4double importance = fQE.empty() ? 1.0 : Interpolate(fQEEnergy, fQE, energy);
+  if (fHasTarget) {
+    G4ThreeVector normal;
+    G4double distance = fGeometry.DistanceToExit(position, direction, &normal);
+    if (distance < 0.0) return importance;  // 模体外产生：不按目标面评估
+    G4double cosIncidence = direction.dot(fTargetNormal);
+    G4double rindex = fWaterRindex.empty() ? 1.0 : Interpolate(fWaterEnergy, fWaterRindex, energy);
+    G4bool escapes = (normal == fTargetNormal) &&
+                     (1.0 - cosIncidence * cosIncidence) * rindex * rindex < 1.0;
+    if (escapes) {
+      G4double absLength = fWaterAbsLength.empty() ? 0.0 : Interpolate(fWaterEnergy, fWaterAbsLength, energy);
+      importance *= (absLength > 0.0) ? std::exp(-distance / absLength) : 1.0;
+    } else {
+      importance *= fOffTarget;
+    }
+  }
+  return importance;
+}
+
+G4double PhotonImportance::SurvivalProbability(const G4ThreeVector& position, const G4ThreeVector& direction,
+                                               G4double energy) const
+{
+  return std::min(1.0, std::max(fMinSurvival, Evaluate(position, direction, energy)));
+}
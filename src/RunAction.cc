@@ -3,13 +3,18 @@
 //
 
 #include "RunAction.hh"
-#include "EventAction.hh"
 #include "RunMetadata.hh"
+#include "RunStatistics.hh"
+#include "MemoryBudget.hh"
+#include "AsyncWriter.hh"
+#include "StartupProfile.hh"
+#include "PhantomGeometry.hh"
 
 #include "G4Run.hh"
 #include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4Threading.hh"
+#include "G4OpticalParameters.hh"
 #include "Config.hh"
 #ifdef G4MULTITHREADED
 #include "G4MTRunManager.hh"
@@ -23,6 +28,28 @@
 #include <cerrno>
 #include <cstring>
 
+namespace {
+  // 分块压缩容器（output_compression）：在 .header 中注明，读取端也可直接按文件开头的 magic 判断
+  // 列式输出（output_layout = columns）：列出各列文件
+  void WriteContainerInfo(std::ofstream& headerFile, const std::string& dataPath)
+  {
+    if (AsyncWriter::Instance()->IsColumnar(dataPath)) {
+      const std::string base = dataPath.substr(dataPath.find_last_of('/') + 1);
+      headerFile << "layout: columns\n";
+      headerFile << "Column files (NumPy .npy, np.load(path, mmap_mode=\"r\")):\n";
+      for (const auto& column : AsyncWriter::Instance()->GetColumns(dataPath)) {
+        headerFile << "  " << ColumnarOutput::ColumnPath(base, column) << " (" << column.descr;
+        if (column.width > 1) headerFile << " x " << column.width;
+        headerFile << ")\n";
+      }
+      return;
+    }
+    if (!AsyncWriter::Instance()->IsChunked(dataPath)) return;
+    headerFile << "container: chunked_zlib\n";
+    headerFile << "chunk_records: " << AsyncWriter::Instance()->GetChunkRecords() << "\n";
+  }
+}
+
 // Define static class members
 thread_local std::ofstream RunAction::fThreadOutputStream;
 std::string RunAction::fOutputBasePath = "";
@@ -30,15 +57,23 @@ thread_local PhotonBuffer* RunAction::fThreadBuffer = nullptr;
 PhotonBuffer* RunAction::fMasterBuffer = nullptr;
 thread_local DoseBuffer* RunAction::fThreadDoseBuffer = nullptr;
 DoseBuffer* RunAction::fMasterDoseBuffer = nullptr;
+thread_local CreationBuffer* RunAction::fThreadCreationBuffer = nullptr;
+CreationBuffer* RunAction::fMasterCreationBuffer = nullptr;
+thread_local YieldGrid* RunAction::fThreadYieldGrid = nullptr;
+YieldGrid* RunAction::fMasterYieldGrid = nullptr;
 
 // 定义构造函数和析构函数
 RunAction::RunAction()
-: G4UserRunAction(), fOutputFormat("binary")
+: G4UserRunAction(), fOutputFormat("binary"), fCherenkovMode("full"), fPhotonWeighting(false), fCompactPhotons(false)
 { 
+  // 每个线程（master 与各 worker）各有一个 RunAction：注册本线程的 run 计数
+  RunStatistics::RegisterThread();
 }
 
 RunAction::~RunAction()
 {
+  RunStatistics::ReleaseThread();
+
   // Close thread-local file if open (CSV mode)
   if (fThreadOutputStream.is_open()) {
     fThreadOutputStream.close();
@@ -78,6 +113,38 @@ RunAction::~RunAction()
     fMasterDoseBuffer = nullptr;
   }
 #endif
+
+  if (fThreadCreationBuffer != nullptr) {
+    delete fThreadCreationBuffer;
+    fThreadCreationBuffer = nullptr;
+  }
+#ifdef G4MULTITHREADED
+  if (G4Threading::IsMasterThread() && fMasterCreationBuffer != nullptr) {
+    delete fMasterCreationBuffer;
+    fMasterCreationBuffer = nullptr;
+  }
+#else
+  if (fMasterCreationBuffer != nullptr) {
+    delete fMasterCreationBuffer;
+    fMasterCreationBuffer = nullptr;
+  }
+#endif
+
+  if (fThreadYieldGrid != nullptr) {
+    delete fThreadYieldGrid;
+    fThreadYieldGrid = nullptr;
+  }
+#ifdef G4MULTITHREADED
+  if (G4Threading::IsMasterThread() && fMasterYieldGrid != nullptr) {
+    delete fMasterYieldGrid;
+    fMasterYieldGrid = nullptr;
+  }
+#else
+  if (fMasterYieldGrid != nullptr) {
+    delete fMasterYieldGrid;
+    fMasterYieldGrid = nullptr;
+  }
+#endif
 }
 
 void RunAction::BeginOfRunAction(const G4Run*)
@@ -86,13 +153,16 @@ void RunAction::BeginOfRunAction(const G4Run*)
   fStartTime = std::chrono::high_resolution_clock::now();
   getrusage(RUSAGE_SELF, &fStartUsage);
   
-  // 重置光子计数（仅 master 执行，避免 MT 下并发写）
+  // 重置本线程的 run 计数（master 与 worker 各自执行）
+  RunStatistics::Reset();
 #ifdef G4MULTITHREADED
   if (G4Threading::IsMasterThread())
 #endif
   {
-    EventAction::ResetPhotonCount();
-    EventAction::ResetDoseDepositsWithoutPrimary();
+    AsyncWriter::Instance()->ResetBackpressureWaits();
+    AsyncWriter::Instance()->ResetUncompressedChunks();
+    AsyncWriter::Instance()->ResetWriteFailures();
+    MemoryBudget::ResetPeaks();
   }
 
   Config* config = Config::GetInstance();
@@ -107,14 +177,29 @@ void RunAction::BeginOfRunAction(const G4Run*)
   std::transform(fOutputFormat.begin(), fOutputFormat.end(), fOutputFormat.begin(), ::tolower);
 
   G4cout << "Output format: " << fOutputFormat << G4endl;
+  fCherenkovMode = config->GetCherenkovMode();
+  fPhotonWeighting = config->GetPhotonWeightingEnabled();
+  fCompactPhotons = config->GetPhotonFormat() == "compact";
 
   if (fOutputFormat == "binary") {
     G4int bufferSize = config->GetBufferSize();
+#ifdef G4MULTITHREADED
+    if (G4Threading::IsMasterThread())
+#endif
+    {
+      PlanMemoryBudget();
+    }
 
-    if (config->GetEnableCherenkovOutput()) {
+    if (config->GetEnableCherenkovOutput() && fCherenkovMode == "creation_only") {
+      SetUpCreationOutput(bufferSize);
+    } else if (config->GetEnableCherenkovOutput() && fCherenkovMode == "yield_only") {
+      SetUpYieldOutput();
+    } else if (config->GetEnableCherenkovOutput()) {
 #ifdef G4MULTITHREADED
       if (G4Threading::IsWorkerThread()) {
-        fThreadBuffer = new PhotonBuffer(bufferSize);
+        if (fThreadBuffer == nullptr) {
+          fThreadBuffer = NewPhotonBuffer(bufferSize);
+        }
         G4cout << "Worker thread " << G4Threading::G4GetThreadId()
                << " buffer size: " << fThreadBuffer->GetBufferSize() << G4endl;
       } else {
@@ -136,9 +221,9 @@ void RunAction::BeginOfRunAction(const G4Run*)
         }
         truncateFile.close();
         if (fMasterBuffer == nullptr) {
-          fMasterBuffer = new PhotonBuffer(bufferSize);
+          fMasterBuffer = NewPhotonBuffer(bufferSize);
           fMasterBuffer->SetOutputPath(phspPath);
-          G4cout << "Master buffer created with size: " << bufferSize << G4endl;
+          G4cout << "Master buffer created with size: " << fMasterBuffer->GetBufferSize() << G4endl;
         }
       }
 #else
@@ -160,7 +245,7 @@ void RunAction::BeginOfRunAction(const G4Run*)
       }
       truncateFile.close();
       if (fMasterBuffer == nullptr) {
-        fMasterBuffer = new PhotonBuffer(bufferSize);
+        fMasterBuffer = NewPhotonBuffer(bufferSize);
         fMasterBuffer->SetOutputPath(phspPath);
       }
 #endif
@@ -171,7 +256,9 @@ void RunAction::BeginOfRunAction(const G4Run*)
       G4int doseBufferSize = config->GetDoseBufferSize();
 #ifdef G4MULTITHREADED
       if (G4Threading::IsWorkerThread()) {
-        fThreadDoseBuffer = new DoseBuffer(doseBufferSize);
+        if (fThreadDoseBuffer == nullptr) {
+          fThreadDoseBuffer = new DoseBuffer(doseBufferSize);
+        }
       } else {
         // Remove existing file (if any) and create new one
         std::string dosePath = doseBase + ".dose";
@@ -219,6 +306,43 @@ void RunAction::BeginOfRunAction(const G4Run*)
       }
 #endif
     }
+
+    ApplyMemoryBudget();
+
+    // 输出文件已截断、worker 尚未开始：每个 run 只打开一次（pwrite 模式下各线程并行写同一 fd）
+#ifdef G4MULTITHREADED
+    if (G4Threading::IsMasterThread())
+#endif
+    {
+      AsyncWriter* writer = AsyncWriter::Instance();
+      const G4bool columns = writer->GetColumnarOutput();
+      ChunkedOutput::Layout layout;
+      if (fMasterBuffer != nullptr) {
+        // compact 记录依赖所在的事件帧，不能按 chunk 拆开，也不按列拆：始终写成裸记录流
+        layout = fMasterBuffer->GetChunkLayout();
+        if (columns && !fMasterBuffer->IsCompact()) {
+          writer->OpenColumns(fMasterBuffer->GetOutputPath(), fMasterBuffer->GetColumns());
+        } else {
+          writer->OpenFile(fMasterBuffer->GetOutputPath(), fMasterBuffer->IsCompact() ? nullptr : &layout);
+        }
+      }
+      if (fMasterDoseBuffer != nullptr) {
+        layout = DoseBuffer::GetChunkLayout();
+        if (columns) {
+          writer->OpenColumns(fMasterDoseBuffer->GetOutputPath(), DoseBuffer::GetColumns());
+        } else {
+          writer->OpenFile(fMasterDoseBuffer->GetOutputPath(), &layout);
+        }
+      }
+      if (fMasterCreationBuffer != nullptr) {
+        layout = CreationBuffer::GetChunkLayout();
+        if (columns) {
+          writer->OpenColumns(fMasterCreationBuffer->GetOutputPath(), CreationBuffer::GetColumns());
+        } else {
+          writer->OpenFile(fMasterCreationBuffer->GetOutputPath(), &layout);
+        }
+      }
+    }
   } else {
     if (config->GetEnableDoseOutput()) {
 #ifdef G4MULTITHREADED
@@ -242,6 +366,9 @@ void RunAction::BeginOfRunAction(const G4Run*)
 
 void RunAction::EndOfRunAction(const G4Run* run)
 {
+  // worker 把本线程计数并入 master（worker 的 EndOfRunAction 先于 master 执行）
+  RunStatistics::Merge();
+
   if (fOutputFormat == "binary") {
 #ifdef G4MULTITHREADED
     if (G4Threading::IsWorkerThread()) {
@@ -251,38 +378,77 @@ void RunAction::EndOfRunAction(const G4Run* run)
       if (fThreadDoseBuffer != nullptr && fThreadDoseBuffer->GetBufferEntries() > 0 && fMasterDoseBuffer != nullptr) {
         fMasterDoseBuffer->AbsorbWorkerBuffer(fThreadDoseBuffer);
       }
+      if (fThreadCreationBuffer != nullptr && fThreadCreationBuffer->GetBufferEntries() > 0 && fMasterCreationBuffer != nullptr) {
+        fMasterCreationBuffer->AbsorbWorkerBuffer(fThreadCreationBuffer);
+      }
+      if (fThreadYieldGrid != nullptr && fMasterYieldGrid != nullptr) {
+        fMasterYieldGrid->Merge(*fThreadYieldGrid);
+      }
     } else {
-      if (fMasterBuffer != nullptr && fMasterBuffer->GetBufferEntries() > 0) {
-        fMasterBuffer->WriteBuffer(fOutputBasePath + ".phsp");
-        fMasterBuffer->ClearBuffer();
+      if (fMasterYieldGrid != nullptr) {
+        fMasterYieldGrid->Write(fOutputBasePath + ".yield");
+        fMasterYieldGrid->WriteHeader(fOutputBasePath + ".yield.header", run->GetNumberOfEvent());
+        G4cout << "\nYield-only output complete: " << fOutputBasePath << ".yield" << G4endl;
+      } else if (fMasterCreationBuffer != nullptr) {
+        if (fMasterCreationBuffer->GetBufferEntries() > 0) {
+          fMasterCreationBuffer->WriteBuffer(fOutputBasePath + ".creation");
+          fMasterCreationBuffer->ClearBuffer();
+        }
+        AsyncWriter::Instance()->Flush();
+        WriteCreationHeader(fOutputBasePath + ".creation.header");
+        G4cout << "\nCreation-only output complete: " << fOutputBasePath << ".creation" << G4endl;
+      } else {
+        if (fMasterBuffer != nullptr && fMasterBuffer->GetBufferEntries() > 0) {
+          fMasterBuffer->WriteBuffer(fOutputBasePath + ".phsp");
+          fMasterBuffer->ClearBuffer();
+        }
+        AsyncWriter::Instance()->Flush();
+        WriteBinaryHeader(fOutputBasePath + ".header");
+        G4cout << "\nBinary output complete: " << fOutputBasePath << ".phsp" << G4endl;
+        G4cout << "Header file: " << fOutputBasePath << ".header" << G4endl;
       }
-      WriteBinaryHeader(fOutputBasePath + ".header");
-      G4cout << "\nBinary output complete: " << fOutputBasePath << ".phsp" << G4endl;
-      G4cout << "Header file: " << fOutputBasePath << ".header" << G4endl;
 
-      if (fMasterDoseBuffer != nullptr && fMasterDoseBuffer->GetBufferEntries() > 0) {
+      if (fMasterDoseBuffer != nullptr) {
+        // worker 的剩余记录已直接交给 I/O 线程，master 缓冲可能为空，header 照写
         Config* config = Config::GetInstance();
         std::string doseBase = config->GetDoseOutputFilePath();
         fMasterDoseBuffer->WriteBuffer(doseBase + ".dose");
         fMasterDoseBuffer->ClearBuffer();
+        AsyncWriter::Instance()->Flush();
         WriteDoseHeader(doseBase + ".dose.header");
         G4cout << "Dose output: " << doseBase << ".dose" << G4endl;
       }
+      AsyncWriter::Instance()->CloseFiles();
     }
 #else
-    if (fMasterBuffer != nullptr && fMasterBuffer->GetBufferEntries() > 0) {
-      fMasterBuffer->WriteBuffer(fOutputBasePath + ".phsp");
-      fMasterBuffer->ClearBuffer();
+    if (fMasterYieldGrid != nullptr) {
+      fMasterYieldGrid->Write(fOutputBasePath + ".yield");
+      fMasterYieldGrid->WriteHeader(fOutputBasePath + ".yield.header", run->GetNumberOfEvent());
+    } else if (fMasterCreationBuffer != nullptr) {
+      if (fMasterCreationBuffer->GetBufferEntries() > 0) {
+        fMasterCreationBuffer->WriteBuffer(fOutputBasePath + ".creation");
+        fMasterCreationBuffer->ClearBuffer();
+      }
+      AsyncWriter::Instance()->Flush();
+      WriteCreationHeader(fOutputBasePath + ".creation.header");
+    } else {
+      if (fMasterBuffer != nullptr && fMasterBuffer->GetBufferEntries() > 0) {
+        fMasterBuffer->WriteBuffer(fOutputBasePath + ".phsp");
+        fMasterBuffer->ClearBuffer();
+      }
+      AsyncWriter::Instance()->Flush();
+      WriteBinaryHeader(fOutputBasePath + ".header");
     }
-    WriteBinaryHeader(fOutputBasePath + ".header");
-    if (fMasterDoseBuffer != nullptr && fMasterDoseBuffer->GetBufferEntries() > 0) {
+    if (fMasterDoseBuffer != nullptr) {
       Config* config = Config::GetInstance();
       std::string doseBase = config->GetDoseOutputFilePath();
       fMasterDoseBuffer->WriteBuffer(doseBase + ".dose");
       fMasterDoseBuffer->ClearBuffer();
+      AsyncWriter::Instance()->Flush();
       WriteDoseHeader(doseBase + ".dose.header");
       G4cout << "Dose output: " << doseBase << ".dose" << G4endl;
     }
+    AsyncWriter::Instance()->CloseFiles();
 #endif
   } else {
     // ===== CSV output mode =====
@@ -347,7 +513,7 @@ void RunAction::EndOfRunAction(const G4Run* run)
   G4cout << "          Run Statistics            " << G4endl;
   G4cout << "======================================" << G4endl;
   G4cout << "Total events: " << numEvents << G4endl;
-  G4cout << "Total Cherenkov photons: " << EventAction::GetTotalPhotonCount() << G4endl;
+  G4cout << "Total Cherenkov photons: " << RunStatistics::Get(RunStatistics::kPhotons) << G4endl;
   G4cout << "Wall clock time: "
          << std::setfill('0')
          << std::setw(2) << wallHours << " h "
@@ -361,13 +527,26 @@ void RunAction::EndOfRunAction(const G4Run* run)
   
   // Always show performance metrics
   G4double eventsPerSecond = (wallSeconds > 0) ? (G4double)numEvents / wallSeconds : 0.0;
-  G4double photonsPerEvent = (numEvents > 0) ? (G4double)EventAction::GetTotalPhotonCount() / numEvents : 0.0;
+  G4double photonsPerEvent = (numEvents > 0) ? (G4double)RunStatistics::Get(RunStatistics::kPhotons) / numEvents : 0.0;
   G4double speedup = (wallSeconds > 0) ? (G4double)totalCpuSeconds / wallSeconds : 0.0;
   G4cout << "Events/sec (wall): " << std::fixed << std::setprecision(1) << eventsPerSecond << G4endl;
   G4cout << "Avg photons/event: " << std::fixed << std::setprecision(1) << photonsPerEvent << G4endl;
   if (wallSeconds > 0) {
     G4cout << "Speedup (CPU/Wall): " << std::fixed << std::setprecision(1) << speedup << "x" << G4endl;
   }
+  G4cout << "Total steps: " << RunStatistics::Get(RunStatistics::kSteps) << G4endl;
+  G4cout << "Peak stacked tracks per thread: " << RunStatistics::GetPeak(RunStatistics::kPeakStackedTracks);
+  if (Config::GetInstance()->GetOpticalStagedStacking()) {
+    G4cout << " (staged, deferred photons peak " << RunStatistics::GetPeak(RunStatistics::kPeakDeferredPhotons) << ")";
+  }
+  G4cout << G4endl;
+  if (Config::GetInstance()->GetCherenkovThresholdKill()) {
+    G4cout << "Sub-threshold electrons killed: " << RunStatistics::Get(RunStatistics::kThresholdKills) << G4endl;
+  }
+  if (Config::GetInstance()->GetScoringEnvelopeMargin() >= 0.0) {
+    G4cout << "Killed leaving scoring envelope (charged / neutral): "
+           << RunStatistics::Get(RunStatistics::kEnvelopeKillsCharged) << " / " << RunStatistics::Get(RunStatistics::kEnvelopeKillsNeutral) << G4endl;
+  }
   
   G4cout << "======================================" << G4endl;
   G4cout << G4endl;
@@ -380,15 +559,168 @@ void RunAction::EndOfRunAction(const G4Run* run)
 #else
   int nThreads = 1;
 #endif
-  long totalDeposits = 0;
+  long totalDeposits = RunStatistics::Get(RunStatistics::kDeposits);
   std::string doseOutputBasePath = "";
   if (fMasterDoseBuffer != nullptr) {
-    totalDeposits = fMasterDoseBuffer->GetTotalEntries();
     Config* cfg = Config::GetInstance();
     if (cfg && cfg->GetEnableDoseOutput()) {
       doseOutputBasePath = cfg->GetDoseOutputFilePath();
     }
   }
+  std::vector<std::pair<std::string, std::string>> extraFields;
+  if (Config::GetInstance()->GetPhotonYieldFraction() < 1.0) {
+    std::ostringstream fraction;
+    fraction << std::setprecision(12) << Config::GetInstance()->GetPhotonYieldFraction();
+    extraFields.emplace_back("photon_yield_fraction", fraction.str());
+    extraFields.emplace_back("photons_generated", std::to_string(RunStatistics::Get(RunStatistics::kPhotonsGenerated)));
+    extraFields.emplace_back("photons_subsampled_away", std::to_string(RunStatistics::Get(RunStatistics::kPhotonsSubsampledAway)));
+  }
+  if (fCompactPhotons) {
+    extraFields.emplace_back("photon_record_bytes", std::to_string(sizeof(CompactRecord)));
+  } else if (fPhotonWeighting) {
+    extraFields.emplace_back("photon_record_bytes", std::to_string(sizeof(BinaryWeightedPhotonData)));
+  }
+  if (Config::GetInstance()->GetOpticalAbsorptionWeighting()) {
+    extraFields.emplace_back("optical_absorption_weighting", "true");
+  }
+  if (Config::GetInstance()->GetDirectionBiasEnabled()) {
+    Config* cfg = Config::GetInstance();
+    std::ostringstream bias;
+    bias << std::setprecision(12) << "{\"target\": \"" << cfg->GetDirectionBiasTarget() << "\", ";
+    if (cfg->GetDirectionBiasTarget() == "face") {
+      bias << "\"face\": \"" << cfg->GetDirectionBiasFace() << "\", ";
+    } else {
+      std::vector<double> axis = cfg->GetDirectionBiasAxis();
+      bias << "\"axis\": [";
+      for (size_t i = 0; i < axis.size(); ++i) {
+        bias << (i ? ", " : "") << axis[i];
+      }
+      bias << "], \"half_angle_deg\": " << cfg->GetDirectionBiasHalfAngle() << ", ";
+    }
+    bias << "\"azimuth_bins\": " << cfg->GetDirectionBiasAzimuthBins()
+         << ", \"defensive_fraction\": " << cfg->GetDirectionBiasDefensiveFraction() << "}";
+    extraFields.emplace_back("cherenkov_direction_bias", bias.str());
+  }
+  if (Config::GetInstance()->GetImportanceRouletteEnabled()) {
+    extraFields.emplace_back("importance_roulette", "true");
+    extraFields.emplace_back("photons_roulette_tested", std::to_string(RunStatistics::Get(RunStatistics::kPhotonsRouletteTested)));
+    extraFields.emplace_back("photons_rouletted", std::to_string(RunStatistics::Get(RunStatistics::kPhotonsRouletted)));
+  }
+  // 启动阶段耗时（main 中记录；交互模式同样适用）
+  std::string startup = StartupProfile::ToJson();
+  if (!startup.empty()) {
+    extraFields.emplace_back("startup", startup);
+  }
+  extraFields.emplace_back("physics_list", "\"" + Config::GetInstance()->GetPhysicsList() + "\"");
+  extraFields.emplace_back("em_option", std::to_string(Config::GetInstance()->GetEmOption()));
+  if (fCherenkovMode != "yield_only") {
+    // 实际生效的光学参数（从 G4OpticalParameters 读取，含吸收加权对 OpAbsorption 的覆盖）
+    G4OpticalParameters* opticalParams = G4OpticalParameters::Instance();
+    std::ostringstream processes;
+    processes << "{";
+    const auto& names = Config::GetOpticalProcessNames();
+    for (size_t i = 0; i < names.size(); ++i) {
+      processes << (i ? ", " : "") << "\"" << names[i] << "\": "
+                << (opticalParams->GetProcessActivation(names[i]) ? "true" : "false");
+    }
+    processes << "}";
+    std::ostringstream betaChange;
+    betaChange << std::setprecision(12) << opticalParams->GetCerenkovMaxBetaChange();
+    extraFields.emplace_back("optical_processes", processes.str());
+    extraFields.emplace_back("cerenkov_max_photons_per_step", std::to_string(opticalParams->GetCerenkovMaxPhotonsPerStep()));
+    extraFields.emplace_back("cerenkov_max_beta_change", betaChange.str());
+  }
+  // 步数与阈值截断：用 scripts/analyze_run_meta.py a.json b.json 对比两次运行的步数与墙钟时间
+  extraFields.emplace_back("total_steps", std::to_string(RunStatistics::Get(RunStatistics::kSteps)));
+  extraFields.emplace_back("optical_stacking", "\"" + Config::GetInstance()->GetOpticalStacking() + "\"");
+  extraFields.emplace_back("peak_stacked_tracks", std::to_string(RunStatistics::GetPeak(RunStatistics::kPeakStackedTracks)));
+  if (Config::GetInstance()->GetOpticalSubEventSize() > 0) {
+    extraFields.emplace_back("optical_subevent_size", std::to_string(Config::GetInstance()->GetOpticalSubEventSize()));
+    extraFields.emplace_back("optical_subevent_min_photons",
+                             std::to_string(Config::GetInstance()->GetOpticalSubEventMinPhotons()));
+    extraFields.emplace_back("photons_to_subevents", std::to_string(RunStatistics::Get(RunStatistics::kPhotonsToSubEvents)));
+    extraFields.emplace_back("subevents_merged", std::to_string(RunStatistics::Get(RunStatistics::kSubEventsMerged)));
+  }
+  if (Config::GetInstance()->GetOpticalStagedStacking()) {
+    extraFields.emplace_back("optical_batch_size", std::to_string(Config::GetInstance()->GetOpticalBatchSize()));
+    extraFields.emplace_back("peak_deferred_photons", std::to_string(RunStatistics::GetPeak(RunStatistics::kPeakDeferredPhotons)));
+  }
+  if (fOutputFormat == "binary") {
+    extraFields.emplace_back("writer_mode", AsyncWriter::Instance()->GetParallelAppend() ? "\"pwrite\"" : "\"queue\"");
+    extraFields.emplace_back("writer_queue_depth", std::to_string(AsyncWriter::Instance()->GetQueueDepth()));
+    extraFields.emplace_back("writer_direct_io", AsyncWriter::Instance()->GetDirectIO() ? "true" : "false");
+    extraFields.emplace_back("writer_fsync", "\"" + Config::GetInstance()->GetWriterFsync() + "\"");
+    extraFields.emplace_back("writer_backpressure_waits", std::to_string(AsyncWriter::Instance()->GetBackpressureWaits()));
+    extraFields.emplace_back("writer_write_failures", std::to_string(AsyncWriter::Instance()->GetWriteFailures()));
+    if (AsyncWriter::Instance()->GetWriteFailures() > 0) {
+      G4cerr << "ERROR: " << AsyncWriter::Instance()->GetWriteFailures()
+             << " output writes failed; the binary output is incomplete" << G4endl;
+    }
+    extraFields.emplace_back("output_compression",
+                             AsyncWriter::Instance()->GetChunkedOutput() && !AsyncWriter::Instance()->GetColumnarOutput() &&
+                             ChunkedOutput::Available() ? "\"zlib\"" : "\"none\"");
+    extraFields.emplace_back("output_layout", AsyncWriter::Instance()->GetColumnarOutput() ? "\"columns\"" : "\"records\"");
+    if (AsyncWriter::Instance()->GetChunkedOutput() && !AsyncWriter::Instance()->GetColumnarOutput()) {
+      extraFields.emplace_back("output_chunk_records", std::to_string(AsyncWriter::Instance()->GetChunkRecords()));
+      extraFields.emplace_back("output_chunks_uncompressed", std::to_string(AsyncWriter::Instance()->GetUncompressedChunks()));
+      if (AsyncWriter::Instance()->GetUncompressedChunks() > 0) {
+        G4cout << "WARNING: " << AsyncWriter::Instance()->GetUncompressedChunks()
+               << " output chunks failed to compress and were stored uncompressed" << G4endl;
+      }
+    }
+    if (fCompactPhotons && fMasterBuffer != nullptr) {
+      extraFields.emplace_back("photon_format", "\"compact\"");
+      extraFields.emplace_back("compact_clamped_photons", std::to_string(RunStatistics::Get(RunStatistics::kCompactClamped)));
+      if (RunStatistics::Get(RunStatistics::kCompactClamped) > 0) {
+        G4cout << "WARNING: " << RunStatistics::Get(RunStatistics::kCompactClamped)
+               << " photons had a position, wavelength or weight outside the compact format range (clamped)" << G4endl;
+      }
+    }
+    extraFields.emplace_back("memory", MemoryBudget::ToJson());
+    if (MemoryBudget::IsEnabled() &&
+        MemoryBudget::GetTotalPeak() > static_cast<long long>(MemoryBudget::GetBudgetMB() * 1024.0 * 1024.0)) {
+      G4cout << "WARNING: peak buffer memory " << MemoryBudget::GetTotalPeak() / (1024 * 1024)
+             << " MB exceeded memory_budget_mb (photon tables grow within large events)" << G4endl;
+    }
+  }
+  extraFields.emplace_back("cherenkov_threshold_kill",
+                           Config::GetInstance()->GetCherenkovThresholdKill() ? "true" : "false");
+  if (Config::GetInstance()->GetCherenkovThresholdKill()) {
+    std::ostringstream killedEnergy;
+    killedEnergy << std::setprecision(12) << RunStatistics::GetThresholdKilledEnergy() / MeV;
+    extraFields.emplace_back("threshold_killed_electrons", std::to_string(RunStatistics::Get(RunStatistics::kThresholdKills)));
+    extraFields.emplace_back("threshold_killed_energy_MeV", killedEnergy.str());
+  }
+  if (Config::GetInstance()->GetPhantomProductionCut() > 0.0) {
+    std::ostringstream cut;
+    cut << std::setprecision(12) << Config::GetInstance()->GetPhantomProductionCut();
+    extraFields.emplace_back("phantom_production_cut_mm", cut.str());
+  }
+  if (Config::GetInstance()->GetScoringEnvelopeMargin() >= 0.0) {
+    std::ostringstream margin;
+    margin << std::setprecision(12) << Config::GetInstance()->GetScoringEnvelopeMargin();
+    extraFields.emplace_back("scoring_envelope_margin_cm", margin.str());
+    extraFields.emplace_back("envelope_killed_charged", std::to_string(RunStatistics::Get(RunStatistics::kEnvelopeKillsCharged)));
+    extraFields.emplace_back("envelope_killed_neutral", std::to_string(RunStatistics::Get(RunStatistics::kEnvelopeKillsNeutral)));
+  }
+  if (Config::GetInstance()->GetVoxelPhantomEnabled()) {
+    std::vector<int> dims = Config::GetInstance()->GetVoxelPhantomDims();
+    std::ostringstream voxel;
+    voxel << "{\"raw_file\": \"" << Config::GetInstance()->GetVoxelPhantomFile() << "\", \"dims\": [";
+    for (size_t i = 0; i < dims.size(); ++i) {
+      voxel << (i ? ", " : "") << dims[i];
+    }
+    voxel << "], \"materials\": " << Config::GetInstance()->GetVoxelPhantomMaterials().size() << "}";
+    extraFields.emplace_back("voxel_phantom", voxel.str());
+  }
+  if (fMasterYieldGrid != nullptr) {
+    std::ostringstream yieldIn, yieldOut;
+    yieldIn << std::setprecision(12) << fMasterYieldGrid->GetYieldInGrid();
+    yieldOut << std::setprecision(12) << fMasterYieldGrid->GetYieldOutsideGrid();
+    extraFields.emplace_back("yield_output_path", "\"" + fOutputBasePath + ".yield\"");
+    extraFields.emplace_back("expected_photons_in_grid", yieldIn.str());
+    extraFields.emplace_back("expected_photons_outside_grid", yieldOut.str());
+  }
   RunMetadata::Write(
     fOutputBasePath + ".run_meta.json",
     run,
@@ -396,19 +728,91 @@ void RunAction::EndOfRunAction(const G4Run* run)
     fOutputFormat,
     wallSeconds,
     cpuSecondsLong,
-    static_cast<long>(EventAction::GetTotalPhotonCount()),
+    RunStatistics::Get(RunStatistics::kPhotons),
     nThreads,
     totalDeposits,
     doseOutputBasePath,
-    static_cast<long>(EventAction::GetDoseDepositsWithoutPrimary())
+    RunStatistics::Get(RunStatistics::kDepositsWithoutPrimary),
+    extraFields
   );
 }
 
+void RunAction::RecordPhotonEvent(const PhotonTable& table, G4int event_id)
+{
+  if (fOutputFormat != "binary") {
+    table.ForEachComplete([&](G4int trackID, const PhotonData& data) {
+      RecordPhotonData(data.initialX, data.initialY, data.initialZ,
+                       data.initialDirX, data.initialDirY, data.initialDirZ,
+                       data.finalX, data.finalY, data.finalZ,
+                       data.finalDirX, data.finalDirY, data.finalDirZ,
+                       data.finalEnergy, event_id, trackID, data.weight);
+    });
+    return;
+  }
+#ifdef G4MULTITHREADED
+  PhotonBuffer* buffer = G4Threading::IsWorkerThread() ? fThreadBuffer : fMasterBuffer;
+#else
+  PhotonBuffer* buffer = fMasterBuffer;
+#endif
+  if (buffer == nullptr) return;
+
+  // 整个事件一次追加。放不下时先交出已有记录，缓冲容量不超过上限（memory_budget_mb 的硬上限）；
+  // 单个事件就超过整个缓冲时逐光子写入，满一块交出一块（compact 格式另加一条事件帧）
+  const size_t capacity = static_cast<size_t>(buffer->GetBufferSize());
+  const size_t eventRecords = table.RangeSize() + (buffer->IsCompact() ? 1 : 0);
+  if (eventRecords > capacity) {
+    table.ForEachComplete([&](G4int trackID, const PhotonData& data) {
+      RecordPhotonData(data.initialX, data.initialY, data.initialZ,
+                       data.initialDirX, data.initialDirY, data.initialDirZ,
+                       data.finalX, data.finalY, data.finalZ,
+                       data.finalDirX, data.finalDirY, data.finalDirZ,
+                       data.finalEnergy, event_id, trackID, data.weight);
+    });
+    return;
+  }
+  if (static_cast<size_t>(buffer->GetBufferRecords()) + eventRecords > capacity) {
+    FlushPhotonBuffer(buffer);
+  }
+  buffer->FillEvent(table, event_id);
+  FlushPhotonBufferIfFull(buffer);
+}
+
+void RunAction::FlushPhotonBufferIfFull(PhotonBuffer* buffer)
+{
+  if (fCompactPhotons) {
+    const G4long clamped = buffer->TakeClampedPhotons();
+    if (clamped > 0) RunStatistics::Add(RunStatistics::kCompactClamped, clamped);
+  }
+  if (buffer->IsBufferFull()) FlushPhotonBuffer(buffer);
+}
+
+void RunAction::FlushPhotonBuffer(PhotonBuffer* buffer)
+{
+  if (buffer->GetBufferEntries() == 0) return;
+#ifdef G4MULTITHREADED
+  if (G4Threading::IsWorkerThread()) {
+    // Worker buffer full: absorb to master buffer
+    if (fMasterBuffer != nullptr) {
+      fMasterBuffer->AbsorbWorkerBuffer(buffer);
+    }
+  } else {
+    // Master buffer full: write to disk
+    buffer->WriteBuffer(fOutputBasePath + ".phsp");
+    buffer->ClearBuffer();
+  }
+#else
+  // Sequential mode: write to disk
+  buffer->WriteBuffer(fOutputBasePath + ".phsp");
+  buffer->ClearBuffer();
+#endif
+}
+
 void RunAction::RecordPhotonData(G4double initX, G4double initY, G4double initZ,
                                  G4double initDirX, G4double initDirY, G4double initDirZ,
                                  G4double finalX, G4double finalY, G4double finalZ,
                                  G4double finalDirX, G4double finalDirY, G4double finalDirZ,
-                                 G4double finalEnergy, G4int event_id, G4int track_id)
+                                 G4double finalEnergy, G4int event_id, G4int track_id,
+                                 G4double weight)
 {
   if (fOutputFormat == "binary") {
     // ===== Binary output mode with buffer =====
@@ -423,27 +827,8 @@ void RunAction::RecordPhotonData(G4double initX, G4double initY, G4double initZ,
     // Fill buffer
     buffer->Fill(initX, initY, initZ, initDirX, initDirY, initDirZ,
                  finalX, finalY, finalZ, finalDirX, finalDirY, finalDirZ,
-                 finalEnergy, event_id, track_id);
-    
-    // Check if buffer is full
-    if (buffer->IsBufferFull()) {
-#ifdef G4MULTITHREADED
-      if (G4Threading::IsWorkerThread()) {
-        // Worker buffer full: absorb to master buffer
-        if (fMasterBuffer != nullptr) {
-          fMasterBuffer->AbsorbWorkerBuffer(buffer);
-        }
-      } else {
-        // Master buffer full: write to disk
-        buffer->WriteBuffer(fOutputBasePath + ".phsp");
-        buffer->ClearBuffer();
-      }
-#else
-      // Sequential mode: write to disk
-      buffer->WriteBuffer(fOutputBasePath + ".phsp");
-      buffer->ClearBuffer();
-#endif
-    }
+                 finalEnergy, event_id, track_id, weight);
+    FlushPhotonBufferIfFull(buffer);
     
   } else {
     // ===== CSV output mode =====
@@ -458,7 +843,11 @@ void RunAction::RecordPhotonData(G4double initX, G4double initY, G4double initZ,
                         << initDirX << "," << initDirY << "," << initDirZ << ","
                         << (finalX/cm) << "," << (finalY/cm) << "," << (finalZ/cm) << ","
                         << finalDirX << "," << finalDirY << "," << finalDirZ << ","
-                        << energyInMicroeV << "\n";
+                        << energyInMicroeV;
+    if (fPhotonWeighting) {
+      fThreadOutputStream << "," << weight;
+    }
+    fThreadOutputStream << "\n";
   }
 }
 
@@ -469,7 +858,11 @@ void RunAction::WriteCSVHeader(std::ofstream& out)
       << "InitialDirX,InitialDirY,InitialDirZ,"
       << "FinalX,FinalY,FinalZ,"
       << "FinalDirX,FinalDirY,FinalDirZ,"
-      << "FinalEnergyMicroeV\n";
+      << "FinalEnergyMicroeV";
+  if (fPhotonWeighting) {
+    out << ",Weight";
+  }
+  out << "\n";
 }
 
 // Helper method: Merge CSV thread files
@@ -530,14 +923,30 @@ void RunAction::WriteBinaryHeader(const std::string& headerPath)
     G4cerr << "WARNING: Cannot create header file: " << headerPath << G4endl;
     return;
   }
+  if (fCompactPhotons) {
+    WriteCompactBinaryHeader(headerFile);
+    return;
+  }
   
-  headerFile << "Binary Phase Space File (format version 2)\n";
+  const int formatVersion = fPhotonWeighting ? 3 : 2;
+  headerFile << "Binary Phase Space File (format version " << formatVersion << ")\n";
   headerFile << "========================================\n\n";
-  headerFile << "format_version: 2\n";
-  headerFile << "bytes_per_photon: 60\n\n";
+  headerFile << "format_version: " << formatVersion << "\n";
+  headerFile << "bytes_per_photon: " << (fPhotonWeighting ? sizeof(BinaryWeightedPhotonData) : sizeof(BinaryPhotonData)) << "\n";
+  if (fPhotonWeighting) {
+    // weight = (1/photon_yield_fraction) * 吸收存活概率 * 方向偏倚权重 * 轮盘赌 1/p；
+    // 产生点核只应使用 1/photon_yield_fraction（轮盘赌时为 weight，且不能与吸收加权同时使用）
+    Config* config = Config::GetInstance();
+    headerFile << "photon_yield_fraction: " << std::setprecision(12) << config->GetPhotonYieldFraction() << "\n";
+    headerFile << "absorption_weighting: " << (config->GetOpticalAbsorptionWeighting() ? 1 : 0) << "\n";
+    headerFile << "direction_biasing: " << (config->GetDirectionBiasEnabled() ? 1 : 0) << "\n";
+    headerFile << "importance_roulette: " << (config->GetImportanceRouletteEnabled() ? 1 : 0) << "\n";
+  }
+  headerFile << "\n";
   headerFile << "Format: Binary (little-endian)\n";
+  WriteContainerInfo(headerFile, fOutputBasePath + ".phsp");
   headerFile << "uint32_t, int32_t, float32 all little-endian\n";
-  headerFile << "Total fields per photon: 15\n\n";
+  headerFile << "Total fields per photon: " << (fPhotonWeighting ? 16 : 15) << "\n\n";
   
   headerFile << "Field order:\n";
   headerFile << "  1. InitialX [cm] (float32)\n";
@@ -554,7 +963,12 @@ void RunAction::WriteBinaryHeader(const std::string& headerPath)
   headerFile << " 12. FinalDirZ (float32)\n";
   headerFile << " 13. FinalEnergy [microeV] (float32)\n";
   headerFile << " 14. event_id (uint32, G4Event::GetEventID())\n";
-  headerFile << " 15. track_id (int32, G4Track::GetTrackID(); -1 = unknown)\n\n";
+  headerFile << " 15. track_id (int32, G4Track::GetTrackID(); -1 = unknown)\n";
+  if (fPhotonWeighting) {
+    headerFile << " 16. weight (float32, statistical weight = 1/photon_yield_fraction x absorption survival"
+               << " x azimuth bias 1/(N*p_bin) x roulette survival 1/p; tallies use sum(weight))\n";
+  }
+  headerFile << "\n";
   
   headerFile << "Python reading example:\n";
   headerFile << "  import numpy as np\n";
@@ -562,12 +976,66 @@ void RunAction::WriteBinaryHeader(const std::string& headerPath)
   headerFile << "    ('initDirX','<f4'),('initDirY','<f4'),('initDirZ','<f4'),\n";
   headerFile << "    ('finalX','<f4'),('finalY','<f4'),('finalZ','<f4'),\n";
   headerFile << "    ('finalDirX','<f4'),('finalDirY','<f4'),('finalDirZ','<f4'),\n";
-  headerFile << "    ('finalEnergy','<f4'),('event_id','<u4'),('track_id','<i4')])\n";
+  if (fPhotonWeighting) {
+    headerFile << "    ('finalEnergy','<f4'),('event_id','<u4'),('track_id','<i4'),('weight','<f4')])\n";
+  } else {
+    headerFile << "    ('finalEnergy','<f4'),('event_id','<u4'),('track_id','<i4')])\n";
+  }
   headerFile << "  data = np.fromfile('file.phsp', dtype=dt)\n";
 
   headerFile.close();
 }
 
+// Helper method: header of the compact photon format (v4, CompactPhoton.hh)
+void RunAction::WriteCompactBinaryHeader(std::ofstream& headerFile)
+{
+  const CompactPhotonCodec* codec = fMasterBuffer != nullptr ? fMasterBuffer->GetCompactCodec() : nullptr;
+  headerFile << "Binary Phase Space File (format version 4, compact)\n";
+  headerFile << "========================================\n\n";
+  headerFile << "format_version: 4\n";
+  headerFile << "bytes_per_photon: " << sizeof(CompactRecord) << "\n";
+  headerFile << "bytes_per_event_frame: " << sizeof(CompactRecord) << "\n";
+  headerFile << std::setprecision(12);
+  for (int k = 0; k < 3; ++k) {
+    const char axis = static_cast<char>('x' + k);
+    headerFile << "position_min_" << axis << "_cm: " << (codec ? codec->GetMin(k) : 0.0) << "\n";
+    headerFile << "position_max_" << axis << "_cm: " << (codec ? codec->GetMax(k) : 0.0) << "\n";
+  }
+  headerFile << "wavelength_min_nm: " << kCompactWavelengthMinNm << "\n";
+  headerFile << "wavelength_max_nm: " << kCompactWavelengthMaxNm << "\n";
+  // 权重字段总是存在；weighted: 0 时全为 1。其余标志与 v3 相同（产生点核如何取权重）
+  Config* config = Config::GetInstance();
+  headerFile << "weighted: " << (fPhotonWeighting ? 1 : 0) << "\n";
+  headerFile << "photon_yield_fraction: " << config->GetPhotonYieldFraction() << "\n";
+  headerFile << "absorption_weighting: " << (config->GetOpticalAbsorptionWeighting() ? 1 : 0) << "\n";
+  headerFile << "direction_biasing: " << (config->GetDirectionBiasEnabled() ? 1 : 0) << "\n";
+  headerFile << "importance_roulette: " << (config->GetImportanceRouletteEnabled() ? 1 : 0) << "\n";
+  headerFile << "\n";
+  headerFile << "Format: Binary (little-endian), 24-byte records\n";
+  headerFile << "Records are read in order: event frame, then n_photons photon records, then the next frame.\n";
+  headerFile << "An event may appear in several frames (one per output buffer); frames of different\n";
+  headerFile << "threads interleave at buffer granularity.\n\n";
+  headerFile << "Event frame:\n";
+  headerFile << "  magic (uint32, 0x34545645 = 'EVT4')\n";
+  headerFile << "  event_id (uint32, G4Event::GetEventID())\n";
+  headerFile << "  n_photons (uint32, photon records following this frame)\n";
+  headerFile << "  reserved (3 x uint32)\n\n";
+  headerFile << "Photon record:\n";
+  headerFile << "  initPos (3 x uint16): x = min + q / 65535 * (max - min) [cm]\n";
+  headerFile << "  finalPos (3 x uint16): same mapping\n";
+  headerFile << "  initDir (2 x int16): octahedral unit vector, u = q / 32767\n";
+  headerFile << "  finalDir (2 x int16): same mapping\n";
+  headerFile << "  wavelength (uint16): lambda = wavelength_min + q / 65535 * (wavelength_max - wavelength_min) [nm],\n";
+  headerFile << "                       energy [eV] = 1239.84198 / lambda\n";
+  headerFile << "  weight (float16, statistical weight; 1 = analog)\n";
+  headerFile << "  track_id is not stored (-1 after decoding).\n\n";
+  headerFile << "Precision: position step = (max - min) / 65535; direction error < 1e-4 rad;\n";
+  headerFile << "  wavelength step 0.0137 nm; weight relative precision 2^-11 (max 65504).\n";
+  headerFile << "  Values outside the ranges are clamped (compact_clamped_photons in run_meta.json).\n\n";
+  headerFile << "Python reading: analysis/compact_phsp.py (read_compact_phsp -> float32 v3 record array)\n";
+  headerFile.close();
+}
+
 void RunAction::RecordDoseData(G4double x, G4double y, G4double z,
                                G4double dx, G4double dy, G4double dz,
                                G4double energy, G4int event_id, G4int pdg)
@@ -582,6 +1050,7 @@ void RunAction::RecordDoseData(G4double x, G4double y, G4double z,
   if (buffer == nullptr) return;
 
   buffer->Fill(x, y, z, dx, dy, dz, energy, event_id, pdg);
+  RunStatistics::Add(RunStatistics::kDeposits);
 
   if (buffer->IsBufferFull()) {
     std::string doseBase = config->GetDoseOutputFilePath();
@@ -612,6 +1081,7 @@ void RunAction::WriteDoseHeader(const std::string& headerPath)
   headerFile << "Dose raw energy deposit binary\n";
   headerFile << "==============================\n\n";
   headerFile << "Format: Binary (little-endian)\n";
+  WriteContainerInfo(headerFile, headerPath.substr(0, headerPath.size() - std::string(".header").size()));
   headerFile << "Bytes per record: 36\n";
   headerFile << "Fields per record: 9\n\n";
   headerFile << "Field order:\n";
@@ -631,3 +1101,224 @@ void RunAction::WriteDoseHeader(const std::string& headerPath)
   headerFile << "  data = np.fromfile('file.dose', dtype=dt)\n";
   headerFile.close();
 }
+
+void RunAction::RecordCreationData(G4double x, G4double y, G4double z,
+                                   G4double dirX, G4double dirY, G4double dirZ,
+                                   G4double energy, G4int event_id, G4int track_id, G4int parent_id)
+{
+  if (fOutputFormat != "binary") return;
+#ifdef G4MULTITHREADED
+  CreationBuffer* buffer = G4Threading::IsWorkerThread() ? fThreadCreationBuffer : fMasterCreationBuffer;
+#else
+  CreationBuffer* buffer = fMasterCreationBuffer;
+#endif
+  if (buffer == nullptr) return;
+
+  buffer->Fill(x, y, z, dirX, dirY, dirZ, energy, event_id, track_id, parent_id);
+
+  if (buffer->IsBufferFull()) {
+#ifdef G4MULTITHREADED
+    if (G4Threading::IsWorkerThread()) {
+      if (fMasterCreationBuffer != nullptr) {
+        fMasterCreationBuffer->AbsorbWorkerBuffer(buffer);
+      }
+    } else {
+      buffer->WriteBuffer(fOutputBasePath + ".creation");
+      buffer->ClearBuffer();
+    }
+#else
+    buffer->WriteBuffer(fOutputBasePath + ".creation");
+    buffer->ClearBuffer();
+#endif
+  }
+}
+
+// Helper method: divide memory_budget_mb among this run's buffers (master, before the workers start)
+void RunAction::PlanMemoryBudget()
+{
+  if (!MemoryBudget::IsEnabled()) return;
+  Config* config = Config::GetInstance();
+#ifdef G4MULTITHREADED
+  G4int nWorkers = G4MTRunManager::GetMasterRunManager()->GetNumberOfThreads();
+#else
+  G4int nWorkers = 0;
+#endif
+  // pwrite / 同步写时缓冲在提交线程里写完，不在队列中停留
+  AsyncWriter* writer = AsyncWriter::Instance();
+  G4int queueDepth = writer->GetParallelAppend() ? 0 : writer->GetQueueDepth();
+
+  const G4bool cherenkov = config->GetEnableCherenkovOutput();
+  const G4bool creation = cherenkov && fCherenkovMode == "creation_only";
+  const G4bool photons = cherenkov && !creation && fCherenkovMode != "yield_only";
+  const size_t photonBytes = fCompactPhotons ? sizeof(CompactRecord)
+                             : fPhotonWeighting ? sizeof(BinaryWeightedPhotonData) : sizeof(BinaryPhotonData);
+
+  size_t recordBytes[MemoryBudget::kNumStreams] = {0, 0, 0};
+  G4double weights[MemoryBudget::kNumStreams] = {0.0, 0.0, 0.0};
+  if (photons) {
+    // 缓冲内记录与写出的记录同大小（v2 60 / v3 64 字节）；compact 为 24 字节（事件帧与光子同样占缓冲容量）
+    recordBytes[MemoryBudget::kPhotonStream] = photonBytes;
+    weights[MemoryBudget::kPhotonStream] = static_cast<G4double>(config->GetBufferSize()) * photonBytes;
+  }
+  if (creation) {
+    recordBytes[MemoryBudget::kCreationStream] = sizeof(BinaryCreationData);
+    weights[MemoryBudget::kCreationStream] = static_cast<G4double>(config->GetBufferSize()) * sizeof(BinaryCreationData);
+  }
+  if (config->GetEnableDoseOutput()) {
+    recordBytes[MemoryBudget::kDoseStream] = sizeof(BinaryDoseData);
+    weights[MemoryBudget::kDoseStream] = static_cast<G4double>(config->GetDoseBufferSize()) * sizeof(BinaryDoseData);
+  }
+  MemoryBudget::Plan(nWorkers, queueDepth, photons, recordBytes, weights);
+}
+
+// Helper method: photon buffer of this run's photon_format (compact: quantized to the phantom box)
+PhotonBuffer* RunAction::NewPhotonBuffer(G4int bufferSize)
+{
+  if (!fCompactPhotons) return new PhotonBuffer(bufferSize, fPhotonWeighting);
+  PhantomGeometry phantom;
+  double boundsMin[3], boundsMax[3];
+  for (int k = 0; k < 3; ++k) {
+    boundsMin[k] = (phantom.GetCenter()[k] - phantom.GetHalfSize()[k]) / cm;
+    boundsMax[k] = (phantom.GetCenter()[k] + phantom.GetHalfSize()[k]) / cm;
+  }
+  CompactPhotonCodec codec(boundsMin, boundsMax);
+  return new PhotonBuffer(bufferSize, fPhotonWeighting, &codec);
+}
+
+// Helper method: buffers kept from an earlier run take this run's planned capacities (new buffers
+// already read them in their constructors); buffers are empty between runs
+void RunAction::ApplyMemoryBudget()
+{
+  if (!MemoryBudget::IsEnabled()) return;
+#ifdef G4MULTITHREADED
+  const G4bool worker = G4Threading::IsWorkerThread();
+  PhotonBuffer* photon = worker ? fThreadBuffer : fMasterBuffer;
+  DoseBuffer* dose = worker ? fThreadDoseBuffer : fMasterDoseBuffer;
+  CreationBuffer* creation = worker ? fThreadCreationBuffer : fMasterCreationBuffer;
+#else
+  PhotonBuffer* photon = fMasterBuffer;
+  DoseBuffer* dose = fMasterDoseBuffer;
+  CreationBuffer* creation = fMasterCreationBuffer;
+#endif
+  G4int records = MemoryBudget::GetBufferRecords(MemoryBudget::kPhotonStream);
+  if (photon != nullptr && records > 0) photon->SetBufferSize(records);
+  records = MemoryBudget::GetBufferRecords(MemoryBudget::kDoseStream);
+  if (dose != nullptr && records > 0) dose->SetBufferSize(records);
+  records = MemoryBudget::GetBufferRecords(MemoryBudget::kCreationStream);
+  if (creation != nullptr && records > 0) creation->SetBufferSize(records);
+}
+
+// Helper method: creation-only output setup (worker buffer, or master file + buffer)
+void RunAction::SetUpCreationOutput(G4int bufferSize)
+{
+#ifdef G4MULTITHREADED
+  if (G4Threading::IsWorkerThread()) {
+    if (fThreadCreationBuffer == nullptr) {
+      fThreadCreationBuffer = new CreationBuffer(bufferSize);
+    }
+    return;
+  }
+#endif
+  // Remove existing file (if any) and create new one
+  std::string creationPath = fOutputBasePath + ".creation";
+  if (std::remove(creationPath.c_str()) != 0 && errno != ENOENT) {
+    G4cerr << "WARNING: Cannot remove existing creation file: " << creationPath << G4endl;
+    G4cerr << "         Error: " << std::strerror(errno) << G4endl;
+    G4cerr << "         Will attempt to truncate instead..." << G4endl;
+  }
+  std::ofstream truncateFile(creationPath, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!truncateFile.good()) {
+    G4cerr << "ERROR: Cannot create creation output file: " << creationPath << G4endl;
+    G4cerr << "       Error: " << std::strerror(errno) << G4endl;
+    G4cerr << "       Please check file permissions and ensure no other process is using it." << G4endl;
+    return;
+  }
+  truncateFile.close();
+  if (fMasterCreationBuffer == nullptr) {
+    fMasterCreationBuffer = new CreationBuffer(bufferSize);
+    fMasterCreationBuffer->SetOutputPath(creationPath);
+    G4cout << "Creation-only mode: photons recorded at birth and killed -> " << creationPath << G4endl;
+  }
+}
+
+void RunAction::WriteCreationHeader(const std::string& headerPath)
+{
+  std::ofstream headerFile(headerPath, std::ios::out);
+  if (!headerFile.is_open()) {
+    G4cerr << "WARNING: Cannot create creation header file: " << headerPath << G4endl;
+    return;
+  }
+  headerFile << "Cherenkov creation-only binary (photons recorded at birth, not transported)\n";
+  headerFile << "==========================================================================\n\n";
+  headerFile << "record_type: creation\n";
+  headerFile << "bytes_per_record: 40\n";
+  // creation 记录不含逐光子权重；子采样时所有记录权重相同 = 1/photon_yield_fraction
+  headerFile << "photon_weight: " << std::setprecision(12) << 1.0 / Config::GetInstance()->GetPhotonYieldFraction() << "\n\n";
+  headerFile << "Format: Binary (little-endian)\n";
+  WriteContainerInfo(headerFile, fOutputBasePath + ".creation");
+  headerFile << "Fields per record: 10\n\n";
+  headerFile << "Field order:\n";
+  headerFile << "  1. x [cm] (float32)\n";
+  headerFile << "  2. y [cm] (float32)\n";
+  headerFile << "  3. z [cm] (float32)\n";
+  headerFile << "  4. dirX (float32)\n";
+  headerFile << "  5. dirY (float32)\n";
+  headerFile << "  6. dirZ (float32)\n";
+  headerFile << "  7. energy [microeV] (float32)\n";
+  headerFile << "  8. event_id (uint32)\n";
+  headerFile << "  9. track_id (int32)\n";
+  headerFile << " 10. parent_id (int32, emitting charged particle)\n\n";
+  headerFile << "Python reading example:\n";
+  headerFile << "  import numpy as np\n";
+  headerFile << "  dt = np.dtype([('x','<f4'),('y','<f4'),('z','<f4'),('dirX','<f4'),('dirY','<f4'),('dirZ','<f4'),\n";
+  headerFile << "    ('energy','<f4'),('event_id','<u4'),('track_id','<i4'),('parent_id','<i4')])\n";
+  headerFile << "  data = np.fromfile('file.creation', dtype=dt)\n";
+  headerFile.close();
+}
+
+// Helper method: yield_only output setup (worker grid, or master grid written at end of run).
+// 网格跨 run 保留，每个 run 开始时清零
+void RunAction::SetUpYieldOutput()
+{
+#ifdef G4MULTITHREADED
+  if (G4Threading::IsWorkerThread()) {
+    if (fThreadYieldGrid == nullptr) {
+      fThreadYieldGrid = new YieldGrid();
+    } else {
+      fThreadYieldGrid->Reset();
+    }
+    return;
+  }
+#endif
+  if (fMasterYieldGrid != nullptr) {
+    fMasterYieldGrid->Reset();
+  } else {
+    fMasterYieldGrid = new YieldGrid();
+    G4cout << "Yield-only mode: expected Cherenkov yield on a " << fMasterYieldGrid->GetNx() << " x "
+           << fMasterYieldGrid->GetNy() << " x " << fMasterYieldGrid->GetNz()
+           << " grid -> " << fOutputBasePath << ".yield" << G4endl;
+  }
+}
+
+void RunAction::RecordCherenkovYield(const G4ThreeVector& pre, const G4ThreeVector& post,
+                                     G4double yieldPre, G4double yieldPost, G4double expected)
+{
+#ifdef G4MULTITHREADED
+  YieldGrid* grid = G4Threading::IsWorkerThread() ? fThreadYieldGrid : fMasterYieldGrid;
+#else
+  YieldGrid* grid = fMasterYieldGrid;
+#endif
+  if (grid == nullptr) return;
+  grid->AddStep(pre, post, yieldPre, yieldPost, expected);
+}
+
+void RunAction::EndOfEventYield()
+{
+#ifdef G4MULTITHREADED
+  YieldGrid* grid = G4Threading::IsWorkerThread() ? fThreadYieldGrid : fMasterYieldGrid;
+#else
+  YieldGrid* grid = fMasterYieldGrid;
+#endif
+  if (grid == nullptr) return;
+  grid->EndOfEvent();
+}
@@ -23,7 +23,8 @@ void Write(const std::string& metaPath,
            int numThreads,
            long totalDeposits,
            const std::string& doseOutputBasePath,
-           long doseDepositsWithoutPrimary)
+           long doseDepositsWithoutPrimary,
+           const std::vector<std::pair<std::string, std::string>>& extraFields)
 {
   std::ofstream out(metaPath);
   if (!out.is_open()) {
@@ -40,9 +41,11 @@ void Write(const std::string& metaPath,
   std::string phspPath = "";
   std::string configPath = "";
   int cfgThreads = 0;
+  std::string cherenkovMode = "full";
   if (config) {
     phspPath = config->GetPHSPFilePath();
     cfgThreads = config->GetNumThreads();
+    cherenkovMode = config->GetCherenkovMode();
   }
 
   long events = run ? run->GetNumberOfEvent() : 0;
@@ -57,11 +60,18 @@ void Write(const std::string& metaPath,
   out << "  \"num_threads_effective\": " << numThreads << ",\n";
   out << "  \"events\": " << events << ",\n";
   out << "  \"total_photons\": " << totalPhotons << ",\n";
+  out << "  \"cherenkov_mode\": \"" << cherenkovMode << "\",\n";
+  if (cherenkovMode == "creation_only") {
+    out << "  \"creation_output_path\": \"" << outputBasePath << ".creation\",\n";
+  }
   if (!doseOutputBasePath.empty()) {
     out << "  \"total_deposits\": " << totalDeposits << ",\n";
     out << "  \"dose_output_path\": \"" << doseOutputBasePath << ".dose\",\n";
     out << "  \"dose_deposits_without_primary\": " << doseDepositsWithoutPrimary << ",\n";
   }
+  for (const auto& field : extraFields) {
+    out << "  \"" << field.first << "\": " << field.second << ",\n";
+  }
   out << "  \"wall_time_seconds\": " << wallSeconds << ",\n";
   out << "  \"cpu_time_seconds\": " << cpuSeconds << "\n";
   out << "}\n";
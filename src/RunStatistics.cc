@@ -0,0 +1,99 @@
+//
+// RunStatistics.cc
+//
+
+#include "RunStatistics.hh"
+
+#include "G4Accumulable.hh"
+#include "G4AccumulableManager.hh"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+  const char* const kCounterNames[RunStatistics::kNumCounters] = {
+    "photons", "deposits", "deposits_without_primary", "photons_generated", "photons_subsampled_away",
+    "photons_roulette_tested", "photons_rouletted", "photons_to_subevents", "subevents_merged", "steps", "threshold_kills",
+    "envelope_kills_charged", "envelope_kills_neutral", "compact_clamped"
+  };
+  const char* const kPeakNames[RunStatistics::kNumPeaks] = {
+    "peak_stacked_tracks", "peak_deferred_photons"
+  };
+
+  // G4AccumulableManager 保存的是地址，注册后不能移动：逐个 new
+  struct ThreadAccumulables {
+    std::vector<std::unique_ptr<G4Accumulable<G4long>>> counters;
+    std::vector<std::unique_ptr<G4Accumulable<G4long>>> peaks;
+    std::unique_ptr<G4Accumulable<G4double>> thresholdKilledEnergy;
+  };
+
+  thread_local ThreadAccumulables* gThread = nullptr;
+}
+
+namespace RunStatistics {
+
+void RegisterThread()
+{
+  if (gThread != nullptr) return;
+  gThread = new ThreadAccumulables;
+  G4AccumulableManager* manager = G4AccumulableManager::Instance();
+  for (int i = 0; i < kNumCounters; ++i) {
+    gThread->counters.emplace_back(new G4Accumulable<G4long>(kCounterNames[i], 0));
+    manager->RegisterAccumulable(*gThread->counters.back());
+  }
+  for (int i = 0; i < kNumPeaks; ++i) {
+    gThread->peaks.emplace_back(new G4Accumulable<G4long>(kPeakNames[i], 0, G4MergeMode::kMaximum));
+    manager->RegisterAccumulable(*gThread->peaks.back());
+  }
+  gThread->thresholdKilledEnergy.reset(new G4Accumulable<G4double>("threshold_killed_energy", 0.0));
+  manager->RegisterAccumulable(*gThread->thresholdKilledEnergy);
+}
+
+void ReleaseThread()
+{
+  delete gThread;
+  gThread = nullptr;
+}
+
+void Reset()
+{
+  G4AccumulableManager::Instance()->Reset();
+}
+
+void Merge()
+{
+  G4AccumulableManager::Instance()->Merge();
+}
+
+void Add(Counter counter, G4long n)
+{
+  if (gThread != nullptr) *gThread->counters[counter] += n;
+}
+
+void AddThresholdKilledEnergy(G4double energy)
+{
+  if (gThread != nullptr) *gThread->thresholdKilledEnergy += energy;
+}
+
+void UpdatePeak(Peak peak, G4long value)
+{
+  if (gThread != nullptr && value > gThread->peaks[peak]->GetValue()) *gThread->peaks[peak] = value;
+}
+
+G4long Get(Counter counter)
+{
+  return gThread != nullptr ? gThread->counters[counter]->GetValue() : 0;
+}
+
+G4long GetPeak(Peak peak)
+{
+  return gThread != nullptr ? gThread->peaks[peak]->GetValue() : 0;
+}
+
+G4double GetThresholdKilledEnergy()
+{
+  return gThread != nullptr ? gThread->thresholdKilledEnergy->GetValue() : 0.0;
+}
+
+}  // namespace RunStatistics
@@ -0,0 +1,173 @@
+//
+// StackingAction.cc
+//
+
+#include "StackingAction.hh"
+#include "EventAction.hh"
+#include "RunStatistics.hh"
+#include "Config.hh"
+#include "AnalyticOpticalTransport.hh"
+#include "PhotonImportance.hh"
+
+#include "G4Track.hh"
+#include "G4DynamicParticle.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4VProcess.hh"
+#include "Randomize.hh"
+#include "G4Version.hh"
+
+StackingAction::StackingAction(EventAction* eventAction)
+: G4UserStackingAction(),
+  fEventAction(eventAction),
+  fCreationOnly(false),
+  fYieldFraction(1.0),
+  fAnalyticTransport(nullptr),
+  fImportance(nullptr),
+  fStaged(false),
+  fBatchSize(10000),
+  fReinjecting(false),
+  fSubEventSize(0),
+  fSubEventMinPhotons(0),
+  fEventPhotons(0)
+{
+  Config* config = Config::GetInstance();
+  std::string mode = config->GetCherenkovMode();
+  fCreationOnly = (mode == "creation_only");
+  fYieldFraction = config->GetPhotonYieldFraction();
+  if (mode == "analytic") {
+    fAnalyticTransport = new AnalyticOpticalTransport();
+  }
+  if (config->GetImportanceRouletteEnabled()) {
+    fImportance = new PhotonImportance();
+  }
+  fStaged = config->GetOpticalStagedStacking();
+  fBatchSize = static_cast<size_t>(std::max(1, config->GetOpticalBatchSize()));
+  fSubEventSize = config->GetOpticalSubEventSize();
+  fSubEventMinPhotons = config->GetOpticalSubEventMinPhotons();
+}
+
+StackingAction::~StackingAction()
+{
+  delete fAnalyticTransport;
+  delete fImportance;
+}
+
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* track)
+{
+  // 栈内 G4Track 数（含本 track），本线程峰值
+  RunStatistics::UpdatePeak(RunStatistics::kPeakStackedTracks, stackManager->GetNTotalTrack() + 1);
+  if (fReinjecting) return fUrgent;  // 已在暂存前做过子采样/轮盘赌
+  if (fEventAction->IsSubEvent()) return fUrgent;  // 已在 master 上做过子采样/轮盘赌，不再分 sub-event
+  if (!fCreationOnly && fAnalyticTransport == nullptr && fYieldFraction >= 1.0 && fImportance == nullptr &&
+      !fStaged && fSubEventSize == 0) {
+    return fUrgent;
+  }
+  if (track->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition()) return fUrgent;
+
+  const G4VProcess* creatorProcess = track->GetCreatorProcess();
+  if (!creatorProcess || creatorProcess->GetProcessName() != "Cerenkov") return fUrgent;
+
+  // Photon yield subsampling: keep with probability f, weight 1/f (unbiased for weighted tallies)
+  if (fYieldFraction < 1.0) {
+    RunStatistics::Add(RunStatistics::kPhotonsGenerated);
+    if (G4UniformRand() >= fYieldFraction) {
+      RunStatistics::Add(RunStatistics::kPhotonsSubsampledAway);
+      return fKill;
+    }
+    const_cast<G4Track*>(track)->SetWeight(track->GetWeight() / fYieldFraction);
+  }
+
+  // Importance roulette: survive with p = max(I, p_min), weight 1/p (unbiased for weighted tallies)
+  if (fImportance != nullptr) {
+    RunStatistics::Add(RunStatistics::kPhotonsRouletteTested);
+    G4double p = fImportance->SurvivalProbability(track->GetPosition(), track->GetMomentumDirection(),
+                                                  track->GetKineticEnergy());
+    if (p < 1.0) {
+      if (G4UniformRand() >= p) {
+        RunStatistics::Add(RunStatistics::kPhotonsRouletted);
+        return fKill;
+      }
+      const_cast<G4Track*>(track)->SetWeight(track->GetWeight() / p);
+    }
+  }
+  if (!fCreationOnly && fAnalyticTransport == nullptr) {
+#if defined(G4MULTITHREADED) && G4VERSION_NUMBER >= 1120
+    // 重事件：超过阈值后的光子组成 sub-event 交给 worker；记录带母事件的 event_id 与 master 分配的 track_id
+    if (fSubEventSize > 0 && ++fEventPhotons > fSubEventMinPhotons) {
+      RunStatistics::Add(RunStatistics::kPhotonsToSubEvents);
+      return fSubEvent_0;
+    }
+#endif
+    if (!fStaged) return fUrgent;
+    fDeferred.push_back({track->GetPosition(), track->GetMomentumDirection(), track->GetPolarization(),
+                         track->GetKineticEnergy(), track->GetGlobalTime(), track->GetWeight(),
+                         track->GetTrackID(), track->GetParentID(), track->GetCreatorProcess()});
+    RunStatistics::UpdatePeak(RunStatistics::kPeakDeferredPhotons, static_cast<G4long>(fDeferred.size()));
+    return fKill;
+  }
+
+  // Track ID has already been assigned by G4EventManager before the track is stacked,
+  // so the record carries the same track_id a fully tracked photon would have had.
+  G4ThreeVector position = track->GetPosition();
+  G4ThreeVector direction = track->GetMomentumDirection();
+
+  if (fAnalyticTransport != nullptr) {
+    AnalyticPhotonEnd end;
+    if (!fAnalyticTransport->Transport(position, direction, track->GetPolarization(),
+                                       track->GetKineticEnergy(), end)) {
+      return fUrgent;  // 模体外产生的光子：交给 Geant4 正常追踪
+    }
+    fEventAction->RecordPhotonCreation(
+      track->GetTrackID(),
+      position.x(), position.y(), position.z(),
+      direction.x(), direction.y(), direction.z(),
+      track->GetWeight()
+    );
+    fEventAction->RecordPhotonEnd(
+      track->GetTrackID(),
+      end.position.x(), end.position.y(), end.position.z(),
+      end.direction.x(), end.direction.y(), end.direction.z(),
+      end.energy,
+      track->GetWeight() * end.survival
+    );
+    return fKill;
+  }
+
+  fEventAction->RecordPhotonBirth(
+    track->GetTrackID(), track->GetParentID(),
+    position.x(), position.y(), position.z(),
+    direction.x(), direction.y(), direction.z(),
+    track->GetKineticEnergy()
+  );
+  return fKill;
+}
+
+void StackingAction::NewStage()
+{
+  // urgent 栈已空：带电簇射（及上一批光子）已处理完，重新注入下一批暂存光子。
+  // G4StackManager 在 urgent 栈再次变空时会再调用 NewStage，直到暂存记录取完。
+  if (fDeferred.empty()) return;
+  size_t n = std::min(fBatchSize, fDeferred.size());
+  fReinjecting = true;
+  for (size_t i = 0; i < n; ++i) {
+    const DeferredPhoton& photon = fDeferred.back();
+    auto particle = new G4DynamicParticle(G4OpticalPhoton::OpticalPhotonDefinition(),
+                                          photon.direction, photon.energy);
+    particle->SetPolarization(photon.polarization);
+    auto track = new G4Track(particle, photon.time, photon.position);
+    track->SetTrackID(photon.trackID);
+    track->SetParentID(photon.parentID);
+    track->SetCreatorProcess(photon.creator);
+    track->SetWeight(photon.weight);
+    stackManager->PushOneTrack(track);
+    fDeferred.pop_back();
+  }
+  fReinjecting = false;
+}
+
+void StackingAction::PrepareNewEvent()
+{
+  // 中止的事件可能留下暂存记录
+  fDeferred.clear();
+  fEventPhotons = 0;
+}
@@ -0,0 +1,75 @@
+//
+// StartupProfile.cc
+//
+
+#include "StartupProfile.hh"
+
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  bool gStarted = false;
+  Clock::time_point gStart;
+  Clock::time_point gLastMark;
+  std::vector<std::pair<std::string, double>> gPhases;  // 保持记录顺序
+  std::string gCacheStatus = "disabled";
+  std::string gCacheDirectory;
+}
+
+namespace StartupProfile {
+
+void Start()
+{
+  gStarted = true;
+  gStart = Clock::now();
+  gLastMark = gStart;
+  gPhases.clear();
+}
+
+void Mark(const std::string& phase)
+{
+  if (!gStarted) return;
+  Clock::time_point now = Clock::now();
+  double seconds = std::chrono::duration<double>(now - gLastMark).count();
+  gLastMark = now;
+  for (auto& entry : gPhases) {
+    if (entry.first == phase) {
+      entry.second += seconds;
+      return;
+    }
+  }
+  gPhases.emplace_back(phase, seconds);
+}
+
+void SetPhysicsTableCache(const std::string& status, const std::string& directory)
+{
+  gCacheStatus = status;
+  gCacheDirectory = directory;
+}
+
+std::string ToJson()
+{
+  if (!gStarted) return "";
+  double total = 0.0;
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(3);
+  out << "{\"phases_seconds\": {";
+  for (size_t i = 0; i < gPhases.size(); ++i) {
+    out << (i ? ", " : "") << "\"" << gPhases[i].first << "\": " << gPhases[i].second;
+    total += gPhases[i].second;
+  }
+  out << "}, \"total_seconds\": " << total
+      << ", \"physics_table_cache\": \"" << gCacheStatus << "\"";
+  if (!gCacheDirectory.empty()) {
+    out << ", \"physics_table_cache_dir\": \"" << gCacheDirectory << "\"";
+  }
+  out << "}";
+  return out.str();
+}
+
+}  // namespace StartupProfile
@@ -5,22 +5,62 @@
 #include "SteppingAction.hh"
 #include "EventAction.hh"
 #include "Config.hh"
+#include "CherenkovYieldTable.hh"
+#include "CherenkovDirectionBias.hh"
 
 #include "G4Step.hh"
 #include "G4Event.hh"
 #include "G4RunManager.hh"
 #include "G4LogicalVolume.hh"
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
 #include "G4OpticalPhoton.hh"
+#include "G4Electron.hh"
 #include "G4Track.hh"
 #include "G4VProcess.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cmath>
 
 SteppingAction::SteppingAction(EventAction* eventAction)
 : G4UserSteppingAction(),
-  fEventAction(eventAction)
-{}
+  fEventAction(eventAction),
+  fYieldTable(nullptr),
+  fAbsorptionWeighting(Config::GetInstance()->GetOpticalAbsorptionWeighting()),
+  fAbsMaterial(nullptr),
+  fAbsLength(nullptr),
+  fThresholdKill(Config::GetInstance()->GetCherenkovThresholdKill()),
+  fElectronThreshold(-1.0),
+  fDirectionBias(nullptr),
+  fBiasMaterial(nullptr),
+  fBiasRindex(nullptr),
+  fPhantomGeometry(),
+  fEnvelopeMargin(Config::GetInstance()->GetScoringEnvelopeMargin() * cm)
+{
+  if (Config::GetInstance()->GetCherenkovMode() == "yield_only") {
+    fYieldTable = new CherenkovYieldTable();
+  }
+  if (Config::GetInstance()->GetDirectionBiasEnabled()) {
+    fDirectionBias = new CherenkovDirectionBias();
+  }
+}
 
 SteppingAction::~SteppingAction()
-{}
+{
+  delete fYieldTable;
+  delete fDirectionBias;
+}
+
+G4double SteppingAction::ElectronCherenkovThreshold(const G4Material* material)
+{
+  // beta > 1/n_max 才可能发光：T_th = m_e (1/sqrt(1 - 1/n_max^2) - 1)，水 n_max = 1.3608 时约 0.24 MeV
+  G4MaterialPropertiesTable* mpt = material ? material->GetMaterialPropertiesTable() : nullptr;
+  G4MaterialPropertyVector* rindex = mpt ? mpt->GetProperty("RINDEX") : nullptr;
+  if (rindex == nullptr || rindex->GetMaxValue() <= 1.0) return 0.0;
+  G4double nMax = rindex->GetMaxValue();
+  G4double gammaTh = 1.0 / std::sqrt(1.0 - 1.0 / (nMax * nMax));
+  return G4Electron::Definition()->GetPDGMass() * (gammaTh - 1.0);
+}
 
 void SteppingAction::UserSteppingAction(const G4Step* step)
 {
@@ -30,6 +70,7 @@ void SteppingAction::UserSteppingAction(const G4Step* step)
   Config* config = Config::GetInstance();
   G4String phantomName = config->GetPhantomVolumeName();
   G4VPhysicalVolume* preVolume = preStepPoint->GetPhysicalVolume();
+  fEventAction->CountStep();
 
   // 1) Dose branch first (pre-step in phantom, edep > 0)
   if (config->GetEnableDoseOutput()) {
@@ -41,7 +82,101 @@ void SteppingAction::UserSteppingAction(const G4Step* step)
     }
   }
 
-  // 2) Cherenkov optical photon branch (only optical photons)
+  // 1b) Sub-threshold electrons in the phantom: neither they nor their secondaries
+  //     (delta rays < T/2, brems photons < T) can reach the Cherenkov threshold again.
+  //     Positrons are kept: their 511 keV annihilation photons can still make light.
+  //     The kill happens after this step, so photons it already emitted are kept.
+  if (fThresholdKill && track->GetDefinition() == G4Electron::Definition() &&
+      track->GetTrackStatus() == fAlive &&
+      preVolume && preVolume->GetName() == phantomName) {
+    if (fElectronThreshold < 0.0) {
+      // 体素模体中电子可能进入折射率更高的材料，取所有能发光材料中最低的阈值
+      fElectronThreshold = 0.0;
+      for (const G4Material* material : *G4Material::GetMaterialTable()) {
+        G4double threshold = ElectronCherenkovThreshold(material);
+        if (threshold > 0.0 && (fElectronThreshold == 0.0 || threshold < fElectronThreshold)) {
+          fElectronThreshold = threshold;
+        }
+      }
+    }
+    G4double ekin = postStepPoint->GetKineticEnergy();
+    if (ekin < fElectronThreshold) {
+      if (config->GetEnableDoseOutput() && ekin > 0.0) {
+        // 剩余动能就地沉积
+        G4ThreeVector pos = postStepPoint->GetPosition();
+        fEventAction->RecordDoseData(pos.x(), pos.y(), pos.z(), ekin, track->GetDefinition()->GetPDGEncoding());
+      }
+      fEventAction->CountThresholdKill(ekin);
+      track->SetTrackStatus(fStopAndKill);
+    }
+  }
+
+  // 1c) Scoring envelope: outside the phantom box grown by the margin, a particle whose straight
+  //     line misses the phantom only crosses world air to the world boundary. Scattering back
+  //     from air is neglected. Optical photons keep the branch below (recorded at the surface).
+  if (fEnvelopeMargin >= 0.0 && track->GetTrackStatus() == fAlive &&
+      track->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition()) {
+    G4ThreeVector pos = postStepPoint->GetPosition();
+    if (!fPhantomGeometry.Contains(pos, fEnvelopeMargin) &&
+        fPhantomGeometry.DistanceToIn(pos, postStepPoint->GetMomentumDirection()) < 0.0) {
+      fEventAction->CountEnvelopeKill(track->GetDefinition()->GetPDGCharge() != 0.0);
+      track->SetTrackStatus(fStopAndKill);
+    }
+  }
+
+  // 1d) Cherenkov emission biasing: photons emitted in this step are still in the secondary list
+  //     (they are stacked when the parent track finishes), so their azimuth around the step
+  //     direction (the axis G4Cerenkov uses) can be resampled and the weight corrected here.
+  if (fDirectionBias != nullptr && track->GetDefinition()->GetPDGCharge() != 0.0) {
+    const std::vector<const G4Track*>* secondaries = step->GetSecondaryInCurrentStep();
+    if (secondaries != nullptr && !secondaries->empty()) {
+      const G4Material* material = preStepPoint->GetMaterial();
+      if (material != fBiasMaterial) {
+        fBiasMaterial = material;
+        G4MaterialPropertiesTable* mpt = material ? material->GetMaterialPropertiesTable() : nullptr;
+        fBiasRindex = mpt ? mpt->GetProperty("RINDEX") : nullptr;
+      }
+      G4ThreeVector axis = step->GetDeltaPosition().unit();
+      for (const G4Track* secondary : *secondaries) {
+        if (secondary->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition()) continue;
+        const G4VProcess* creatorProcess = secondary->GetCreatorProcess();
+        if (!creatorProcess || creatorProcess->GetProcessName() != "Cerenkov") continue;
+        G4ThreeVector direction = secondary->GetMomentumDirection();
+        G4ThreeVector polarization = secondary->GetPolarization();
+        G4double rindex = fBiasRindex ? fBiasRindex->Value(secondary->GetKineticEnergy()) : 0.0;
+        G4double weight = fDirectionBias->Resample(secondary->GetPosition(), axis, rindex,
+                                                   direction, polarization);
+        G4Track* biased = const_cast<G4Track*>(secondary);
+        biased->SetMomentumDirection(direction);
+        biased->SetPolarization(polarization);
+        biased->SetWeight(secondary->GetWeight() * weight);
+      }
+    }
+  }
+
+  // 2) yield_only: Frank–Tamm expected photons along charged steps (no optical photons exist)
+  if (fYieldTable != nullptr) {
+    G4double charge = track->GetDefinition()->GetPDGCharge();
+    if (charge != 0.0 && config->GetEnableCherenkovOutput()) {
+      const G4Material* material = preStepPoint->GetMaterial();
+      G4double betaPre = preStepPoint->GetBeta();
+      G4double betaPost = postStepPoint->GetBeta();
+      // G4Cerenkov: mean yield at the mean beta times step length; density linear in pre/post yields
+      G4double expected = fYieldTable->GetAverageNumberOfPhotons(charge, 0.5 * (betaPre + betaPost), material)
+                        * step->GetStepLength();
+      if (expected > 0.0) {
+        fEventAction->RecordCherenkovYield(
+          preStepPoint->GetPosition(), postStepPoint->GetPosition(),
+          fYieldTable->GetAverageNumberOfPhotons(charge, betaPre, material),
+          fYieldTable->GetAverageNumberOfPhotons(charge, betaPost, material),
+          expected
+        );
+      }
+    }
+    return;
+  }
+
+  // 3) Cherenkov optical photon branch (only optical photons)
   if (track->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition()) {
     return;
   }
@@ -55,11 +190,29 @@ void SteppingAction::UserSteppingAction(const G4Step* step)
       fEventAction->RecordPhotonCreation(
         track->GetTrackID(),
         position.x(), position.y(), position.z(),
-        direction.x(), direction.y(), direction.z()
+        direction.x(), direction.y(), direction.z(),
+        track->GetWeight()
       );
     }
   }
 
+  // Expected-value absorption: the step survives with probability exp(-L/lambda(E)),
+  // carried as weight instead of a binary OpAbsorption outcome
+  if (fAbsorptionWeighting) {
+    const G4Material* material = preStepPoint->GetMaterial();
+    if (material != fAbsMaterial) {
+      fAbsMaterial = material;
+      G4MaterialPropertiesTable* mpt = material ? material->GetMaterialPropertiesTable() : nullptr;
+      fAbsLength = mpt ? mpt->GetProperty("ABSLENGTH") : nullptr;
+    }
+    if (fAbsLength != nullptr && step->GetStepLength() > 0.0) {
+      G4double lambda = fAbsLength->Value(track->GetKineticEnergy());
+      if (lambda > 0.0) {
+        track->SetWeight(track->GetWeight() * std::exp(-step->GetStepLength() / lambda));
+      }
+    }
+  }
+
   G4VPhysicalVolume* postVolume = postStepPoint->GetPhysicalVolume();
   G4String preVolName = (preVolume) ? preVolume->GetName() : "None";
   G4String postVolName = (postVolume) ? postVolume->GetName() : "None";
@@ -74,7 +227,8 @@ void SteppingAction::UserSteppingAction(const G4Step* step)
       track->GetTrackID(),
       position.x(), position.y(), position.z(),
       direction.x(), direction.y(), direction.z(),
-      energy
+      energy,
+      track->GetWeight()
     );
     track->SetTrackStatus(fStopAndKill);
   } else if (isKilled) {
@@ -86,7 +240,8 @@ void SteppingAction::UserSteppingAction(const G4Step* step)
         track->GetTrackID(),
         position.x(), position.y(), position.z(),
         direction.x(), direction.y(), direction.z(),
-        energy
+        energy,
+        track->GetWeight()
       );
     }
   }
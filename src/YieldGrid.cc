@@ -0,0 +1,184 @@
+//
+// YieldGrid.cc
+//
+
+#include "YieldGrid.hh"
+#include "Config.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+#ifdef G4MULTITHREADED
+G4Mutex YieldGrid::fMergeMutex = G4MUTEX_INITIALIZER;
+#endif
+
+namespace {
+  // Same defaults as analysis/build_cherenkov_kernel.py
+  constexpr G4double kVoxelSizeMinCm = 0.3;
+  constexpr G4double kVoxelSizeMaxCm = 0.8;
+  constexpr G4double kTargetBinsLargestDim = 100.0;
+}
+
+YieldGrid::YieldGrid()
+: fNominalVoxelCm(0.0), fSubStep(0.0), fYieldInGrid(0.0), fYieldOutsideGrid(0.0)
+{
+  Config* config = Config::GetInstance();
+  G4double size[3] = {config->GetWaterSizeX(), config->GetWaterSizeY(), config->GetWaterSizeZ()};
+  G4double center[3] = {config->GetWaterPositionX(), config->GetWaterPositionY(), config->GetWaterPositionZ()};
+
+  G4double dv = config->GetYieldVoxelSize();
+  if (dv <= 0.0) {
+    G4double lMax = std::max(size[0], std::max(size[1], size[2]));
+    dv = std::min(std::max(lMax / kTargetBinsLargestDim, kVoxelSizeMinCm), kVoxelSizeMaxCm);
+  }
+  fNominalVoxelCm = dv;
+
+  G4double minWidth = 0.0;
+  for (int i = 0; i < 3; ++i) {
+    fN[i] = std::max(1, static_cast<G4int>(std::lround(size[i] / dv)));
+    fMin[i] = (center[i] - 0.5 * size[i]) * cm;
+    fMax[i] = (center[i] + 0.5 * size[i]) * cm;
+    fWidth[i] = (fMax[i] - fMin[i]) / fN[i];
+    minWidth = (i == 0) ? fWidth[i] : std::min(minWidth, fWidth[i]);
+  }
+  fSubStep = 0.5 * minWidth;
+
+  size_t nVoxels = static_cast<size_t>(fN[0]) * fN[1] * fN[2];
+  fSum.assign(nVoxels, 0.0);
+  fSum2.assign(nVoxels, 0.0);
+  fEvent.assign(nVoxels, 0.0);
+}
+
+G4int YieldGrid::VoxelIndex(const G4ThreeVector& p) const
+{
+  G4int idx[3];
+  for (int i = 0; i < 3; ++i) {
+    if (p[i] < fMin[i] || p[i] >= fMax[i]) return -1;
+    idx[i] = std::min(static_cast<G4int>((p[i] - fMin[i]) / fWidth[i]), fN[i] - 1);
+  }
+  return (idx[0] * fN[1] + idx[1]) * fN[2] + idx[2];
+}
+
+void YieldGrid::AddStep(const G4ThreeVector& pre, const G4ThreeVector& post,
+                        G4double yieldPre, G4double yieldPost, G4double expected)
+{
+  if (expected <= 0.0) return;
+
+  G4ThreeVector delta = post - pre;
+  G4double length = delta.mag();
+  G4int nSub = std::max(1, static_cast<G4int>(std::ceil(length / fSubStep)));
+
+  // Linear photon density from yieldPre to yieldPost, normalized to the step total
+  G4double densitySum = 0.0;
+  for (G4int k = 0; k < nSub; ++k) {
+    G4double t = (k + 0.5) / nSub;
+    densitySum += (1.0 - t) * yieldPre + t * yieldPost;
+  }
+
+  for (G4int k = 0; k < nSub; ++k) {
+    G4double t = (k + 0.5) / nSub;
+    G4double share = (densitySum > 0.0)
+                   ? expected * ((1.0 - t) * yieldPre + t * yieldPost) / densitySum
+                   : expected / nSub;
+    G4int index = VoxelIndex(pre + t * delta);
+    if (index < 0) {
+      fYieldOutsideGrid += share;
+      continue;
+    }
+    if (fEvent[index] == 0.0) fTouched.push_back(index);
+    fEvent[index] += share;
+    fYieldInGrid += share;
+  }
+}
+
+void YieldGrid::EndOfEvent()
+{
+  for (G4int index : fTouched) {
+    G4double y = fEvent[index];
+    fSum[index] += y;
+    fSum2[index] += y * y;
+    fEvent[index] = 0.0;
+  }
+  fTouched.clear();
+}
+
+void YieldGrid::Reset()
+{
+  std::fill(fSum.begin(), fSum.end(), 0.0);
+  std::fill(fSum2.begin(), fSum2.end(), 0.0);
+  std::fill(fEvent.begin(), fEvent.end(), 0.0);
+  fTouched.clear();
+  fYieldInGrid = 0.0;
+  fYieldOutsideGrid = 0.0;
+}
+
+void YieldGrid::Merge(const YieldGrid& workerGrid)
+{
+#ifdef G4MULTITHREADED
+  G4AutoLock lock(&fMergeMutex);
+#endif
+  if (workerGrid.fSum.size() != fSum.size()) {
+    G4cerr << "ERROR: YieldGrid::Merge: grid size mismatch, worker grid ignored" << G4endl;
+    return;
+  }
+  for (size_t i = 0; i < fSum.size(); ++i) {
+    fSum[i] += workerGrid.fSum[i];
+    fSum2[i] += workerGrid.fSum2[i];
+  }
+  fYieldInGrid += workerGrid.fYieldInGrid;
+  fYieldOutsideGrid += workerGrid.fYieldOutsideGrid;
+}
+
+G4bool YieldGrid::Write(const std::string& path) const
+{
+  std::ofstream outFile(path, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!outFile.good()) {
+    G4cerr << "ERROR: Cannot open yield output file for writing: " << path << G4endl;
+    return false;
+  }
+  outFile.write(reinterpret_cast<const char*>(fSum.data()), fSum.size() * sizeof(G4double));
+  outFile.write(reinterpret_cast<const char*>(fSum2.data()), fSum2.size() * sizeof(G4double));
+  outFile.close();
+  return true;
+}
+
+void YieldGrid::WriteHeader(const std::string& headerPath, G4int numEvents) const
+{
+  std::ofstream headerFile(headerPath, std::ios::out);
+  if (!headerFile.good()) {
+    G4cerr << "WARNING: Cannot create yield header file: " << headerPath << G4endl;
+    return;
+  }
+  headerFile << "Cherenkov expected-yield voxel grid (cherenkov_mode = yield_only)\n";
+  headerFile << "=================================================================\n\n";
+  headerFile << "record_type: yield\n";
+  headerFile << "dtype: float64\n";
+  headerFile << "layout: sum_then_sum2\n";
+  headerFile << std::setprecision(10);
+  headerFile << "nx: " << fN[0] << "\n";
+  headerFile << "ny: " << fN[1] << "\n";
+  headerFile << "nz: " << fN[2] << "\n";
+  headerFile << "x_min_cm: " << fMin[0] / cm << "\n";
+  headerFile << "x_max_cm: " << fMax[0] / cm << "\n";
+  headerFile << "y_min_cm: " << fMin[1] / cm << "\n";
+  headerFile << "y_max_cm: " << fMax[1] / cm << "\n";
+  headerFile << "z_min_cm: " << fMin[2] / cm << "\n";
+  headerFile << "z_max_cm: " << fMax[2] / cm << "\n";
+  headerFile << "voxel_size_nominal_cm: " << fNominalVoxelCm << "\n";
+  headerFile << "events: " << numEvents << "\n";
+  headerFile << "yield_in_grid: " << fYieldInGrid << "\n";
+  headerFile << "yield_outside_grid: " << fYieldOutsideGrid << "\n\n";
+  headerFile << "Content:\n";
+  headerFile << "  sum[nx][ny][nz]  - sum over events of expected photons per voxel\n";
+  headerFile << "  sum2[nx][ny][nz] - sum over events of (expected photons per voxel)^2\n";
+  headerFile << "  K = sum / events, sigma(K) = sqrt((sum2/events - K^2) / (events - 1))\n\n";
+  headerFile << "Python reading example:\n";
+  headerFile << "  import numpy as np\n";
+  headerFile << "  a = np.fromfile('file.yield', dtype='<f8').reshape(2, nx, ny, nz)\n";
+  headerFile << "  ysum, ysum2 = a[0], a[1]\n";
+  headerFile.close();
+}